@@ -4,6 +4,10 @@
  */
 
 #include "app_network.h"
+#include "http_pool.h"
+#include "mqtt_image.h"
+#include "mqtt_outbox.h"
+#include "mqtt_telemetry.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
@@ -11,8 +15,13 @@
 #include "mqtt_client.h"
 #include "nvs_flash.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "APP_NETWORK";
@@ -24,6 +33,9 @@ static const char *TAG = "APP_NETWORK";
 #define WIFI_PASS "29504923"
 #define WIFI_MAX_RETRY 10
 
+// Client-wide outbox cap; CONFIG_MQTT_OUTBOX_DATA_ON_EXTERNAL_MEMORY keeps it in PSRAM
+#define MQTT_OUTBOX_LIMIT (512 * 1024)
+
 // ============================================================================
 // State Variables
 // ============================================================================
@@ -34,6 +46,27 @@ static EventGroupHandle_t wifi_event_group;
 static esp_mqtt_client_handle_t mqtt_client = NULL;
 static bool mqtt_connected = false;
 
+// Upload statistics are written by the upload and spool tasks and read by the status loop
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Streaming upload state
+#define UPLOAD_STREAM_TIMEOUT_MS 10000
+#define UPLOAD_STREAM_CHUNK_SIZE 4096
+static app_network_upload_stats_t upload_stats = {0};
+static uint64_t upload_ttfb_total_ms = 0;
+static uint64_t upload_time_total_us = 0;
+static int64_t upload_first_us = 0;
+
+// Resumable upload state
+#define RESUME_RETRY_DELAY_MS 500
+static app_network_resume_stats_t resume_stats = {0};
+
+// Batch upload state
+#define BATCH_BOUNDARY "rainguardbatch"
+#define BATCH_TIMEOUT_MS 30000
+static app_network_batch_stats_t batch_stats = {0};
+static uint64_t batch_time_total_us = 0;
+
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT BIT1
 
@@ -87,13 +120,26 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     case MQTT_EVENT_CONNECTED:
         ESP_LOGI(TAG, "✓ MQTT Connected to broker");
         mqtt_connected = true;
+        mqtt_image_on_connected(event->client);
+        mqtt_telemetry_on_connected(event->client);
         break;
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGW(TAG, "MQTT Disconnected");
         mqtt_connected = false;
+        mqtt_telemetry_on_disconnected();
         break;
     case MQTT_EVENT_PUBLISHED:
         ESP_LOGD(TAG, "MQTT message published, msg_id=%d", event->msg_id);
+        mqtt_outbox_on_published(event->msg_id);
+        mqtt_telemetry_on_published(event->msg_id);
+        break;
+    case MQTT_EVENT_DELETED:
+        ESP_LOGW(TAG, "MQTT message expired from outbox, msg_id=%d", event->msg_id);
+        mqtt_outbox_on_deleted(event->msg_id);
+        mqtt_telemetry_on_deleted(event->msg_id);
+        break;
+    case MQTT_EVENT_DATA:
+        mqtt_image_on_data(event);
         break;
     case MQTT_EVENT_ERROR:
         ESP_LOGE(TAG, "MQTT Error");
@@ -216,6 +262,7 @@ esp_err_t app_network_mqtt_init(const char *broker_uri)
     const esp_mqtt_client_config_t mqtt_cfg = {
         .broker.address.uri = broker_uri,
         .session.keepalive = 60,
+        .outbox.limit = MQTT_OUTBOX_LIMIT,
     };
 
     mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
@@ -257,11 +304,12 @@ esp_err_t app_network_mqtt_publish(const char *topic, const char *data, size_t l
         len = strlen(data);
     }
 
-    int msg_id = esp_mqtt_client_publish(mqtt_client, topic, data, len, 1, 0);
-    if (msg_id < 0)
+    int msg_id = 0;
+    esp_err_t err = mqtt_outbox_publish(mqtt_client, APP_NETWORK_MQTT_STREAM_GENERIC, topic, data, len, 0, &msg_id);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to publish MQTT message");
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "Failed to publish MQTT message: %s", esp_err_to_name(err));
+        return err;
     }
 
     ESP_LOGI(TAG, "Published to topic '%s', msg_id=%d, len=%d", topic, msg_id, len);
@@ -273,6 +321,243 @@ bool app_network_mqtt_is_connected(void)
     return mqtt_connected;
 }
 
+esp_err_t app_network_mqtt_set_policy(app_network_mqtt_stream_t stream, const app_network_mqtt_policy_t *policy)
+{
+    if (stream >= APP_NETWORK_MQTT_STREAM_COUNT || !policy || policy->qos > 2)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return mqtt_outbox_set_policy(stream, policy);
+}
+
+esp_err_t app_network_get_mqtt_outbox_stats(app_network_mqtt_outbox_stats_t *stats)
+{
+    if (!stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mqtt_outbox_get_stats(mqtt_client, stats);
+    stats->outbox_limit = MQTT_OUTBOX_LIMIT;
+    return ESP_OK;
+}
+
+esp_err_t app_network_mqtt_publish_image(const char *topic_prefix, const uint8_t *image_data, size_t image_size,
+                                         const char *meta)
+{
+    if (!topic_prefix || !image_data || image_size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!mqtt_client || !mqtt_connected)
+    {
+        ESP_LOGW(TAG, "MQTT not connected, image not sent");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return mqtt_image_publish(mqtt_client, topic_prefix, image_data, image_size, meta);
+}
+
+esp_err_t app_network_get_mqtt_image_stats(app_network_mqtt_image_stats_t *stats)
+{
+    if (!stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mqtt_image_get_stats(stats);
+    return ESP_OK;
+}
+
+esp_err_t app_network_telemetry_start(const app_network_telemetry_config_t *config, uint8_t *id)
+{
+    if (!config || !config->topic || config->max_bytes < 64 || !id)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return mqtt_telemetry_start(config, id);
+}
+
+esp_err_t app_network_telemetry_add(uint8_t id, const void *item, size_t len)
+{
+    if (!item || len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return mqtt_telemetry_add(id, item, len);
+}
+
+esp_err_t app_network_telemetry_replay(uint8_t id, const void *payload, size_t len, int *msg_id)
+{
+    if (!payload || len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return mqtt_telemetry_replay(id, payload, len, msg_id);
+}
+
+void app_network_telemetry_set_delivery_cb(app_network_telemetry_delivery_cb_t cb, void *ctx)
+{
+    mqtt_telemetry_set_delivery_cb(cb, ctx);
+}
+
+esp_err_t app_network_telemetry_flush(uint8_t id)
+{
+    return mqtt_telemetry_flush(id);
+}
+
+esp_err_t app_network_telemetry_set_batch(uint8_t id, uint8_t max_samples)
+{
+    return mqtt_telemetry_set_batch(id, max_samples);
+}
+
+esp_err_t app_network_get_telemetry_stats(uint8_t id, bool batched, app_network_telemetry_stats_t *stats)
+{
+    if (!stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return mqtt_telemetry_get_stats(id, batched, stats);
+}
+
+// ============================================================================
+// HTTP Request Helpers (pooled keep-alive connections)
+// ============================================================================
+
+typedef struct {
+    const char *url;
+    const char *content_type;
+    const uint8_t *data;
+    size_t len;
+    bool chunked;                     // Chunked transfer encoding instead of Content-Length
+    int timeout_ms;
+    app_network_release_cb_t on_sent; // Invoked once the body is written (or on failure)
+    void *ctx;
+} http_request_t;
+
+static esp_err_t http_write_all(esp_http_client_handle_t client, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        int written = esp_http_client_write(client, data, len);
+        if (written <= 0)
+        {
+            return ESP_FAIL;
+        }
+        data += written;
+        len -= written;
+    }
+    return ESP_OK;
+}
+
+// Write one chunk in HTTP/1.1 chunked framing: <hex size>CRLF<data>CRLF
+static esp_err_t http_write_chunk(esp_http_client_handle_t client, const uint8_t *data, size_t len)
+{
+    char size_line[12];
+    int n = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned int)len);
+
+    if (http_write_all(client, size_line, n) != ESP_OK ||
+        http_write_all(client, (const char *)data, len) != ESP_OK ||
+        http_write_all(client, "\r\n", 2) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t http_send_body(http_pool_conn_t *conn, const http_request_t *req)
+{
+    esp_err_t err = http_pool_open(conn, req->chunked ? -1 : (int)req->len);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    if (!req->chunked)
+    {
+        return http_write_all(conn->client, (const char *)req->data, req->len);
+    }
+
+    for (size_t offset = 0; offset < req->len; offset += UPLOAD_STREAM_CHUNK_SIZE)
+    {
+        size_t len = req->len - offset;
+        if (len > UPLOAD_STREAM_CHUNK_SIZE)
+        {
+            len = UPLOAD_STREAM_CHUNK_SIZE;
+        }
+        if (http_write_chunk(conn->client, req->data + offset, len) != ESP_OK)
+        {
+            return ESP_FAIL;
+        }
+    }
+
+    // Terminating zero-length chunk
+    return http_write_all(conn->client, "0\r\n\r\n", 5);
+}
+
+static esp_err_t http_post(const http_request_t *req, int *status, uint32_t *ttfb_ms)
+{
+    http_pool_conn_t *conn = http_pool_acquire(req->url, req->timeout_ms);
+    if (!conn)
+    {
+        if (req->on_sent)
+        {
+            req->on_sent(req->ctx);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_http_client_set_header(conn->client, "Content-Type", req->content_type);
+
+    // A reused connection may have been closed by the server while idle.
+    // The body is still ours at this point, so retry once on a fresh one.
+    bool reused = conn->connected;
+    esp_err_t err = http_send_body(conn, req);
+    if (err != ESP_OK && reused)
+    {
+        ESP_LOGW(TAG, "Kept-alive connection dropped, reconnecting");
+        http_pool_disconnect(conn);
+        err = http_send_body(conn, req);
+    }
+
+    int64_t sent_us = esp_timer_get_time();
+    if (req->on_sent)
+    {
+        req->on_sent(req->ctx);
+    }
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "HTTP POST failed while sending body");
+        http_pool_release(conn, false);
+        return err;
+    }
+
+    if (esp_http_client_fetch_headers(conn->client) < 0)
+    {
+        ESP_LOGE(TAG, "HTTP POST got no response");
+        http_pool_release(conn, false);
+        return ESP_FAIL;
+    }
+
+    if (ttfb_ms)
+    {
+        *ttfb_ms = (uint32_t)((esp_timer_get_time() - sent_us) / 1000);
+    }
+    *status = esp_http_client_get_status_code(conn->client);
+
+    // Drain the response body so the connection can carry the next request
+    esp_http_client_flush_response(conn->client, NULL);
+    http_pool_release(conn, esp_http_client_is_complete_data_received(conn->client));
+    return ESP_OK;
+}
+
 // ============================================================================
 // HTTP Functions (Legacy)
 // ============================================================================
@@ -290,22 +575,19 @@ esp_err_t app_network_upload_image(const char *url, const uint8_t *image_data, s
         return ESP_ERR_INVALID_STATE;
     }
 
-    esp_http_client_config_t config = {
+    http_request_t req = {
         .url = url,
-        .method = HTTP_METHOD_POST,
+        .content_type = "image/jpeg",
+        .data = image_data,
+        .len = image_size,
         .timeout_ms = 30000,
     };
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-
-    esp_http_client_set_header(client, "Content-Type", "image/jpeg");
-    esp_http_client_set_post_field(client, (const char *)image_data, image_size);
-
-    esp_err_t err = esp_http_client_perform(client);
+    int status = 0;
+    esp_err_t err = http_post(&req, &status, NULL);
 
     if (err == ESP_OK)
     {
-        int status = esp_http_client_get_status_code(client);
         ESP_LOGI(TAG, "Image uploaded, status=%d, size=%zu bytes", status, image_size);
     }
     else
@@ -313,7 +595,6 @@ esp_err_t app_network_upload_image(const char *url, const uint8_t *image_data, s
         ESP_LOGE(TAG, "HTTP POST failed: %s", esp_err_to_name(err));
     }
 
-    esp_http_client_cleanup(client);
     return err;
 }
 
@@ -330,22 +611,19 @@ esp_err_t app_network_upload_json(const char *url, const char *json_data)
         return ESP_ERR_INVALID_STATE;
     }
 
-    esp_http_client_config_t config = {
+    http_request_t req = {
         .url = url,
-        .method = HTTP_METHOD_POST,
+        .content_type = "application/json",
+        .data = (const uint8_t *)json_data,
+        .len = strlen(json_data),
         .timeout_ms = 10000,
     };
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_data, strlen(json_data));
-
-    esp_err_t err = esp_http_client_perform(client);
+    int status = 0;
+    esp_err_t err = http_post(&req, &status, NULL);
 
     if (err == ESP_OK)
     {
-        int status = esp_http_client_get_status_code(client);
         ESP_LOGI(TAG, "JSON uploaded, status=%d", status);
     }
     else
@@ -353,6 +631,594 @@ esp_err_t app_network_upload_json(const char *url, const char *json_data)
         ESP_LOGE(TAG, "HTTP POST failed: %s", esp_err_to_name(err));
     }
 
-    esp_http_client_cleanup(client);
     return err;
 }
+
+esp_err_t app_network_get_http_pool_stats(app_network_http_pool_stats_t *stats)
+{
+    if (!stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    http_pool_get_stats(stats);
+    return ESP_OK;
+}
+
+// ============================================================================
+// HTTP Streaming Upload
+// ============================================================================
+
+// Account one single-image request (streaming or with a record)
+static void upload_stats_add(esp_err_t err, int status, size_t image_size, uint32_t ttfb_ms, int64_t start_us)
+{
+    int64_t end_us = esp_timer_get_time();
+    bool accepted = err == ESP_OK && status >= 200 && status < 300;
+
+    portENTER_CRITICAL(&stats_lock);
+    if (err == ESP_OK)
+    {
+        upload_stats.bytes_sent += image_size;
+        upload_stats.last_ttfb_ms = ttfb_ms;
+    }
+    if (!accepted)
+    {
+        upload_stats.images_failed++;
+    }
+    else
+    {
+        if (upload_first_us == 0)
+        {
+            upload_first_us = end_us;
+        }
+        upload_stats.images_sent++;
+        upload_ttfb_total_ms += ttfb_ms;
+        upload_time_total_us += end_us - start_us;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+esp_err_t app_network_upload_image_stream(const char *url, const uint8_t *image_data, size_t image_size,
+                                          app_network_release_cb_t on_sent, void *ctx)
+{
+    esp_err_t err = ESP_OK;
+    if (!url || !image_data || image_size == 0)
+    {
+        err = ESP_ERR_INVALID_ARG;
+    }
+    else if (current_status != NETWORK_CONNECTED)
+    {
+        ESP_LOGE(TAG, "Not connected to network");
+        err = ESP_ERR_INVALID_STATE;
+    }
+
+    if (err != ESP_OK)
+    {
+        if (on_sent)
+        {
+            on_sent(ctx);
+        }
+        return err;
+    }
+
+    http_request_t req = {
+        .url = url,
+        .content_type = "image/jpeg",
+        .data = image_data,
+        .len = image_size,
+        .chunked = true,
+        .timeout_ms = UPLOAD_STREAM_TIMEOUT_MS,
+        .on_sent = on_sent,
+        .ctx = ctx,
+    };
+
+    int status = 0;
+    uint32_t ttfb_ms = 0;
+    int64_t start_us = esp_timer_get_time();
+    err = http_post(&req, &status, &ttfb_ms);
+    upload_stats_add(err, status, image_size, ttfb_ms, start_us);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    if (status < 200 || status >= 300)
+    {
+        ESP_LOGE(TAG, "Streaming upload rejected, status=%d", status);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Image streamed, status=%d, size=%zu bytes, ttfb=%lu ms",
+             status, image_size, ttfb_ms);
+    return ESP_OK;
+}
+
+esp_err_t app_network_get_upload_stats(app_network_upload_stats_t *stats)
+{
+    if (!stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    *stats = upload_stats;
+    uint64_t ttfb_total_ms = upload_ttfb_total_ms;
+    uint64_t time_total_us = upload_time_total_us;
+    int64_t first_us = upload_first_us;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (stats->images_sent > 0)
+    {
+        stats->avg_ttfb_ms = (uint32_t)(ttfb_total_ms / stats->images_sent);
+        if (time_total_us > 0)
+        {
+            stats->throughput_bps = (uint32_t)(stats->bytes_sent * 1000000 / time_total_us);
+        }
+
+        int64_t elapsed_us = esp_timer_get_time() - first_us;
+        if (elapsed_us > 0)
+        {
+            stats->images_per_minute = stats->images_sent * 60000000.0f / elapsed_us;
+        }
+        stats->avg_image_ms = (uint32_t)(time_total_us / 1000 / stats->images_sent);
+    }
+
+    return ESP_OK;
+}
+
+// ============================================================================
+// HTTP Resumable Upload
+// ============================================================================
+
+// Outcome of one resumable request
+typedef struct {
+    int status;        // HTTP status, 0 if the server never answered
+    int32_t range_end; // Last byte the server holds ("Range" header), -1 if none
+    size_t body_sent;  // Body bytes written before completion or failure
+} resume_reply_t;
+
+// One POST with a Content-Range header: a status query when len is 0,
+// otherwise image bytes [offset, total) in a single Content-Length body
+static esp_err_t resume_request(const char *url, const char *upload_id, const uint8_t *data,
+                                size_t offset, size_t total, bool query, resume_reply_t *reply)
+{
+    char range[48];
+    size_t len = query ? 0 : total - offset;
+    if (query)
+    {
+        snprintf(range, sizeof(range), "bytes */%u", (unsigned int)total);
+    }
+    else
+    {
+        snprintf(range, sizeof(range), "bytes %u-%u/%u",
+                 (unsigned int)offset, (unsigned int)(total - 1), (unsigned int)total);
+    }
+
+    memset(reply, 0, sizeof(*reply));
+    reply->range_end = -1;
+
+    http_pool_conn_t *conn = http_pool_acquire(url, UPLOAD_STREAM_TIMEOUT_MS);
+    if (!conn)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_http_client_set_header(conn->client, "Content-Type", "image/jpeg");
+    esp_http_client_set_header(conn->client, "Content-Range", range);
+    esp_http_client_set_header(conn->client, "Upload-Id", upload_id);
+
+    // As in http_post(): a kept-alive socket may have died while idle
+    bool reused = conn->connected;
+    esp_err_t err = http_pool_open(conn, (int)len);
+    if (err != ESP_OK && reused)
+    {
+        http_pool_disconnect(conn);
+        err = http_pool_open(conn, (int)len);
+    }
+
+    const uint8_t *body = data + offset;
+    while (err == ESP_OK && reply->body_sent < len)
+    {
+        size_t n = len - reply->body_sent;
+        if (n > UPLOAD_STREAM_CHUNK_SIZE)
+        {
+            n = UPLOAD_STREAM_CHUNK_SIZE;
+        }
+        int written = esp_http_client_write(conn->client, (const char *)body + reply->body_sent, n);
+        if (written <= 0)
+        {
+            err = ESP_FAIL;
+            break;
+        }
+        reply->body_sent += written;
+    }
+
+    if (err == ESP_OK && esp_http_client_fetch_headers(conn->client) < 0)
+    {
+        err = ESP_FAIL;
+    }
+
+    bool reusable = false;
+    if (err == ESP_OK)
+    {
+        reply->status = esp_http_client_get_status_code(conn->client);
+        reply->range_end = conn->range_end;
+        esp_http_client_flush_response(conn->client, NULL);
+        reusable = esp_http_client_is_complete_data_received(conn->client);
+    }
+
+    // The handle goes back to the pool for plain requests too
+    esp_http_client_delete_header(conn->client, "Content-Range");
+    esp_http_client_delete_header(conn->client, "Upload-Id");
+    http_pool_release(conn, reusable);
+    return err;
+}
+
+static void resume_stats_add(const app_network_resume_stats_t *run)
+{
+    portENTER_CRITICAL(&stats_lock);
+    resume_stats.uploads += run->uploads;
+    resume_stats.completed += run->completed;
+    resume_stats.failed += run->failed;
+    resume_stats.interrupted += run->interrupted;
+    resume_stats.resumed += run->resumed;
+    resume_stats.bytes_sent += run->bytes_sent;
+    resume_stats.bytes_wasted += run->bytes_wasted;
+    resume_stats.bytes_saved += run->bytes_saved;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+esp_err_t app_network_upload_image_resumable(const char *url, const uint8_t *image_data, size_t image_size)
+{
+    if (!url || !image_data || image_size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (current_status != NETWORK_CONNECTED)
+    {
+        ESP_LOGE(TAG, "Not connected to network");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    char upload_id[24];
+    snprintf(upload_id, sizeof(upload_id), "%08lx-%x",
+             (unsigned long)esp_rom_crc32_le(0, image_data, image_size), (unsigned int)image_size);
+
+    // Counted locally, folded into resume_stats when the upload ends
+    app_network_resume_stats_t run = {.uploads = 1};
+
+    size_t offset = 0;        // Bytes the server holds
+    size_t attempt_end = 0;   // Where the last interrupted request stopped writing
+    bool offset_known = false;
+    bool complete = false;
+    esp_err_t err = ESP_FAIL;
+
+    for (int attempt = 0; attempt < APP_NETWORK_RESUME_MAX_ATTEMPTS && !complete; attempt++)
+    {
+        resume_reply_t reply;
+
+        if (!offset_known)
+        {
+            err = resume_request(url, upload_id, image_data, 0, image_size, true, &reply);
+            if (err != ESP_OK)
+            {
+                vTaskDelay(pdMS_TO_TICKS(RESUME_RETRY_DELAY_MS));
+                continue;
+            }
+            if (reply.status >= 200 && reply.status < 300)
+            {
+                complete = true;
+                break;
+            }
+            if (reply.status != 308)
+            {
+                ESP_LOGE(TAG, "Resumable upload not supported, status=%d", reply.status);
+                err = ESP_ERR_NOT_SUPPORTED;
+                break;
+            }
+
+            offset = (size_t)(reply.range_end + 1);
+            if (attempt_end > offset)
+            {
+                run.bytes_wasted += attempt_end - offset;
+            }
+            if (offset > 0)
+            {
+                run.resumed++;
+                run.bytes_saved += offset;
+                ESP_LOGI(TAG, "Resuming upload %s at %u/%u bytes", upload_id,
+                         (unsigned int)offset, (unsigned int)image_size);
+            }
+            offset_known = true;
+        }
+
+        err = resume_request(url, upload_id, image_data, offset, image_size, false, &reply);
+        run.bytes_sent += reply.body_sent;
+
+        if (err == ESP_OK && reply.status >= 200 && reply.status < 300)
+        {
+            complete = true;
+        }
+        else if (err == ESP_OK && reply.status == 308 && reply.range_end >= 0)
+        {
+            // The server kept part of the body and says where to go on
+            attempt_end = offset + reply.body_sent;
+            offset = (size_t)(reply.range_end + 1);
+            if (attempt_end > offset)
+            {
+                run.bytes_wasted += attempt_end - offset;
+            }
+            attempt_end = 0;
+        }
+        else if (err == ESP_OK && reply.status != 308 && reply.status != 416)
+        {
+            ESP_LOGE(TAG, "Resumable upload rejected, status=%d", reply.status);
+            err = ESP_FAIL;
+            break;
+        }
+        else
+        {
+            // Cut off or out of step: ask the server what it has
+            if (err != ESP_OK)
+            {
+                run.interrupted++;
+                vTaskDelay(pdMS_TO_TICKS(RESUME_RETRY_DELAY_MS));
+            }
+            attempt_end = offset + reply.body_sent;
+            offset_known = false;
+        }
+    }
+
+    if (!complete)
+    {
+        ESP_LOGE(TAG, "Resumable upload %s failed at %u/%u bytes", upload_id,
+                 (unsigned int)offset, (unsigned int)image_size);
+        run.failed++;
+        resume_stats_add(&run);
+        return err == ESP_OK ? ESP_FAIL : err;
+    }
+
+    run.completed++;
+    resume_stats_add(&run);
+    ESP_LOGI(TAG, "Image uploaded (resumable), size=%zu bytes", image_size);
+    return ESP_OK;
+}
+
+esp_err_t app_network_get_resume_stats(app_network_resume_stats_t *stats)
+{
+    if (!stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    *stats = resume_stats;
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
+
+// ============================================================================
+// HTTP Batch Upload
+// ============================================================================
+
+static const char *BATCH_MANIFEST_HEAD = "--" BATCH_BOUNDARY "\r\n"
+                                         "Content-Disposition: form-data; name=\"manifest\"\r\n"
+                                         "Content-Type: application/json\r\n\r\n";
+static const char *BATCH_IMAGE_HEAD = "\r\n--" BATCH_BOUNDARY "\r\n"
+                                      "Content-Disposition: form-data; name=\"image%u\"; filename=\"image%u.jpg\"\r\n"
+                                      "Content-Type: image/jpeg\r\n\r\n";
+static const char *BATCH_TAIL = "\r\n--" BATCH_BOUNDARY "--\r\n";
+
+static esp_err_t batch_send_body(http_pool_conn_t *conn, const app_network_batch_t *batch,
+                                 size_t body_len, uint8_t *chunk)
+{
+    esp_err_t err = http_pool_open(conn, (int)body_len);
+    if (err == ESP_OK)
+    {
+        err = http_write_all(conn->client, BATCH_MANIFEST_HEAD, strlen(BATCH_MANIFEST_HEAD));
+    }
+    if (err == ESP_OK)
+    {
+        err = http_write_all(conn->client, batch->manifest, strlen(batch->manifest));
+    }
+
+    for (uint8_t i = 0; i < batch->count && err == ESP_OK; i++)
+    {
+        char head[160];
+        int n = snprintf(head, sizeof(head), BATCH_IMAGE_HEAD, i, i);
+        err = http_write_all(conn->client, head, n);
+
+        for (size_t offset = 0; offset < batch->len[i] && err == ESP_OK; offset += UPLOAD_STREAM_CHUNK_SIZE)
+        {
+            size_t len = batch->len[i] - offset;
+            if (len > UPLOAD_STREAM_CHUNK_SIZE)
+            {
+                len = UPLOAD_STREAM_CHUNK_SIZE;
+            }
+            err = batch->read(i, offset, chunk, len, batch->ctx);
+            if (err == ESP_OK)
+            {
+                err = http_write_all(conn->client, (const char *)chunk, len);
+            }
+        }
+    }
+
+    if (err == ESP_OK)
+    {
+        err = http_write_all(conn->client, BATCH_TAIL, strlen(BATCH_TAIL));
+    }
+    return err;
+}
+
+// One multipart POST; status and ttfb_ms are set once the server answered
+static esp_err_t multipart_post(const char *url, const app_network_batch_t *batch, size_t *body_len_out,
+                                int *status_out, uint32_t *ttfb_ms)
+{
+    // Exact body size, so the request goes out with Content-Length
+    size_t body_len = strlen(BATCH_MANIFEST_HEAD) + strlen(batch->manifest) + strlen(BATCH_TAIL);
+    for (uint8_t i = 0; i < batch->count; i++)
+    {
+        body_len += snprintf(NULL, 0, BATCH_IMAGE_HEAD, i, i) + batch->len[i];
+    }
+    *body_len_out = body_len;
+
+    uint8_t *chunk = malloc(UPLOAD_STREAM_CHUNK_SIZE);
+    if (!chunk)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    http_pool_conn_t *conn = http_pool_acquire(url, BATCH_TIMEOUT_MS);
+    if (!conn)
+    {
+        free(chunk);
+        return ESP_ERR_NO_MEM;
+    }
+    esp_http_client_set_header(conn->client, "Content-Type", "multipart/form-data; boundary=" BATCH_BOUNDARY);
+
+    bool reused = conn->connected;
+    esp_err_t err = batch_send_body(conn, batch, body_len, chunk);
+    if (err != ESP_OK && reused)
+    {
+        ESP_LOGW(TAG, "Kept-alive connection dropped, reconnecting");
+        http_pool_disconnect(conn);
+        err = batch_send_body(conn, batch, body_len, chunk);
+    }
+    free(chunk);
+
+    int64_t sent_us = esp_timer_get_time();
+    if (err == ESP_OK && esp_http_client_fetch_headers(conn->client) < 0)
+    {
+        err = ESP_FAIL;
+    }
+    if (err == ESP_OK)
+    {
+        *ttfb_ms = (uint32_t)((esp_timer_get_time() - sent_us) / 1000);
+        *status_out = esp_http_client_get_status_code(conn->client);
+        esp_http_client_flush_response(conn->client, NULL);
+    }
+    http_pool_release(conn, err == ESP_OK && esp_http_client_is_complete_data_received(conn->client));
+    return err;
+}
+
+esp_err_t app_network_upload_batch(const char *url, const app_network_batch_t *batch)
+{
+    if (!url || !batch || !batch->manifest || !batch->read ||
+        batch->count == 0 || batch->count > APP_NETWORK_BATCH_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (current_status != NETWORK_CONNECTED)
+    {
+        ESP_LOGE(TAG, "Not connected to network");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t images_len = 0;
+    for (uint8_t i = 0; i < batch->count; i++)
+    {
+        images_len += batch->len[i];
+    }
+
+    size_t body_len = 0;
+    int status = 0;
+    uint32_t ttfb_ms = 0;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = multipart_post(url, batch, &body_len, &status, &ttfb_ms);
+    if (err == ESP_OK && (status < 200 || status >= 300))
+    {
+        ESP_LOGE(TAG, "Batch upload rejected, status=%d", status);
+        err = ESP_FAIL;
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Batch upload of %u images failed: %s", batch->count, esp_err_to_name(err));
+        portENTER_CRITICAL(&stats_lock);
+        batch_stats.batches_failed++;
+        portEXIT_CRITICAL(&stats_lock);
+        return err;
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    portENTER_CRITICAL(&stats_lock);
+    batch_stats.batches++;
+    batch_stats.images += batch->count;
+    batch_stats.bytes_sent += body_len;
+    batch_time_total_us += elapsed_us;
+    portEXIT_CRITICAL(&stats_lock);
+
+    ESP_LOGI(TAG, "Batch uploaded, status=%d, %u images, %zu image bytes, body %zu bytes",
+             status, batch->count, images_len, body_len);
+    return ESP_OK;
+}
+
+static esp_err_t image_read(uint8_t index, size_t offset, uint8_t *buf, size_t len, void *ctx)
+{
+    memcpy(buf, (const uint8_t *)ctx + offset, len);
+    return ESP_OK;
+}
+
+esp_err_t app_network_upload_image_record(const char *url, const char *record, const uint8_t *image_data,
+                                          size_t image_size)
+{
+    if (!url || !record || !image_data || image_size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (current_status != NETWORK_CONNECTED)
+    {
+        ESP_LOGE(TAG, "Not connected to network");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    app_network_batch_t single = {
+        .manifest = record,
+        .count = 1,
+        .len = {image_size},
+        .read = image_read,
+        .ctx = (void *)image_data,
+    };
+    size_t body_len = 0;
+    int status = 0;
+    uint32_t ttfb_ms = 0;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = multipart_post(url, &single, &body_len, &status, &ttfb_ms);
+    upload_stats_add(err, status, image_size, ttfb_ms, start_us);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Image upload with record failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (status < 200 || status >= 300)
+    {
+        ESP_LOGE(TAG, "Image upload with record rejected, status=%d", status);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Image uploaded with record, status=%d, size=%zu bytes, ttfb=%lu ms", status, image_size,
+             ttfb_ms);
+    return ESP_OK;
+}
+
+esp_err_t app_network_get_batch_stats(app_network_batch_stats_t *stats)
+{
+    if (!stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    *stats = batch_stats;
+    uint64_t time_total_us = batch_time_total_us;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (stats->images > 0)
+    {
+        stats->requests_per_image = (float)stats->batches / stats->images;
+        stats->avg_image_ms = (uint32_t)(time_total_us / 1000 / stats->images);
+    }
+    return ESP_OK;
+}
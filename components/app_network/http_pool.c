@@ -0,0 +1,314 @@
+/**
+ * @file http_pool.c
+ * @brief Keep-alive HTTP connection pool implementation
+ *
+ * Each esp_http_client handle keeps its socket (and TLS session) open between
+ * requests, so only the first request to a host pays for DNS, TCP and TLS.
+ */
+
+#include "http_pool.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "HTTP_POOL";
+
+static http_pool_conn_t pool[HTTP_POOL_SIZE] = {0};
+static SemaphoreHandle_t pool_mutex = NULL;
+static portMUX_TYPE pool_init_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Statistics: updated by every uploading task, partly outside pool_mutex
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t stat_requests = 0;
+static uint32_t stat_reused = 0;
+static uint32_t stat_connections = 0;
+static uint32_t stat_idle_closed = 0;
+static uint32_t stat_health_failures = 0;
+static uint64_t stat_handshake_us = 0;
+
+// Extract "scheme://host:port" from a URL
+static bool url_to_key(const char *url, char *key, size_t key_size)
+{
+    const char *host = strstr(url, "://");
+    if (!host)
+    {
+        return false;
+    }
+    host += 3;
+
+    size_t len = (host - url) + strcspn(host, "/?#");
+    if (len >= key_size)
+    {
+        return false;
+    }
+
+    memcpy(key, url, len);
+    key[len] = '\0';
+    return true;
+}
+
+// Watch response headers for "Connection: close" and resumable upload ranges
+static esp_err_t pool_http_event_handler(esp_http_client_event_t *evt)
+{
+    http_pool_conn_t *conn = (http_pool_conn_t *)evt->user_data;
+
+    if (evt->event_id == HTTP_EVENT_ON_HEADER &&
+        strcasecmp(evt->header_key, "Connection") == 0 &&
+        strcasecmp(evt->header_value, "close") == 0)
+    {
+        conn->server_close = true;
+    }
+    else if (evt->event_id == HTTP_EVENT_ON_HEADER &&
+             strcasecmp(evt->header_key, "Range") == 0 &&
+             strncmp(evt->header_value, "bytes=0-", 8) == 0)
+    {
+        conn->range_end = (int32_t)strtol(evt->header_value + 8, NULL, 10);
+    }
+    else if (evt->event_id == HTTP_EVENT_DISCONNECTED)
+    {
+        conn->connected = false;
+    }
+    return ESP_OK;
+}
+
+static void pool_close(http_pool_conn_t *conn)
+{
+    if (conn->client && conn->connected)
+    {
+        esp_http_client_close(conn->client);
+    }
+    conn->connected = false;
+    conn->server_close = false;
+}
+
+static void pool_destroy(http_pool_conn_t *conn)
+{
+    pool_close(conn);
+    if (conn->client)
+    {
+        esp_http_client_cleanup(conn->client);
+    }
+    memset(conn, 0, sizeof(*conn));
+}
+
+// Health check: drop idle connections before the server does it for us
+static void pool_sweep(int64_t now_us)
+{
+    for (int i = 0; i < HTTP_POOL_SIZE; i++)
+    {
+        http_pool_conn_t *conn = &pool[i];
+        if (!conn->in_use && conn->connected &&
+            now_us - conn->last_used_us > (int64_t)HTTP_POOL_IDLE_TIMEOUT_MS * 1000)
+        {
+            ESP_LOGD(TAG, "Closing idle connection to %s", conn->key);
+            pool_close(conn);
+            portENTER_CRITICAL(&stats_lock);
+            stat_idle_closed++;
+            portEXIT_CRITICAL(&stats_lock);
+        }
+    }
+}
+
+http_pool_conn_t *http_pool_acquire(const char *url, int timeout_ms)
+{
+    char key[HTTP_POOL_KEY_MAX];
+    if (!url || !url_to_key(url, key, sizeof(key)))
+    {
+        ESP_LOGE(TAG, "Unsupported URL");
+        return NULL;
+    }
+
+    if (!pool_mutex)
+    {
+        portENTER_CRITICAL(&pool_init_lock);
+        if (!pool_mutex)
+        {
+            pool_mutex = xSemaphoreCreateMutex();
+        }
+        portEXIT_CRITICAL(&pool_init_lock);
+    }
+
+    xSemaphoreTake(pool_mutex, portMAX_DELAY);
+
+    int64_t now_us = esp_timer_get_time();
+    pool_sweep(now_us);
+
+    // Prefer an idle connection to the same host, else an empty slot,
+    // else evict the least recently used idle connection.
+    http_pool_conn_t *conn = NULL;
+    http_pool_conn_t *empty = NULL;
+    http_pool_conn_t *lru = NULL;
+    for (int i = 0; i < HTTP_POOL_SIZE; i++)
+    {
+        http_pool_conn_t *c = &pool[i];
+        if (c->in_use)
+        {
+            continue;
+        }
+        if (c->client && strcmp(c->key, key) == 0)
+        {
+            conn = c;
+            break;
+        }
+        if (!c->client)
+        {
+            if (!empty)
+            {
+                empty = c;
+            }
+        }
+        else if (!lru || c->last_used_us < lru->last_used_us)
+        {
+            lru = c;
+        }
+    }
+
+    if (!conn)
+    {
+        conn = empty;
+        if (!conn && lru)
+        {
+            pool_destroy(lru);
+            conn = lru;
+        }
+        if (!conn)
+        {
+            xSemaphoreGive(pool_mutex);
+            ESP_LOGW(TAG, "All %d connections busy", HTTP_POOL_SIZE);
+            return NULL;
+        }
+
+        esp_http_client_config_t config = {
+            .url = url,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = timeout_ms,
+            .keep_alive_enable = true,
+            .event_handler = pool_http_event_handler,
+            .user_data = conn,
+        };
+        conn->client = esp_http_client_init(&config);
+        if (!conn->client)
+        {
+            xSemaphoreGive(pool_mutex);
+            ESP_LOGE(TAG, "Failed to create HTTP client for %s", key);
+            return NULL;
+        }
+        strcpy(conn->key, key);
+    }
+    else
+    {
+        esp_http_client_set_url(conn->client, url);
+        esp_http_client_set_method(conn->client, HTTP_METHOD_POST);
+        esp_http_client_set_timeout_ms(conn->client, timeout_ms);
+    }
+
+    // Clear anything a previous request left on the handle
+    esp_http_client_set_post_field(conn->client, NULL, 0);
+
+    conn->in_use = true;
+    conn->server_close = false;
+    conn->range_end = -1;
+    xSemaphoreGive(pool_mutex);
+    return conn;
+}
+
+esp_err_t http_pool_open(http_pool_conn_t *conn, int write_len)
+{
+    bool fresh = !conn->connected;
+    int64_t start_us = esp_timer_get_time();
+
+    esp_err_t err = esp_http_client_open(conn->client, write_len);
+    if (err != ESP_OK)
+    {
+        conn->connected = false;
+        return err;
+    }
+
+    // DNS + TCP connect + TLS handshake all happen inside open()
+    int64_t handshake_us = esp_timer_get_time() - start_us;
+    portENTER_CRITICAL(&stats_lock);
+    stat_requests++;
+    if (fresh)
+    {
+        stat_handshake_us += handshake_us;
+        stat_connections++;
+    }
+    else
+    {
+        stat_reused++;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (fresh)
+    {
+        conn->connected = true;
+        ESP_LOGD(TAG, "Connected to %s in %lld ms", conn->key, handshake_us / 1000);
+    }
+    return ESP_OK;
+}
+
+void http_pool_disconnect(http_pool_conn_t *conn)
+{
+    if (conn->connected)
+    {
+        portENTER_CRITICAL(&stats_lock);
+        stat_health_failures++;
+        portEXIT_CRITICAL(&stats_lock);
+    }
+    pool_close(conn);
+}
+
+void http_pool_release(http_pool_conn_t *conn, bool ok)
+{
+    if (!conn)
+    {
+        return;
+    }
+
+    xSemaphoreTake(pool_mutex, portMAX_DELAY);
+
+    if (!ok || conn->server_close)
+    {
+        http_pool_disconnect(conn);
+    }
+    conn->last_used_us = esp_timer_get_time();
+    conn->in_use = false;
+
+    xSemaphoreGive(pool_mutex);
+}
+
+void http_pool_get_stats(app_network_http_pool_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    portENTER_CRITICAL(&stats_lock);
+    stats->requests = stat_requests;
+    stats->reused = stat_reused;
+    stats->connections_opened = stat_connections;
+    stats->idle_closed = stat_idle_closed;
+    stats->health_failures = stat_health_failures;
+    uint64_t handshake_us = stat_handshake_us;
+    portEXIT_CRITICAL(&stats_lock);
+
+    stats->handshake_ms_total = (uint32_t)(handshake_us / 1000);
+    if (stats->connections_opened > 0)
+    {
+        stats->handshake_ms_avg = (uint32_t)(handshake_us / 1000 / stats->connections_opened);
+    }
+    if (stats->requests > 0)
+    {
+        stats->handshake_ms_amortised = (float)handshake_us / 1000.0f / stats->requests;
+    }
+
+    for (int i = 0; i < HTTP_POOL_SIZE; i++)
+    {
+        if (pool[i].connected)
+        {
+            stats->open_connections++;
+        }
+    }
+}
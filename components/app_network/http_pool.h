@@ -0,0 +1,72 @@
+/**
+ * @file http_pool.h
+ * @brief Keep-alive HTTP connection pool (private to app_network)
+ */
+
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include "app_network.h"
+#include "esp_http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_POOL_SIZE 4
+#define HTTP_POOL_KEY_MAX 96
+#define HTTP_POOL_IDLE_TIMEOUT_MS 30000
+
+/**
+ * @brief One pooled connection, keyed by scheme://host:port
+ */
+typedef struct {
+    esp_http_client_handle_t client;
+    char key[HTTP_POOL_KEY_MAX];
+    bool in_use;
+    bool connected;    // Socket believed to be open
+    bool server_close; // Server answered with "Connection: close"
+    int32_t range_end; // Last byte of a "Range: bytes=0-N" response header, -1 if none
+    int64_t last_used_us;
+} http_pool_conn_t;
+
+/**
+ * @brief Take a connection for the URL's host, reusing a kept-alive one if possible
+ * @param url Request URL
+ * @param timeout_ms Socket timeout for this request
+ * @return Connection, NULL if the pool is exhausted or the client cannot be created
+ */
+http_pool_conn_t *http_pool_acquire(const char *url, int timeout_ms);
+
+/**
+ * @brief Open the request, connecting (and timing the handshake) if needed
+ * @param conn Pooled connection
+ * @param write_len Body length, -1 for chunked transfer encoding
+ * @return ESP_OK on success
+ */
+esp_err_t http_pool_open(http_pool_conn_t *conn, int write_len);
+
+/**
+ * @brief Close the socket of a connection after a failed request
+ * @param conn Pooled connection
+ */
+void http_pool_disconnect(http_pool_conn_t *conn);
+
+/**
+ * @brief Hand a connection back to the pool
+ * @param conn Pooled connection
+ * @param ok true if the request completed and the connection may be reused
+ */
+void http_pool_release(http_pool_conn_t *conn, bool ok);
+
+/**
+ * @brief Get pool statistics
+ * @param stats Pointer to statistics structure
+ */
+void http_pool_get_stats(app_network_http_pool_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_POOL_H
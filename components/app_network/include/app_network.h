@@ -64,11 +64,12 @@ esp_err_t app_network_get_ip(char *ip_str);
 esp_err_t app_network_mqtt_init(const char *broker_uri);
 
 /**
- * @brief Publish data to MQTT topic
+ * @brief Publish data to MQTT topic (generic stream policy)
  * @param topic Topic string
  * @param data Data payload (JSON string or binary)
  * @param len Length of data (0 = use strlen)
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the stream's outbox budget is used up,
+ *         ESP_ERR_TIMEOUT if its inflight window is full
  */
 esp_err_t app_network_mqtt_publish(const char *topic, const char *data, size_t len);
 
@@ -78,6 +79,247 @@ esp_err_t app_network_mqtt_publish(const char *topic, const char *data, size_t l
  */
 bool app_network_mqtt_is_connected(void);
 
+/**
+ * @brief Publishing streams, each with its own policy
+ */
+typedef enum {
+    APP_NETWORK_MQTT_STREAM_GENERIC = 0, // app_network_mqtt_publish()
+    APP_NETWORK_MQTT_STREAM_TELEMETRY,   // Live telemetry messages
+    APP_NETWORK_MQTT_STREAM_REPLAY,      // Telemetry replayed from the journal
+    APP_NETWORK_MQTT_STREAM_IMAGE,       // Image meta and chunk messages
+    APP_NETWORK_MQTT_STREAM_COUNT,
+} app_network_mqtt_stream_t;
+
+/**
+ * @brief How a stream publishes and how much of the outbox it may occupy
+ *
+ * QoS 1/2 messages stay in the client outbox until acknowledged. A stream
+ * with max_inflight unacknowledged messages, or whose unacknowledged
+ * messages hold outbox_limit bytes, does not enqueue more: image chunks wait
+ * for a PUBACK, everything else fails at once (telemetry then goes to its
+ * fallback). Budgets are per stream; keep their sum below the client-wide
+ * outbox limit so that no stream can fill another's share.
+ */
+typedef struct {
+    uint8_t qos;                     // 0, 1 or 2
+    bool retain;
+    uint8_t max_inflight;            // Unacknowledged messages of this stream (0 = no limit)
+    size_t outbox_limit;             // Enqueue only while this stream's outbox bytes stay below (0 = no limit)
+} app_network_mqtt_policy_t;
+
+/**
+ * @brief Per-stream outbox statistics
+ */
+typedef struct {
+    uint32_t published;              // Messages handed to the client
+    uint32_t acked;                  // PUBACKs received
+    uint32_t evicted;                // Expired from the outbox without a PUBACK
+    uint32_t rejected;               // Not enqueued: outbox budget or client outbox limit reached
+    uint32_t window_full;            // Publishes that found the inflight window full
+    uint16_t inflight;               // Unacknowledged messages now
+    uint16_t inflight_peak;
+    uint32_t outbox_bytes;           // Payload bytes of those messages
+    uint32_t outbox_peak_bytes;
+} app_network_mqtt_stream_stats_t;
+
+/**
+ * @brief MQTT outbox statistics
+ */
+typedef struct {
+    app_network_mqtt_stream_stats_t streams[APP_NETWORK_MQTT_STREAM_COUNT];
+    uint32_t outbox_bytes;           // Bytes in the client outbox now
+    uint32_t outbox_peak_bytes;      // Highest value seen
+    uint32_t outbox_limit;           // Client-wide outbox limit
+} app_network_mqtt_outbox_stats_t;
+
+/**
+ * @brief Set a stream's publish policy (may be called before app_network_mqtt_init)
+ * @param stream Stream to configure
+ * @param policy New policy; applies to the next publish
+ * @return ESP_OK on success
+ */
+esp_err_t app_network_mqtt_set_policy(app_network_mqtt_stream_t stream, const app_network_mqtt_policy_t *policy);
+
+/**
+ * @brief Get MQTT outbox occupancy and per-stream statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t app_network_get_mqtt_outbox_stats(app_network_mqtt_outbox_stats_t *stats);
+
+/**
+ * @brief MQTT image transport statistics
+ */
+typedef struct {
+    uint32_t images_sent;     // Images published
+    uint32_t images_acked;    // Images confirmed complete by the receiver
+    uint32_t chunks_sent;     // Chunks published (including resends)
+    uint32_t chunks_resent;   // Chunks published again on request
+    uint64_t bytes_sent;      // Chunk payload bytes published
+    uint32_t last_image_ms;   // Publish-to-confirmation time of the last image
+    uint32_t throughput_bps;  // Image bytes per second over confirmed images
+} app_network_mqtt_image_stats_t;
+
+/**
+ * @brief Publish an image as a sequence of MQTT chunks
+ *
+ * Chunks are published directly from image_data under the image stream
+ * policy (QoS 1 with a few unacknowledged chunks in flight by default).
+ * Topics are <prefix>/<id>/meta and <prefix>/<id>/<seq>/<total>/<crc32>. The receiver confirms on
+ * <prefix>/ack with "<id> OK" or requests chunks again with
+ * "<id> R <seq> ...". Blocks until confirmed; image_data must stay valid.
+ *
+ * @param topic_prefix Topic prefix (e.g. "train/image/ESP32_Train_01")
+ * @param image_data Pointer to image data
+ * @param image_size Size of image data
+ * @param meta Extra JSON members appended to the meta message (e.g. "\"event\":7"), NULL for none
+ * @return ESP_OK once the receiver confirmed the image, ESP_ERR_TIMEOUT if it did not answer
+ */
+esp_err_t app_network_mqtt_publish_image(const char *topic_prefix, const uint8_t *image_data, size_t image_size,
+                                         const char *meta);
+
+/**
+ * @brief Get MQTT image transport statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t app_network_get_mqtt_image_stats(app_network_mqtt_image_stats_t *stats);
+
+// ============================================================================
+// Telemetry Batching (several samples per MQTT message)
+// ============================================================================
+
+#define APP_NETWORK_TELEMETRY_TOPICS 2 // Telemetry topics (batchers) that can run at once
+
+/**
+ * @brief Encoding of the samples handed to app_network_telemetry_add()
+ */
+typedef enum {
+    APP_NETWORK_TELEMETRY_JSON = 0,  // JSON objects; a batch is a JSON array
+    APP_NETWORK_TELEMETRY_CBOR,      // CBOR items; a batch is an indefinite-length CBOR array
+} app_network_telemetry_format_t;
+
+/**
+ * @brief Takes over a message that could not be published (e.g. to a flash journal)
+ *
+ * Also gets published messages the outbox evicted before their PUBACK; those
+ * may have reached the broker, so a replay can duplicate them.
+ * @param id Batcher the message came from; pass it to app_network_telemetry_replay()
+ * @return ESP_OK if the message was kept; it then does not count as dropped
+ */
+typedef esp_err_t (*app_network_telemetry_fallback_cb_t)(uint8_t id, const void *payload, size_t len,
+                                                         void *ctx);
+
+/**
+ * @brief Outcome of a QoS 1/2 message: acknowledged (delivered) or evicted from the outbox
+ *
+ * Runs on the MQTT task; must not block or publish.
+ */
+typedef void (*app_network_telemetry_delivery_cb_t)(int msg_id, bool delivered, void *ctx);
+
+/**
+ * @brief Telemetry batching configuration
+ */
+typedef struct {
+    const char *topic;               // Telemetry topic
+    app_network_telemetry_format_t format; // Sample encoding published on this topic
+    uint8_t max_samples;             // Flush after this many samples (1 = one message per sample)
+    size_t max_bytes;                // Flush before the payload would grow past this
+    uint32_t max_age_ms;             // Flush when the oldest buffered sample is this old
+    app_network_telemetry_fallback_cb_t fallback; // Offline messages go here (NULL = drop them)
+    void *fallback_ctx;              // Passed to fallback
+} app_network_telemetry_config_t;
+
+/**
+ * @brief Telemetry statistics (kept separately for single and batched publishing)
+ */
+typedef struct {
+    uint32_t messages;               // MQTT messages published
+    uint32_t samples;                // Samples carried by them
+    uint64_t bytes;                  // Payload bytes published
+    uint32_t dropped;                // Samples lost (not connected or publish failed)
+    uint32_t deferred;               // Samples handed to the fallback instead
+    uint32_t requeued;               // Published samples evicted from the outbox, handed to the fallback
+    uint32_t flush_count;            // Flushes because max_samples was reached
+    uint32_t flush_bytes;            // Flushes because max_bytes would be exceeded
+    uint32_t flush_age;              // Flushes because the oldest sample reached max_age_ms
+    float messages_per_s;            // Messages per second while in this mode
+    uint32_t bytes_per_sample;       // Payload bytes per sample
+    uint32_t acked;                  // PUBACKs received
+    uint32_t ack_avg_ms;             // Publish-to-PUBACK latency
+    uint32_t ack_max_ms;
+} app_network_telemetry_stats_t;
+
+/**
+ * @brief Start a telemetry batcher for one topic
+ *
+ * Samples are buffered and published as one array under the telemetry
+ * stream policy; each sample carries its own timestamp. A background task flushes a batch that reaches
+ * max_age_ms before it fills up. Each topic gets its own batcher with its
+ * own format, limits and statistics, up to APP_NETWORK_TELEMETRY_TOPICS.
+ *
+ * @param config Batching configuration
+ * @param id Receives the batcher id used by the calls below
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if every batcher is taken
+ */
+esp_err_t app_network_telemetry_start(const app_network_telemetry_config_t *config, uint8_t *id);
+
+/**
+ * @brief Add a sample
+ * @param id Batcher
+ * @param item One encoded sample in the batcher's format (JSON object or CBOR map)
+ * @param len Sample size in bytes
+ * @return ESP_OK if buffered or published, an error if this call flushed and
+ *         the publish failed (the batch is then dropped)
+ */
+esp_err_t app_network_telemetry_add(uint8_t id, const void *item, size_t len);
+
+/**
+ * @brief Publish a message the fallback kept earlier, unchanged, on its batcher's topic
+ * @param id Batcher the fallback was called for
+ * @param payload Message as passed to the fallback
+ * @param len Message size
+ * @param msg_id Receives the message id whose outcome the delivery callback reports
+ *               (0 for QoS 0: nothing will be reported), may be NULL
+ * @return ESP_OK once queued (replay stream policy), ESP_ERR_INVALID_STATE while not connected,
+ *         ESP_ERR_NOT_FOUND if no such batcher runs
+ */
+esp_err_t app_network_telemetry_replay(uint8_t id, const void *payload, size_t len, int *msg_id);
+
+/**
+ * @brief Get told when replayed messages are acknowledged or evicted
+ *
+ * The callback sees every QoS 1/2 message id the client completes, replayed
+ * or not; ids that app_network_telemetry_replay() did not return are to be ignored.
+ *
+ * @param cb Callback (NULL = none)
+ * @param ctx Passed to cb
+ */
+void app_network_telemetry_set_delivery_cb(app_network_telemetry_delivery_cb_t cb, void *ctx);
+
+/**
+ * @brief Publish a batcher's buffered samples now
+ * @return ESP_OK on success (also when nothing was buffered)
+ */
+esp_err_t app_network_telemetry_flush(uint8_t id);
+
+/**
+ * @brief Change a batcher's batch size at run time (flushes what is buffered first)
+ * @param id Batcher
+ * @param max_samples New limit (1 = one message per sample)
+ * @return ESP_OK on success
+ */
+esp_err_t app_network_telemetry_set_batch(uint8_t id, uint8_t max_samples);
+
+/**
+ * @brief Get telemetry statistics
+ * @param id Batcher
+ * @param batched true for batched publishing (max_samples > 1), false for single samples
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if no such batcher runs
+ */
+esp_err_t app_network_get_telemetry_stats(uint8_t id, bool batched, app_network_telemetry_stats_t *stats);
+
 // ============================================================================
 // HTTP Functions (Legacy - for HTTP upload)
 // ============================================================================
@@ -99,6 +341,202 @@ esp_err_t app_network_upload_image(const char *url, const uint8_t *image_data, s
  */
 esp_err_t app_network_upload_json(const char *url, const char *json_data);
 
+/**
+ * @brief HTTP connection pool statistics
+ * Connections are kept alive per host (scheme://host:port) and shared by all
+ * HTTP uploads, so the handshake cost is amortised over many requests.
+ */
+typedef struct {
+    uint32_t requests;              // Requests sent through the pool
+    uint32_t reused;                // Requests that reused a kept-alive connection
+    uint32_t connections_opened;    // New connections (DNS + TCP + TLS handshake)
+    uint32_t idle_closed;           // Connections closed after the idle timeout
+    uint32_t health_failures;       // Connections dropped after an error or server close
+    uint32_t open_connections;      // Connections currently open
+    uint32_t handshake_ms_total;    // Total time spent connecting
+    uint32_t handshake_ms_avg;      // Handshake time per new connection
+    float handshake_ms_amortised;   // Handshake time per request
+} app_network_http_pool_stats_t;
+
+/**
+ * @brief Get HTTP connection pool statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t app_network_get_http_pool_stats(app_network_http_pool_stats_t *stats);
+
+// ============================================================================
+// HTTP Streaming Upload
+// ============================================================================
+
+/**
+ * @brief Called once the last byte of an image body has been written
+ * Used to hand the source buffer (e.g. a camera frame buffer) back early,
+ * before the server response has been received.
+ * @param ctx User context given to app_network_upload_image_stream
+ */
+typedef void (*app_network_release_cb_t)(void *ctx);
+
+/**
+ * @brief Image upload statistics (single-image requests: streaming, or with a record)
+ */
+typedef struct {
+    uint32_t images_sent;        // Uploads answered with a 2xx status
+    uint32_t images_failed;      // Uploads that failed or got a non-2xx status
+    uint64_t bytes_sent;         // Image payload bytes written
+    uint32_t last_ttfb_ms;       // Time to first byte of the last response
+    uint32_t avg_ttfb_ms;        // Average time to first byte
+    float images_per_minute;     // Successful uploads per minute since the first upload
+    uint32_t throughput_bps;     // Image bytes per second over successful uploads
+    uint32_t avg_image_ms;       // Request time per successful image
+} app_network_upload_stats_t;
+
+/**
+ * @brief Upload image data via a streaming HTTP POST
+ *
+ * The body is sent with chunked transfer encoding straight from image_data
+ * over a persistent keep-alive connection that is reused by later calls.
+ * on_sent is always invoked exactly once: right after the body has been
+ * written, or on failure, so the caller can release the buffer early.
+ *
+ * @param url Target URL
+ * @param image_data Pointer to image data (e.g. camera_fb_t->buf)
+ * @param image_size Size of image data
+ * @param on_sent Release callback (may be NULL)
+ * @param ctx Context passed to on_sent
+ * @return ESP_OK if the server answered with a 2xx status
+ */
+esp_err_t app_network_upload_image_stream(const char *url, const uint8_t *image_data, size_t image_size,
+                                          app_network_release_cb_t on_sent, void *ctx);
+
+/**
+ * @brief Get streaming upload statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t app_network_get_upload_stats(app_network_upload_stats_t *stats);
+
+// ============================================================================
+// HTTP Resumable Upload
+// ============================================================================
+
+#define APP_NETWORK_RESUME_MAX_ATTEMPTS 6
+
+/**
+ * @brief Resumable upload statistics
+ */
+typedef struct {
+    uint32_t uploads;            // Resumable uploads started
+    uint32_t completed;          // Uploads the server confirmed complete
+    uint32_t failed;             // Uploads given up after all attempts
+    uint32_t interrupted;        // Requests cut off before the server answered
+    uint32_t resumed;            // Uploads continued from a non-zero offset
+    uint64_t bytes_sent;         // Body bytes written, including bytes sent again
+    uint64_t bytes_wasted;       // Bytes written that the server did not keep
+    uint64_t bytes_saved;        // Bytes not sent again because the server already had them
+} app_network_resume_stats_t;
+
+/**
+ * @brief Upload image data so that an interrupted transfer continues where it stopped
+ *
+ * Every request carries an Upload-Id header derived from the image CRC and
+ * size, so a later call with the same image resumes as well. The server is
+ * first asked how much it holds with an empty POST whose Content-Range
+ * carries only the total size; it answers 308 with "Range: bytes=0-<last>"
+ * (or 2xx if it already has everything). The rest is then sent with
+ * "Content-Range: bytes <first>-<last>/<total>".
+ * After a dropped connection the offset is queried again and the upload
+ * continues from there, up to APP_NETWORK_RESUME_MAX_ATTEMPTS requests.
+ * See tools/mock_upload_server.py for a reference server.
+ *
+ * @param url Target URL
+ * @param image_data Pointer to image data
+ * @param image_size Size of image data
+ * @return ESP_OK once the server confirmed the complete image
+ */
+esp_err_t app_network_upload_image_resumable(const char *url, const uint8_t *image_data, size_t image_size);
+
+/**
+ * @brief Get resumable upload statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t app_network_get_resume_stats(app_network_resume_stats_t *stats);
+
+// ============================================================================
+// HTTP Batch Upload
+// ============================================================================
+
+#define APP_NETWORK_BATCH_MAX 8
+
+/**
+ * @brief Source of batch image data
+ * Fills buf with bytes [offset, offset + len) of image index.
+ */
+typedef esp_err_t (*app_network_batch_read_cb_t)(uint8_t index, size_t offset, uint8_t *buf, size_t len,
+                                                 void *ctx);
+
+/**
+ * @brief One multipart batch: a JSON manifest and up to APP_NETWORK_BATCH_MAX images
+ */
+typedef struct {
+    const char *manifest;             // JSON manifest, sent first as part "manifest"
+    uint8_t count;                    // Images in the batch
+    size_t len[APP_NETWORK_BATCH_MAX]; // Size of each image
+    app_network_batch_read_cb_t read; // Streams image data
+    void *ctx;                        // Passed to read
+} app_network_batch_t;
+
+/**
+ * @brief Batch upload statistics
+ */
+typedef struct {
+    uint32_t batches;            // Batch requests answered with a 2xx status
+    uint32_t batches_failed;     // Batch requests that failed or got a non-2xx status
+    uint32_t images;             // Images delivered in batches
+    uint64_t bytes_sent;         // Request body bytes written (images + manifest + framing)
+    float requests_per_image;    // Successful batch requests per delivered image
+    uint32_t avg_image_ms;       // Request time per delivered image
+} app_network_batch_stats_t;
+
+/**
+ * @brief Upload several images and a manifest in one multipart/form-data POST
+ *
+ * Parts are "manifest" (application/json) followed by "image0".."imageN-1"
+ * (image/jpeg). The body length is known up front, so it is sent with a
+ * Content-Length over a pooled keep-alive connection. Image data is pulled
+ * through batch->read in 4 KB pieces, so the body is
+ * never assembled in memory.
+ *
+ * @param url Target URL
+ * @param batch Manifest, image sizes and data source
+ * @return ESP_OK if the server answered with a 2xx status
+ */
+esp_err_t app_network_upload_batch(const char *url, const app_network_batch_t *batch);
+
+/**
+ * @brief Get batch upload statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t app_network_get_batch_stats(app_network_batch_stats_t *stats);
+
+/**
+ * @brief Upload one image together with a JSON record describing it
+ *
+ * Same multipart layout as a one-image batch: the record is part
+ * "manifest", the image "image0". Counted in the streaming upload
+ * statistics (app_network_get_upload_stats), not the batch statistics.
+ *
+ * @param url Target URL
+ * @param record JSON record
+ * @param image_data Pointer to image data
+ * @param image_size Size of image data
+ * @return ESP_OK if the server answered with a 2xx status
+ */
+esp_err_t app_network_upload_image_record(const char *url, const char *record, const uint8_t *image_data,
+                                          size_t image_size);
+
 #ifdef __cplusplus
 }
 #endif
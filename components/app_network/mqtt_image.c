@@ -0,0 +1,329 @@
+/**
+ * @file mqtt_image.c
+ * @brief Chunked image transport over MQTT
+ *
+ * Wire format (QoS and inflight window from the image stream policy, QoS 1 by default):
+ *   <prefix>/<id>/meta                   {"len":N,"chunks":T,"chunkSize":S,"crc":"xxxxxxxx",...}
+ *   <prefix>/<id>/<seq>/<total>/<crc32>  raw JPEG bytes of chunk <seq>
+ *
+ * The chunk header lives in the topic, so each payload is published directly
+ * from the caller's buffer without building a header+data copy. The receiver
+ * answers on <prefix>/ack with "<id> OK" or "<id> R <seq> <seq> ..." to
+ * request specific chunks again.
+ */
+
+#include "mqtt_image.h"
+#include "mqtt_outbox.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "MQTT_IMAGE";
+
+#define TOPIC_MAX 96
+#define META_MAX 768 // Room for a camera snapshot record
+
+#define ACK_OK_BIT BIT0
+#define ACK_RESEND_BIT BIT1
+
+static SemaphoreHandle_t publish_mutex = NULL; // One image at a time
+static SemaphoreHandle_t state_mutex = NULL;
+static EventGroupHandle_t ack_events = NULL;
+static portMUX_TYPE init_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Written by the publishing task (under publish_mutex), read by the MQTT task
+static portMUX_TYPE topic_lock = portMUX_INITIALIZER_UNLOCKED;
+static char ack_topic[TOPIC_MAX] = {0};
+static uint32_t image_id_next = 0;
+
+// Current image awaiting acknowledgement
+static uint32_t ack_image_id = 0;
+static uint16_t resend_seqs[MQTT_IMAGE_MAX_RESEND];
+static int resend_count = 0;
+
+// Updated by the publishing task, read by the status loop
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static app_network_mqtt_image_stats_t stats = {0};
+static uint64_t acked_bytes = 0;
+static uint64_t acked_time_us = 0;
+
+static bool mqtt_image_setup(void)
+{
+    if (publish_mutex)
+    {
+        return true;
+    }
+
+    portENTER_CRITICAL(&init_lock);
+    if (!publish_mutex)
+    {
+        state_mutex = xSemaphoreCreateMutex();
+        ack_events = xEventGroupCreate();
+        image_id_next = esp_random();
+        publish_mutex = xSemaphoreCreateMutex();
+    }
+    portEXIT_CRITICAL(&init_lock);
+
+    return publish_mutex && state_mutex && ack_events;
+}
+
+// Publish one message once the image stream has an inflight slot free
+static esp_err_t publish_windowed(esp_mqtt_client_handle_t client, const char *topic,
+                                  const char *data, size_t len)
+{
+    esp_err_t err = mqtt_outbox_publish(client, APP_NETWORK_MQTT_STREAM_IMAGE, topic, data, len,
+                                        pdMS_TO_TICKS(MQTT_IMAGE_ACK_TIMEOUT_MS), NULL);
+    if (err == ESP_ERR_TIMEOUT || err == ESP_ERR_NO_MEM)
+    {
+        ESP_LOGW(TAG, "Image stream stalled (%s)", err == ESP_ERR_TIMEOUT ? "inflight window" : "outbox budget");
+    }
+    return err;
+}
+
+static esp_err_t publish_chunk(esp_mqtt_client_handle_t client, const char *prefix, uint32_t image_id,
+                               const uint8_t *data, size_t len, uint16_t seq, uint16_t total)
+{
+    size_t offset = (size_t)seq * MQTT_IMAGE_CHUNK_SIZE;
+    size_t chunk_len = len - offset;
+    if (chunk_len > MQTT_IMAGE_CHUNK_SIZE)
+    {
+        chunk_len = MQTT_IMAGE_CHUNK_SIZE;
+    }
+
+    uint32_t crc = esp_rom_crc32_le(0, data + offset, chunk_len);
+
+    char topic[TOPIC_MAX];
+    snprintf(topic, sizeof(topic), "%s/%08lx/%u/%u/%08lx",
+             prefix, (unsigned long)image_id, seq, total, (unsigned long)crc);
+
+    esp_err_t err = publish_windowed(client, topic, (const char *)data + offset, chunk_len);
+    if (err == ESP_OK)
+    {
+        portENTER_CRITICAL(&stats_lock);
+        stats.chunks_sent++;
+        stats.bytes_sent += chunk_len;
+        portEXIT_CRITICAL(&stats_lock);
+    }
+    return err;
+}
+
+esp_err_t mqtt_image_publish(esp_mqtt_client_handle_t client, const char *topic_prefix,
+                             const uint8_t *data, size_t len, const char *extra_meta)
+{
+    if (!mqtt_image_setup())
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t total = (len + MQTT_IMAGE_CHUNK_SIZE - 1) / MQTT_IMAGE_CHUNK_SIZE;
+    if (total > UINT16_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(publish_mutex, portMAX_DELAY);
+
+    // Subscribe to acknowledgements for this prefix
+    char topic[TOPIC_MAX];
+    snprintf(topic, sizeof(topic), "%s/ack", topic_prefix);
+    if (strcmp(topic, ack_topic) != 0) // Only this task writes it
+    {
+        portENTER_CRITICAL(&topic_lock);
+        strcpy(ack_topic, topic);
+        portEXIT_CRITICAL(&topic_lock);
+        esp_mqtt_client_subscribe(client, topic, 1);
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    if (image_id_next == 0)
+    {
+        image_id_next++; // 0 means "no image awaiting acknowledgement"
+    }
+    uint32_t image_id = image_id_next++;
+    uint32_t crc = esp_rom_crc32_le(0, data, len);
+
+    char meta[META_MAX];
+    int meta_len = snprintf(meta, sizeof(meta), "{\"len\":%u,\"chunks\":%u,\"chunkSize\":%d,\"crc\":\"%08lx\"%s%s}",
+                            (unsigned int)len, (unsigned int)total, MQTT_IMAGE_CHUNK_SIZE, (unsigned long)crc,
+                            extra_meta ? "," : "", extra_meta ? extra_meta : "");
+    if (meta_len >= (int)sizeof(meta))
+    {
+        xSemaphoreGive(publish_mutex);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    ack_image_id = image_id;
+    resend_count = 0;
+    xSemaphoreGive(state_mutex);
+    xEventGroupClearBits(ack_events, ACK_OK_BIT | ACK_RESEND_BIT);
+
+    snprintf(topic, sizeof(topic), "%s/%08lx/meta", topic_prefix, (unsigned long)image_id);
+
+    esp_err_t err = publish_windowed(client, topic, meta, meta_len);
+    for (uint16_t seq = 0; err == ESP_OK && seq < total; seq++)
+    {
+        err = publish_chunk(client, topic_prefix, image_id, data, len, seq, total);
+    }
+
+    // Wait for the receiver; serve selective resend requests
+    for (int round = 0; err == ESP_OK; round++)
+    {
+        EventBits_t bits = xEventGroupWaitBits(ack_events, ACK_OK_BIT | ACK_RESEND_BIT, pdTRUE, pdFALSE,
+                                               pdMS_TO_TICKS(MQTT_IMAGE_ACK_TIMEOUT_MS));
+        if (bits & ACK_OK_BIT)
+        {
+            break;
+        }
+        if (!(bits & ACK_RESEND_BIT))
+        {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        if (round >= MQTT_IMAGE_MAX_ROUNDS)
+        {
+            err = ESP_FAIL;
+            break;
+        }
+
+        uint16_t seqs[MQTT_IMAGE_MAX_RESEND];
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        int count = resend_count;
+        memcpy(seqs, resend_seqs, count * sizeof(seqs[0]));
+        resend_count = 0;
+        xSemaphoreGive(state_mutex);
+
+        ESP_LOGW(TAG, "Image %08lx: resending %d chunks", (unsigned long)image_id, count);
+        for (int i = 0; err == ESP_OK && i < count; i++)
+        {
+            if (seqs[i] < total)
+            {
+                err = publish_chunk(client, topic_prefix, image_id, data, len, seqs[i], (uint16_t)total);
+                portENTER_CRITICAL(&stats_lock);
+                stats.chunks_resent++;
+                portEXIT_CRITICAL(&stats_lock);
+            }
+        }
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    ack_image_id = 0;
+    xSemaphoreGive(state_mutex);
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    portENTER_CRITICAL(&stats_lock);
+    stats.images_sent++;
+    if (err == ESP_OK)
+    {
+        stats.images_acked++;
+        stats.last_image_ms = (uint32_t)(elapsed_us / 1000);
+        acked_bytes += len;
+        acked_time_us += elapsed_us;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (err == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Image %08lx delivered: %zu bytes in %u chunks, %lu ms",
+                 (unsigned long)image_id, len, (unsigned int)total, (uint32_t)(elapsed_us / 1000));
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Image %08lx not confirmed: %s", (unsigned long)image_id, esp_err_to_name(err));
+    }
+
+    xSemaphoreGive(publish_mutex);
+    return err;
+}
+
+void mqtt_image_on_connected(esp_mqtt_client_handle_t client)
+{
+    char topic[TOPIC_MAX];
+    portENTER_CRITICAL(&topic_lock);
+    strcpy(topic, ack_topic);
+    portEXIT_CRITICAL(&topic_lock);
+
+    if (topic[0])
+    {
+        esp_mqtt_client_subscribe(client, topic, 1);
+    }
+}
+
+bool mqtt_image_on_data(esp_mqtt_event_handle_t event)
+{
+    if (event->current_data_offset != 0)
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL(&topic_lock);
+    bool ours = ack_topic[0] && event->topic_len == (int)strlen(ack_topic) &&
+                strncmp(event->topic, ack_topic, event->topic_len) == 0;
+    portEXIT_CRITICAL(&topic_lock);
+    if (!ours)
+    {
+        return false;
+    }
+
+    // "<id> OK" or "<id> R <seq> <seq> ..."
+    char msg[256];
+    int len = event->data_len < (int)sizeof(msg) - 1 ? event->data_len : (int)sizeof(msg) - 1;
+    memcpy(msg, event->data, len);
+    msg[len] = '\0';
+
+    char *p = msg;
+    uint32_t image_id = strtoul(p, &p, 16);
+    while (*p == ' ')
+    {
+        p++;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (image_id == ack_image_id && ack_image_id != 0)
+    {
+        if (strncmp(p, "OK", 2) == 0)
+        {
+            xEventGroupSetBits(ack_events, ACK_OK_BIT);
+        }
+        else if (*p == 'R')
+        {
+            p++;
+            resend_count = 0;
+            while (resend_count < MQTT_IMAGE_MAX_RESEND)
+            {
+                char *end;
+                unsigned long seq = strtoul(p, &end, 10);
+                if (end == p)
+                {
+                    break;
+                }
+                resend_seqs[resend_count++] = (uint16_t)seq;
+                p = end;
+            }
+            xEventGroupSetBits(ack_events, ACK_RESEND_BIT);
+        }
+    }
+    xSemaphoreGive(state_mutex);
+    return true;
+}
+
+void mqtt_image_get_stats(app_network_mqtt_image_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    uint64_t bytes = acked_bytes;
+    uint64_t time_us = acked_time_us;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (time_us > 0)
+    {
+        out->throughput_bps = (uint32_t)(bytes * 1000000 / time_us);
+    }
+}
@@ -0,0 +1,54 @@
+/**
+ * @file mqtt_image.h
+ * @brief Chunked image transport over MQTT (private to app_network)
+ */
+
+#ifndef MQTT_IMAGE_H
+#define MQTT_IMAGE_H
+
+#include "app_network.h"
+#include "mqtt_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_IMAGE_CHUNK_SIZE 8192
+#define MQTT_IMAGE_WINDOW 4            // Default max unacknowledged chunks in flight
+#define MQTT_IMAGE_MAX_RESEND 32       // Max chunk numbers in one resend request
+#define MQTT_IMAGE_ACK_TIMEOUT_MS 5000 // Wait for the receiver's OK/resend reply
+#define MQTT_IMAGE_MAX_ROUNDS 3        // Resend rounds before giving up
+
+/**
+ * @brief Publish an image as chunks and wait for the receiver's acknowledgement
+ * @param client MQTT client
+ * @param topic_prefix Image topic prefix
+ * @param data JPEG data (must stay valid until the call returns)
+ * @param len JPEG size
+ * @param extra_meta Extra JSON members for the meta message, NULL for none
+ * @return ESP_OK once the receiver confirmed the whole image
+ */
+esp_err_t mqtt_image_publish(esp_mqtt_client_handle_t client, const char *topic_prefix,
+                             const uint8_t *data, size_t len, const char *extra_meta);
+
+/**
+ * @brief MQTT (re)connected: resubscribe to the acknowledgement topic
+ */
+void mqtt_image_on_connected(esp_mqtt_client_handle_t client);
+
+/**
+ * @brief Incoming message; handles acknowledgement/resend requests
+ * @return true if the message was consumed
+ */
+bool mqtt_image_on_data(esp_mqtt_event_handle_t event);
+
+/**
+ * @brief Get image transport statistics
+ */
+void mqtt_image_get_stats(app_network_mqtt_image_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_IMAGE_H
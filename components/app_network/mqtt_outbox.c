@@ -0,0 +1,334 @@
+/**
+ * @file mqtt_outbox.c
+ * @brief Per-Stream MQTT Publish Policies and Outbox Accounting
+ *
+ * Every publish names a stream. Its policy supplies QoS and retain and
+ * bounds the stream's share of the esp-mqtt outbox, where QoS 1/2 messages
+ * wait for their PUBACK: at most max_inflight unacknowledged messages, and
+ * nothing new while the stream's own unacknowledged messages hold
+ * outbox_limit bytes, so a busy stream cannot use up another's share. Image
+ * chunks wait for room; telemetry fails at once and is journaled instead.
+ *
+ * Unacknowledged messages are tracked by msg_id until MQTT_EVENT_PUBLISHED,
+ * or until esp-mqtt drops them after CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS
+ * (MQTT_EVENT_DELETED), which counts as an eviction. Evicted telemetry goes
+ * back to its fallback (mqtt_telemetry.c); replayed records stay in the
+ * journal until their PUBACK.
+ *
+ * Events arrive on the MQTT task while it holds the client lock, so the
+ * client API is never called with state_mutex held.
+ */
+
+#include "mqtt_outbox.h"
+#include "mqtt_image.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <string.h>
+
+static const char *TAG = "MQTT_OUTBOX";
+
+#define UNMATCHED_MAX 4 // PUBACKs that arrived before their msg_id was recorded
+#define STREAM_BIT(stream) (1 << (stream))
+#define ALL_STREAMS_BITS (STREAM_BIT(APP_NETWORK_MQTT_STREAM_COUNT) - 1)
+
+typedef struct {
+    int msg_id;     // -1 = free, 0 = reserved while publishing
+    uint8_t stream;
+    uint32_t len;
+} track_t;
+
+static app_network_mqtt_policy_t policies[APP_NETWORK_MQTT_STREAM_COUNT] = {
+    [APP_NETWORK_MQTT_STREAM_GENERIC] = {.qos = 1},
+    [APP_NETWORK_MQTT_STREAM_TELEMETRY] = {.qos = 1},
+    [APP_NETWORK_MQTT_STREAM_REPLAY] = {.qos = 1},
+    [APP_NETWORK_MQTT_STREAM_IMAGE] = {.qos = 1, .max_inflight = MQTT_IMAGE_WINDOW},
+};
+
+static SemaphoreHandle_t state_mutex = NULL;
+static EventGroupHandle_t room_events = NULL; // Bit per stream: a message left the outbox
+static portMUX_TYPE init_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static track_t tracked[MQTT_OUTBOX_TRACK];
+static int unmatched[UNMATCHED_MAX];
+static uint8_t unmatched_next = 0;
+static app_network_mqtt_outbox_stats_t stats = {0};
+
+static bool mqtt_outbox_setup(void)
+{
+    if (state_mutex)
+    {
+        return true;
+    }
+
+    portENTER_CRITICAL(&init_lock);
+    if (!state_mutex)
+    {
+        room_events = xEventGroupCreate();
+        for (int i = 0; i < MQTT_OUTBOX_TRACK; i++)
+        {
+            tracked[i].msg_id = -1;
+        }
+        for (int i = 0; i < UNMATCHED_MAX; i++)
+        {
+            unmatched[i] = -1;
+        }
+        state_mutex = xSemaphoreCreateMutex();
+    }
+    portEXIT_CRITICAL(&init_lock);
+
+    return state_mutex && room_events;
+}
+
+// ============================================================================
+// Tracking (call with state_mutex held)
+// ============================================================================
+
+static void note_outbox_locked(int outbox_bytes)
+{
+    stats.outbox_bytes = outbox_bytes > 0 ? (uint32_t)outbox_bytes : 0;
+    if (stats.outbox_bytes > stats.outbox_peak_bytes)
+    {
+        stats.outbox_peak_bytes = stats.outbox_bytes;
+    }
+}
+
+static int reserve_locked(app_network_mqtt_stream_t stream, uint8_t max_inflight, size_t len)
+{
+    app_network_mqtt_stream_stats_t *st = &stats.streams[stream];
+    if (max_inflight && st->inflight >= max_inflight)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < MQTT_OUTBOX_TRACK; i++)
+    {
+        if (tracked[i].msg_id == -1)
+        {
+            tracked[i] = (track_t){.msg_id = 0, .stream = stream, .len = len};
+            st->inflight++;
+            st->outbox_bytes += len;
+            if (st->inflight > st->inflight_peak)
+            {
+                st->inflight_peak = st->inflight;
+            }
+            if (st->outbox_bytes > st->outbox_peak_bytes)
+            {
+                st->outbox_peak_bytes = st->outbox_bytes;
+            }
+            return i;
+        }
+    }
+    return -1; // Table full: acts as a window shared by all streams
+}
+
+static void release_locked(int slot)
+{
+    app_network_mqtt_stream_stats_t *st = &stats.streams[tracked[slot].stream];
+    st->inflight--;
+    st->outbox_bytes -= tracked[slot].len;
+    tracked[slot].msg_id = -1;
+}
+
+static bool take_unmatched_locked(int msg_id)
+{
+    for (int i = 0; i < UNMATCHED_MAX; i++)
+    {
+        if (unmatched[i] == msg_id)
+        {
+            unmatched[i] = -1;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void complete(int msg_id, bool acked)
+{
+    if (!state_mutex || msg_id <= 0)
+    {
+        return;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    for (int i = 0; i < MQTT_OUTBOX_TRACK; i++)
+    {
+        if (tracked[i].msg_id == msg_id)
+        {
+            app_network_mqtt_stream_stats_t *st = &stats.streams[tracked[i].stream];
+            if (acked)
+            {
+                st->acked++;
+            }
+            else
+            {
+                st->evicted++;
+                ESP_LOGW(TAG, "Stream %u: msg_id=%d (%lu bytes) evicted unacknowledged",
+                         tracked[i].stream, msg_id, tracked[i].len);
+            }
+            release_locked(i);
+            xSemaphoreGive(state_mutex);
+            // The tracking table is shared, so a release may unblock any stream
+            xEventGroupSetBits(room_events, ALL_STREAMS_BITS);
+            return;
+        }
+    }
+    if (acked)
+    {
+        unmatched[unmatched_next] = msg_id;
+        unmatched_next = (unmatched_next + 1) % UNMATCHED_MAX;
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+esp_err_t mqtt_outbox_publish(esp_mqtt_client_handle_t client, app_network_mqtt_stream_t stream,
+                              const char *topic, const void *data, size_t len, TickType_t wait, int *msg_id)
+{
+    if (stream >= APP_NETWORK_MQTT_STREAM_COUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!mqtt_outbox_setup())
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    app_network_mqtt_stream_stats_t *st = &stats.streams[stream];
+    app_network_mqtt_policy_t policy;
+    TickType_t start = xTaskGetTickCount();
+    bool counted = false;
+    int slot = -1;
+
+    // Wait for room; the client outbox size (statistics only) is read before taking the mutex
+    while (1)
+    {
+        int outbox = esp_mqtt_client_get_outbox_size(client);
+
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        policy = policies[stream];
+        note_outbox_locked(outbox);
+
+        bool over_budget = policy.outbox_limit && (size_t)st->outbox_bytes + len > policy.outbox_limit;
+        if (!over_budget &&
+            (policy.qos == 0 || (slot = reserve_locked(stream, policy.max_inflight, len)) >= 0))
+        {
+            break;
+        }
+
+        if (!over_budget && !counted)
+        {
+            counted = true;
+            st->window_full++;
+        }
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= wait)
+        {
+            if (over_budget)
+            {
+                st->rejected++;
+            }
+            xSemaphoreGive(state_mutex);
+            return over_budget ? ESP_ERR_NO_MEM : ESP_ERR_TIMEOUT;
+        }
+        // Cleared under the mutex, so a release after this point still wakes us
+        xEventGroupClearBits(room_events, STREAM_BIT(stream));
+        xSemaphoreGive(state_mutex);
+        xEventGroupWaitBits(room_events, STREAM_BIT(stream), pdFALSE, pdFALSE, wait - elapsed);
+    }
+    xSemaphoreGive(state_mutex);
+
+    int id = esp_mqtt_client_publish(client, topic, data, len, policy.qos, policy.retain);
+    int outbox = esp_mqtt_client_get_outbox_size(client);
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    note_outbox_locked(outbox);
+    if (id >= 0)
+    {
+        st->published++;
+    }
+    else if (id == -2)
+    {
+        st->rejected++; // Client-wide outbox limit
+    }
+
+    if (slot >= 0)
+    {
+        if (id <= 0)
+        {
+            release_locked(slot);
+        }
+        else if (take_unmatched_locked(id))
+        {
+            st->acked++; // PUBACK beat us here
+            release_locked(slot);
+        }
+        else
+        {
+            tracked[slot].msg_id = id;
+        }
+    }
+    xSemaphoreGive(state_mutex);
+
+    if (msg_id)
+    {
+        *msg_id = id;
+    }
+    if (id == -2)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return id >= 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t mqtt_outbox_set_policy(app_network_mqtt_stream_t stream, const app_network_mqtt_policy_t *policy)
+{
+    if (stream >= APP_NETWORK_MQTT_STREAM_COUNT || !policy)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!mqtt_outbox_setup())
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    policies[stream] = *policy;
+    xSemaphoreGive(state_mutex);
+    // A wider window or budget may let a waiting publisher through
+    xEventGroupSetBits(room_events, STREAM_BIT(stream));
+
+    ESP_LOGI(TAG, "Stream %d: QoS %u%s, max %u inflight, outbox budget %u bytes", stream, policy->qos,
+             policy->retain ? " retained" : "", policy->max_inflight, policy->outbox_limit);
+    return ESP_OK;
+}
+
+void mqtt_outbox_get_stats(esp_mqtt_client_handle_t client, app_network_mqtt_outbox_stats_t *out)
+{
+    int outbox = client ? esp_mqtt_client_get_outbox_size(client) : 0;
+    if (!mqtt_outbox_setup())
+    {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    note_outbox_locked(outbox);
+    *out = stats;
+    xSemaphoreGive(state_mutex);
+}
+
+void mqtt_outbox_on_published(int msg_id)
+{
+    complete(msg_id, true);
+}
+
+void mqtt_outbox_on_deleted(int msg_id)
+{
+    complete(msg_id, false);
+}
@@ -0,0 +1,60 @@
+/**
+ * @file mqtt_outbox.h
+ * @brief Per-stream MQTT publish policies and outbox accounting (private to app_network)
+ */
+
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include "app_network.h"
+#include "mqtt_client.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_OUTBOX_TRACK 32 // Unacknowledged messages tracked at once, all streams together
+
+/**
+ * @brief Publish under a stream's policy
+ * @param client MQTT client
+ * @param stream Stream whose QoS, retain and limits apply
+ * @param topic Topic
+ * @param data Payload
+ * @param len Payload size
+ * @param wait How long to wait for room in the window or the outbox budget
+ * @param msg_id Message id for QoS 1/2, 0 for QoS 0 (NULL if not needed)
+ * @return ESP_OK once enqueued, ESP_ERR_NO_MEM if the outbox budget or the client
+ *         outbox limit is reached, ESP_ERR_TIMEOUT if the inflight window stayed full,
+ *         ESP_ERR_INVALID_ARG for an unknown stream
+ */
+esp_err_t mqtt_outbox_publish(esp_mqtt_client_handle_t client, app_network_mqtt_stream_t stream,
+                              const char *topic, const void *data, size_t len, TickType_t wait, int *msg_id);
+
+/**
+ * @brief Replace a stream's policy
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for an unknown stream or a NULL policy
+ */
+esp_err_t mqtt_outbox_set_policy(app_network_mqtt_stream_t stream, const app_network_mqtt_policy_t *policy);
+
+/**
+ * @brief Get outbox occupancy (client may be NULL before init) and per-stream statistics
+ */
+void mqtt_outbox_get_stats(esp_mqtt_client_handle_t client, app_network_mqtt_outbox_stats_t *stats);
+
+/**
+ * @brief A QoS 1/2 message was acknowledged (PUBACK/PUBCOMP)
+ */
+void mqtt_outbox_on_published(int msg_id);
+
+/**
+ * @brief A message expired from the outbox unacknowledged
+ */
+void mqtt_outbox_on_deleted(int msg_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_OUTBOX_H
@@ -0,0 +1,567 @@
+/**
+ * @file mqtt_telemetry.c
+ * @brief Batched Telemetry Publishing over MQTT
+ *
+ * Encoded samples are appended to one array payload, JSON
+ *   [{"ts":123456,...},{"ts":128456,...}]
+ * or CBOR, where an indefinite-length array needs no count up front
+ *   9F <map> <map> ... FF
+ * The batch is published on the telemetry stream when it holds max_samples
+ * samples, when the next sample would push it past max_bytes, or when its
+ * oldest sample is max_age_ms old. With max_samples = 1 every sample is published on its
+ * own as a plain object, which is the baseline the statistics compare with.
+ * A message that cannot be published goes to the configured fallback, which
+ * hands it back through mqtt_telemetry_replay() once the link is up. So does
+ * a published message the outbox evicts before its PUBACK: a PSRAM copy is
+ * kept per tracked msg_id, and the flush task passes it to the fallback.
+ *
+ * Every topic has its own batcher (format, limits, buffer, statistics),
+ * named by the id mqtt_telemetry_start() hands out. Batchers share the
+ * MQTT client and the telemetry stream's outbox policy.
+ */
+
+#include "mqtt_telemetry.h"
+#include "mqtt_outbox.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "MQTT_TELEMETRY";
+
+#define TOPIC_MAX 96
+
+typedef enum {
+    FLUSH_COUNT,
+    FLUSH_BYTES,
+    FLUSH_AGE,
+    FLUSH_MANUAL,
+} flush_reason_t;
+
+// Per-mode counters: [0] single samples, [1] batches
+typedef struct {
+    app_network_telemetry_stats_t stats;
+    int64_t since_us;   // When this mode was (last) entered
+    int64_t active_us;  // Time spent in this mode before since_us
+    uint64_t ack_total_ms;
+} mode_stats_t;
+
+typedef struct {
+    int msg_id;         // 0 = free, -1 = evicted, copy waits for the flush task
+    int64_t sent_us;
+    uint8_t batcher;
+    bool batched;
+    uint8_t samples;
+    uint8_t *copy;      // Payload for the fallback (NULL = none kept)
+    size_t copy_len;
+} ack_track_t;
+
+// One batcher per telemetry topic
+typedef struct {
+    app_network_telemetry_config_t config;
+    uint8_t id;
+    char topic[TOPIC_MAX];
+    char *payload;
+    size_t payload_len;
+    uint8_t payload_samples;
+    uint8_t array_open, array_separator, array_close; // Framing bytes of the format
+    int64_t oldest_us;
+    SemaphoreHandle_t mutex;
+    TaskHandle_t flush_handle;
+    mode_stats_t modes[2];
+} batcher_t;
+
+static batcher_t batchers[APP_NETWORK_TELEMETRY_TOPICS];
+static uint8_t batcher_count = 0;
+static portMUX_TYPE start_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_mqtt_client_handle_t tl_client = NULL;
+static volatile bool tl_connected = false;
+static app_network_telemetry_delivery_cb_t delivery_cb = NULL;
+static void *delivery_ctx = NULL;
+
+// PUBACKs arrive on the MQTT task, which may hold the client lock that a
+// publish under a batcher mutex is waiting for: ack state has its own spinlock
+static portMUX_TYPE ack_lock = portMUX_INITIALIZER_UNLOCKED;
+static ack_track_t acks[MQTT_TELEMETRY_ACK_TRACK];
+static uint8_t ack_next = 0;
+
+static batcher_t *batcher_get(uint8_t id)
+{
+    return id < batcher_count && batchers[id].payload ? &batchers[id] : NULL;
+}
+
+static bool batching(const batcher_t *b)
+{
+    return b->config.max_samples > 1;
+}
+
+// ============================================================================
+// Ack Tracking
+// ============================================================================
+
+// Record a published message; returns a copy its slot no longer protects
+static uint8_t *track_sent(const batcher_t *b, int msg_id, int64_t sent_us)
+{
+    uint8_t *copy = NULL;
+    if (b->config.fallback)
+    {
+        copy = heap_caps_malloc(b->payload_len, MALLOC_CAP_SPIRAM);
+        if (copy)
+        {
+            memcpy(copy, b->payload, b->payload_len);
+        }
+    }
+
+    portENTER_CRITICAL(&ack_lock);
+    // Prefer a free slot, then the oldest unacknowledged one, which loses its
+    // latency and its copy; an evicted copy is overwritten only as a last resort
+    int slot = -1;
+    for (int pass = 0; pass < 2 && slot < 0; pass++)
+    {
+        for (int i = 0; i < MQTT_TELEMETRY_ACK_TRACK; i++)
+        {
+            int n = (ack_next + i) % MQTT_TELEMETRY_ACK_TRACK;
+            if (pass == 0 ? acks[n].msg_id == 0 : acks[n].msg_id > 0)
+            {
+                slot = n;
+                break;
+            }
+        }
+    }
+    if (slot < 0)
+    {
+        slot = ack_next;
+    }
+    uint8_t *stale = acks[slot].copy;
+    acks[slot] = (ack_track_t){.msg_id = msg_id, .sent_us = sent_us, .batcher = b->id, .batched = batching(b),
+                               .samples = b->payload_samples, .copy = copy, .copy_len = b->payload_len};
+    ack_next = (slot + 1) % MQTT_TELEMETRY_ACK_TRACK;
+    portEXIT_CRITICAL(&ack_lock);
+    return stale;
+}
+
+// Hand evicted messages to the fallback (call with the batcher's mutex held)
+static void requeue_evicted_locked(batcher_t *b)
+{
+    for (int i = 0; i < MQTT_TELEMETRY_ACK_TRACK; i++)
+    {
+        portENTER_CRITICAL(&ack_lock);
+        ack_track_t ack = acks[i];
+        bool ours = ack.msg_id == -1 && ack.batcher == b->id;
+        if (ours)
+        {
+            acks[i].msg_id = 0;
+            acks[i].copy = NULL;
+        }
+        portEXIT_CRITICAL(&ack_lock);
+        if (!ours)
+        {
+            continue;
+        }
+
+        mode_stats_t *mode = &b->modes[ack.batched];
+        if (ack.copy && b->config.fallback(b->id, ack.copy, ack.copy_len, b->config.fallback_ctx) == ESP_OK)
+        {
+            mode->stats.requeued += ack.samples;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Evicted message on '%s' not kept, %u samples dropped", b->topic, ack.samples);
+            mode->stats.dropped += ack.samples;
+        }
+        heap_caps_free(ack.copy);
+    }
+}
+
+// ============================================================================
+// Publishing (call with the batcher's mutex held)
+// ============================================================================
+
+static esp_err_t publish_locked(batcher_t *b, flush_reason_t reason)
+{
+    if (b->payload_samples == 0)
+    {
+        return ESP_OK;
+    }
+
+    mode_stats_t *mode = &b->modes[batching(b)];
+    if (batching(b))
+    {
+        b->payload[b->payload_len++] = b->array_close;
+    }
+
+    // Not waiting for room: a full window or outbox budget defers the batch
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    int msg_id = 0;
+    if (tl_client && tl_connected)
+    {
+        int64_t sent_us = esp_timer_get_time();
+        err = mqtt_outbox_publish(tl_client, APP_NETWORK_MQTT_STREAM_TELEMETRY, b->topic, b->payload,
+                                  b->payload_len, 0, &msg_id);
+        if (err == ESP_OK && msg_id > 0)
+        {
+            heap_caps_free(track_sent(b, msg_id, sent_us));
+        }
+    }
+
+    if (err == ESP_OK)
+    {
+        mode->stats.messages++;
+        mode->stats.samples += b->payload_samples;
+        mode->stats.bytes += b->payload_len;
+        switch (reason)
+        {
+        case FLUSH_COUNT:
+            mode->stats.flush_count++;
+            break;
+        case FLUSH_BYTES:
+            mode->stats.flush_bytes++;
+            break;
+        case FLUSH_AGE:
+            mode->stats.flush_age++;
+            break;
+        default:
+            break;
+        }
+        ESP_LOGD(TAG, "Published %u samples (%u bytes) on '%s', msg_id=%d", b->payload_samples,
+                 b->payload_len, b->topic, msg_id);
+    }
+    else if (b->config.fallback &&
+             b->config.fallback(b->id, b->payload, b->payload_len, b->config.fallback_ctx) == ESP_OK)
+    {
+        ESP_LOGD(TAG, "Not published (%s), %u samples deferred", esp_err_to_name(err), b->payload_samples);
+        mode->stats.deferred += b->payload_samples;
+        err = ESP_OK;
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Not published on '%s' (%s), %u samples dropped", b->topic, esp_err_to_name(err),
+                 b->payload_samples);
+        mode->stats.dropped += b->payload_samples;
+    }
+
+    b->payload_len = 0;
+    b->payload_samples = 0;
+    return err;
+}
+
+static void flush_task(void *arg)
+{
+    batcher_t *b = (batcher_t *)arg;
+
+    while (1)
+    {
+        TickType_t wait = portMAX_DELAY;
+
+        xSemaphoreTake(b->mutex, portMAX_DELAY);
+        requeue_evicted_locked(b);
+        if (b->payload_samples > 0 && b->config.max_age_ms > 0)
+        {
+            int64_t age_ms = (esp_timer_get_time() - b->oldest_us) / 1000;
+            if (age_ms >= b->config.max_age_ms)
+            {
+                publish_locked(b, FLUSH_AGE);
+            }
+            else
+            {
+                wait = pdMS_TO_TICKS(b->config.max_age_ms - age_ms) + 1;
+            }
+        }
+        xSemaphoreGive(b->mutex);
+
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+// ============================================================================
+// API (app_network wrappers check arguments)
+// ============================================================================
+
+esp_err_t mqtt_telemetry_start(const app_network_telemetry_config_t *config, uint8_t *id)
+{
+    // Claim a slot; batchers are never stopped, so ids stay valid
+    portENTER_CRITICAL(&start_lock);
+    if (batcher_count >= APP_NETWORK_TELEMETRY_TOPICS)
+    {
+        portEXIT_CRITICAL(&start_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    batcher_t *b = &batchers[batcher_count];
+    b->id = batcher_count++;
+    portEXIT_CRITICAL(&start_lock);
+
+    b->config = *config;
+    if (b->config.max_samples == 0)
+    {
+        b->config.max_samples = 1;
+    }
+    snprintf(b->topic, sizeof(b->topic), "%s", config->topic);
+    b->config.topic = b->topic;
+    bool cbor = config->format == APP_NETWORK_TELEMETRY_CBOR;
+    b->array_open = cbor ? 0x9F : '[';
+    b->array_separator = cbor ? 0 : ','; // CBOR items follow each other directly
+    b->array_close = cbor ? 0xFF : ']';
+
+    int64_t now_us = esp_timer_get_time();
+    b->modes[0].since_us = now_us;
+    b->modes[1].since_us = now_us;
+
+    // Room for the closing bracket
+    char *payload = malloc(b->config.max_bytes + 1);
+    b->mutex = xSemaphoreCreateMutex();
+    if (!payload || !b->mutex ||
+        ((b->config.max_age_ms > 0 || b->config.fallback) &&
+         xTaskCreate(flush_task, "mqtt_telemetry", 3072, b, 4, &b->flush_handle) != pdPASS))
+    {
+        // The slot stays claimed but unusable: batcher_get() skips it
+        free(payload);
+        if (b->mutex)
+        {
+            vSemaphoreDelete(b->mutex);
+            b->mutex = NULL;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    b->payload = payload; // Published last: the batcher is usable from here on
+
+    ESP_LOGI(TAG, "Telemetry %u on '%s' (%s): %u samples / %u bytes / %lu ms per message", b->id, b->topic,
+             cbor ? "CBOR" : "JSON", b->config.max_samples, b->config.max_bytes, b->config.max_age_ms);
+    *id = b->id;
+    return ESP_OK;
+}
+
+esp_err_t mqtt_telemetry_add(uint8_t id, const void *item, size_t len)
+{
+    batcher_t *b = batcher_get(id);
+    if (!b)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t framing = batching(b) ? 1 : 0; // Array start or separator before the sample
+
+    if (len + framing > b->config.max_bytes)
+    {
+        ESP_LOGW(TAG, "Sample of %u bytes exceeds max_bytes", len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(b->mutex, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    if (b->payload_samples > 0 && b->payload_len + framing + len > b->config.max_bytes)
+    {
+        err = publish_locked(b, FLUSH_BYTES);
+    }
+
+    if (b->payload_samples == 0 && batching(b))
+    {
+        b->payload[b->payload_len++] = b->array_open;
+    }
+    else if (b->payload_samples > 0 && b->array_separator)
+    {
+        b->payload[b->payload_len++] = b->array_separator;
+    }
+    memcpy(b->payload + b->payload_len, item, len);
+    b->payload_len += len;
+
+    if (b->payload_samples++ == 0)
+    {
+        b->oldest_us = esp_timer_get_time();
+        if (b->flush_handle)
+        {
+            xTaskNotifyGive(b->flush_handle); // Arm the age limit
+        }
+    }
+
+    if (b->payload_samples >= b->config.max_samples)
+    {
+        esp_err_t flush_err = publish_locked(b, FLUSH_COUNT);
+        err = err != ESP_OK ? err : flush_err;
+    }
+    xSemaphoreGive(b->mutex);
+    return err;
+}
+
+esp_err_t mqtt_telemetry_replay(uint8_t id, const void *message, size_t len, int *msg_id)
+{
+    // Straight to the client: replayed messages are already framed. Their own
+    // stream keeps a backlog from crowding out live telemetry.
+    batcher_t *b = batcher_get(id);
+    if (!b)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (!tl_client || !tl_connected)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return mqtt_outbox_publish(tl_client, APP_NETWORK_MQTT_STREAM_REPLAY, b->topic, message, len, 0, msg_id);
+}
+
+void mqtt_telemetry_set_delivery_cb(app_network_telemetry_delivery_cb_t cb, void *ctx)
+{
+    delivery_ctx = ctx;
+    delivery_cb = cb;
+}
+
+esp_err_t mqtt_telemetry_flush(uint8_t id)
+{
+    batcher_t *b = batcher_get(id);
+    if (!b)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(b->mutex, portMAX_DELAY);
+    esp_err_t err = publish_locked(b, FLUSH_MANUAL);
+    xSemaphoreGive(b->mutex);
+    return err;
+}
+
+esp_err_t mqtt_telemetry_set_batch(uint8_t id, uint8_t max_samples)
+{
+    batcher_t *b = batcher_get(id);
+    if (!b)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(b->mutex, portMAX_DELAY);
+    publish_locked(b, FLUSH_MANUAL);
+
+    int64_t now_us = esp_timer_get_time();
+    mode_stats_t *old_mode = &b->modes[batching(b)];
+    old_mode->active_us += now_us - old_mode->since_us;
+
+    b->config.max_samples = max_samples ? max_samples : 1;
+    b->modes[batching(b)].since_us = now_us;
+    xSemaphoreGive(b->mutex);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_telemetry_get_stats(uint8_t id, bool batched, app_network_telemetry_stats_t *out)
+{
+    batcher_t *b = batcher_get(id);
+    memset(out, 0, sizeof(*out));
+    if (!b)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(b->mutex, portMAX_DELAY);
+    const mode_stats_t *mode = &b->modes[batched];
+    portENTER_CRITICAL(&ack_lock);
+    *out = mode->stats;
+    uint64_t ack_total_ms = mode->ack_total_ms;
+    portEXIT_CRITICAL(&ack_lock);
+
+    int64_t active_us = mode->active_us;
+    if (batching(b) == batched)
+    {
+        active_us += esp_timer_get_time() - mode->since_us;
+    }
+    if (active_us > 0)
+    {
+        out->messages_per_s = out->messages * 1e6f / active_us;
+    }
+    if (out->samples > 0)
+    {
+        out->bytes_per_sample = (uint32_t)(out->bytes / out->samples);
+    }
+    if (out->acked > 0)
+    {
+        out->ack_avg_ms = (uint32_t)(ack_total_ms / out->acked);
+    }
+    xSemaphoreGive(b->mutex);
+    return ESP_OK;
+}
+
+// ============================================================================
+// MQTT Events
+// ============================================================================
+
+void mqtt_telemetry_on_connected(esp_mqtt_client_handle_t client)
+{
+    tl_client = client;
+    tl_connected = true;
+}
+
+void mqtt_telemetry_on_disconnected(void)
+{
+    tl_connected = false;
+}
+
+void mqtt_telemetry_on_published(int msg_id)
+{
+    if (msg_id <= 0)
+    {
+        return;
+    }
+
+    if (delivery_cb)
+    {
+        delivery_cb(msg_id, true, delivery_ctx);
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    uint8_t *copy = NULL;
+    portENTER_CRITICAL(&ack_lock);
+    for (int i = 0; i < MQTT_TELEMETRY_ACK_TRACK; i++)
+    {
+        if (acks[i].msg_id == msg_id)
+        {
+            mode_stats_t *mode = &batchers[acks[i].batcher].modes[acks[i].batched];
+            uint32_t latency_ms = (uint32_t)((now_us - acks[i].sent_us) / 1000);
+            mode->stats.acked++;
+            mode->ack_total_ms += latency_ms;
+            if (latency_ms > mode->stats.ack_max_ms)
+            {
+                mode->stats.ack_max_ms = latency_ms;
+            }
+            copy = acks[i].copy;
+            acks[i].copy = NULL;
+            acks[i].msg_id = 0;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&ack_lock);
+    heap_caps_free(copy);
+}
+
+void mqtt_telemetry_on_deleted(int msg_id)
+{
+    if (msg_id <= 0)
+    {
+        return;
+    }
+
+    if (delivery_cb)
+    {
+        delivery_cb(msg_id, false, delivery_ctx);
+    }
+
+    // The fallback may block on flash: leave it to the batcher's flush task
+    TaskHandle_t flush_handle = NULL;
+    portENTER_CRITICAL(&ack_lock);
+    for (int i = 0; i < MQTT_TELEMETRY_ACK_TRACK; i++)
+    {
+        if (acks[i].msg_id == msg_id)
+        {
+            flush_handle = batchers[acks[i].batcher].flush_handle;
+            acks[i].msg_id = flush_handle ? -1 : 0; // No flush task: no fallback either
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&ack_lock);
+
+    if (flush_handle)
+    {
+        xTaskNotifyGive(flush_handle);
+    }
+}
@@ -0,0 +1,69 @@
+/**
+ * @file mqtt_telemetry.h
+ * @brief Batched telemetry publishing over MQTT (private to app_network)
+ */
+
+#ifndef MQTT_TELEMETRY_H
+#define MQTT_TELEMETRY_H
+
+#include "app_network.h"
+#include "mqtt_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_TELEMETRY_ACK_TRACK 8 // Messages whose PUBACK latency is tracked at once
+
+/**
+ * @brief Allocate a batcher for one topic and start its age flush task
+ */
+esp_err_t mqtt_telemetry_start(const app_network_telemetry_config_t *config, uint8_t *id);
+
+/**
+ * @brief Buffer a sample, publishing the batch when a limit is reached
+ */
+esp_err_t mqtt_telemetry_add(uint8_t id, const void *item, size_t len);
+esp_err_t mqtt_telemetry_replay(uint8_t id, const void *message, size_t len, int *msg_id);
+void mqtt_telemetry_set_delivery_cb(app_network_telemetry_delivery_cb_t cb, void *ctx);
+
+/**
+ * @brief Publish whatever is buffered
+ */
+esp_err_t mqtt_telemetry_flush(uint8_t id);
+
+/**
+ * @brief Change max_samples (flushes first)
+ */
+esp_err_t mqtt_telemetry_set_batch(uint8_t id, uint8_t max_samples);
+
+/**
+ * @brief Get statistics for single (false) or batched (true) publishing
+ */
+esp_err_t mqtt_telemetry_get_stats(uint8_t id, bool batched, app_network_telemetry_stats_t *stats);
+
+/**
+ * @brief MQTT (re)connected: publish through this client from now on
+ */
+void mqtt_telemetry_on_connected(esp_mqtt_client_handle_t client);
+
+/**
+ * @brief MQTT disconnected: samples stay buffered until the batch is full
+ */
+void mqtt_telemetry_on_disconnected(void);
+
+/**
+ * @brief A QoS 1 message was acknowledged (PUBACK)
+ */
+void mqtt_telemetry_on_published(int msg_id);
+
+/**
+ * @brief A message expired from the outbox unacknowledged; live telemetry goes back to its fallback
+ */
+void mqtt_telemetry_on_deleted(int msg_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_TELEMETRY_H
@@ -5,6 +5,12 @@
 
 #include "cam_config.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_jpg_decode.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include <string.h>
 
 static const char *TAG = "CAM_CONFIG";
 
@@ -27,9 +33,26 @@ static const char *TAG = "CAM_CONFIG";
 #define CAM_PIN_HREF    7      // Horizontal reference
 #define CAM_PIN_PCLK    13     // Pixel clock
 
+static void warm_restore(sensor_t *s);
+
+static int64_t init_start_us = 0;
+static uint32_t init_ms = 0;
+static bool burst_mode = false;
+
+void cam_config_set_burst_mode(bool enabled)
+{
+    burst_mode = enabled;
+}
+
+bool cam_config_burst_mode(void)
+{
+    return burst_mode;
+}
+
 esp_err_t cam_config_init(void)
 {
     ESP_LOGI(TAG, "Initializing camera...");
+    init_start_us = esp_timer_get_time();
 
     camera_config_t config = {
         .pin_pwdn = CAM_PIN_PWDN,
@@ -59,10 +82,14 @@ esp_err_t cam_config_init(void)
         .pixel_format = PIXFORMAT_JPEG,
         .frame_size = FRAMESIZE_SVGA,    // 800x600 (good balance for upload)
         .jpeg_quality = 12,              // 0-63, lower = higher quality
-        .fb_count = 2,                   // Double buffering for smooth capture
+        .fb_count = CAM_FB_COUNT,        // Double buffering for smooth capture
         .fb_location = CAMERA_FB_IN_PSRAM,  // Use PSRAM for frame buffers
         .grab_mode = CAMERA_GRAB_WHEN_EMPTY,
     };
+    if (burst_mode) {
+        config.fb_count = CAM_FB_COUNT_BURST;   // Deep pool so bursts run at sensor frame rate
+        config.grab_mode = CAMERA_GRAB_LATEST;  // Always hand out the newest frame
+    }
 
     // Initialize camera
     esp_err_t err = esp_camera_init(&config);
@@ -101,7 +128,11 @@ esp_err_t cam_config_init(void)
     s->set_dcw(s, 1);            // 0 = disable, 1 = enable (downsize enable)
     s->set_colorbar(s, 0);       // 0 = disable, 1 = enable (test pattern)
 
-    ESP_LOGI(TAG, "Camera initialized successfully (SVGA, JPEG, PSRAM)");
+    warm_restore(s);
+    init_ms = (uint32_t)((esp_timer_get_time() - init_start_us) / 1000);
+
+    ESP_LOGI(TAG, "Camera initialized successfully (SVGA, JPEG, PSRAM%s) in %lu ms",
+             burst_mode ? ", burst mode" : "", init_ms);
     ESP_LOGI(TAG, "Sensor PID: 0x%02X", s->id.PID);
     
     return ESP_OK;
@@ -116,14 +147,22 @@ esp_err_t cam_config_deinit(void)
     return err;
 }
 
+static void adaptive_apply_pending(void);
+static bool product_is_roi(void);
+static camera_fb_t *warm_first_frame(camera_fb_t *fb);
+static void warm_autosnapshot(void);
+
 camera_fb_t* cam_config_capture(void)
 {
-    camera_fb_t *fb = esp_camera_fb_get();
+    adaptive_apply_pending();
+
+    camera_fb_t *fb = warm_first_frame(esp_camera_fb_get());
     if (!fb) {
         ESP_LOGE(TAG, "Camera capture failed");
         return NULL;
     }
-    ESP_LOGI(TAG, "Image captured: %zu bytes", fb->len);
+    warm_autosnapshot();
+    ESP_LOGD(TAG, "Image captured: %zu bytes", fb->len);
     return fb;
 }
 
@@ -139,3 +178,885 @@ sensor_t* cam_config_get_sensor(void)
     return esp_camera_sensor_get();
 }
 
+
+// ============================================================================
+// Analysis Frames (pooled scaled grayscale decode)
+// ============================================================================
+
+// Buffers are sized once for UXGA (1600x1200) at their scale
+#define ANALYSIS_SRC_MAX_W  1600
+#define ANALYSIS_SRC_MAX_H  1200
+#define ANALYSIS_MAX_W      (ANALYSIS_SRC_MAX_W / 8)
+#define ANALYSIS_MAX_H      (ANALYSIS_SRC_MAX_H / 8)
+#define ANALYSIS_ALIGN      64     // PSRAM cache line
+
+typedef struct {
+    uint8_t *gray;
+    size_t capacity;
+    uint16_t width;
+    uint16_t height;
+    bool valid;
+    const uint8_t *src_buf;        // Identifies the frame last decoded
+    struct timeval src_ts;
+    // Benchmark
+    uint32_t decodes;
+    uint32_t shared;
+    uint64_t total_us;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t decoder_bytes;
+} analysis_slot_t;
+
+typedef struct {
+    const uint8_t *jpeg;
+    size_t jpeg_len;
+    analysis_slot_t *slot;
+    uint16_t width;
+    uint16_t height;
+    size_t free_before;            // Heap free before the decoder allocated its state
+    uint32_t decoder_bytes;
+} analysis_decode_t;
+
+static const jpg_scale_t analysis_jpg_scale[CAM_ANALYSIS_SCALE_COUNT] = {
+    JPG_SCALE_2X, JPG_SCALE_4X, JPG_SCALE_8X,
+};
+
+static analysis_slot_t analysis_pool[CAM_ANALYSIS_SCALE_COUNT];
+
+static size_t analysis_jpg_read(void *arg, size_t index, uint8_t *buf, size_t len)
+{
+    analysis_decode_t *dec = (analysis_decode_t *)arg;
+    if (index + len > dec->jpeg_len) {
+        len = dec->jpeg_len - index;
+    }
+    if (buf) {
+        memcpy(buf, dec->jpeg + index, len);
+    }
+    return len;
+}
+
+// Receives decoded RGB888 blocks and stores their luma
+static bool analysis_jpg_write(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data)
+{
+    analysis_decode_t *dec = (analysis_decode_t *)arg;
+
+    if (!data) {
+        if (x == 0 && y == 0) {
+            // Start of image: output dimensions. The decoder has allocated
+            // its working state by now, so this is its heap footprint.
+            if ((size_t)w * h > dec->slot->capacity) {
+                return false;
+            }
+            dec->width = w;
+            dec->height = h;
+            size_t free_now = esp_get_free_heap_size();
+            if (dec->free_before > free_now) {
+                dec->decoder_bytes = dec->free_before - free_now;
+            }
+        }
+        return true;
+    }
+
+    // Clip partial MCUs at the right and bottom edges
+    uint16_t out_w = (x + w > dec->width) ? dec->width - x : w;
+    uint16_t out_h = (y + h > dec->height) ? dec->height - y : h;
+
+    for (uint16_t row = 0; row < out_h; row++) {
+        uint8_t *dst = dec->slot->gray + (y + row) * dec->width + x;
+        const uint8_t *src = data + row * w * 3;
+        for (uint16_t col = 0; col < out_w; col++) {
+            dst[col] = (src[0] * 77 + src[1] * 150 + src[2] * 29) >> 8;
+            src += 3;
+        }
+    }
+    return true;
+}
+
+esp_err_t cam_config_analysis_decode_scaled(const camera_fb_t *fb, cam_analysis_scale_t scale)
+{
+    if (!fb || fb->format != PIXFORMAT_JPEG || scale >= CAM_ANALYSIS_SCALE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    analysis_slot_t *slot = &analysis_pool[scale];
+
+    // Already decoded (several stages look at the same frame)
+    if (slot->valid && fb->buf == slot->src_buf &&
+        fb->timestamp.tv_sec == slot->src_ts.tv_sec &&
+        fb->timestamp.tv_usec == slot->src_ts.tv_usec) {
+        slot->shared++;
+        return ESP_OK;
+    }
+
+    // Allocated on first use and kept: no per-frame allocation
+    if (!slot->gray) {
+        uint32_t div = 2u << scale;
+        size_t size = (ANALYSIS_SRC_MAX_W / div) * (ANALYSIS_SRC_MAX_H / div);
+        size = (size + ANALYSIS_ALIGN - 1) & ~(size_t)(ANALYSIS_ALIGN - 1);
+        slot->gray = heap_caps_aligned_alloc(ANALYSIS_ALIGN, size, MALLOC_CAP_SPIRAM);
+        if (!slot->gray) {
+            ESP_LOGE(TAG, "Failed to allocate 1/%lu analysis buffer", div);
+            return ESP_ERR_NO_MEM;
+        }
+        slot->capacity = size;
+    }
+
+    analysis_decode_t dec = {
+        .jpeg = fb->buf,
+        .jpeg_len = fb->len,
+        .slot = slot,
+        .free_before = esp_get_free_heap_size(),
+    };
+
+    slot->valid = false;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = esp_jpg_decode(fb->len, analysis_jpg_scale[scale], analysis_jpg_read, analysis_jpg_write, &dec);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Analysis decode failed");
+        return err;
+    }
+
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+    slot->decodes++;
+    slot->total_us += elapsed_us;
+    slot->last_us = elapsed_us;
+    if (elapsed_us > slot->max_us) {
+        slot->max_us = elapsed_us;
+    }
+    if (dec.decoder_bytes > slot->decoder_bytes) {
+        slot->decoder_bytes = dec.decoder_bytes;
+    }
+
+    slot->width = dec.width;
+    slot->height = dec.height;
+    slot->src_buf = fb->buf;
+    slot->src_ts = fb->timestamp;
+    slot->valid = true;
+    return ESP_OK;
+}
+
+esp_err_t cam_config_analysis_get_scaled(cam_analysis_scale_t scale, const uint8_t **gray,
+                                         uint16_t *width, uint16_t *height)
+{
+    if (!gray || !width || !height || scale >= CAM_ANALYSIS_SCALE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const analysis_slot_t *slot = &analysis_pool[scale];
+    if (!slot->valid) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *gray = slot->gray;
+    *width = slot->width;
+    *height = slot->height;
+    return ESP_OK;
+}
+
+esp_err_t cam_config_analysis_decode(const camera_fb_t *fb)
+{
+    return cam_config_analysis_decode_scaled(fb, CAM_ANALYSIS_SCALE_1_8);
+}
+
+esp_err_t cam_config_analysis_get(const uint8_t **gray, uint16_t *width, uint16_t *height)
+{
+    return cam_config_analysis_get_scaled(CAM_ANALYSIS_SCALE_1_8, gray, width, height);
+}
+
+esp_err_t cam_config_analysis_benchmark(const camera_fb_t *fb, uint8_t rounds)
+{
+    if (!fb || rounds == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    for (int scale = 0; scale < CAM_ANALYSIS_SCALE_COUNT; scale++) {
+        // Leave the pool as found: scales nobody decodes at runtime give their buffer back
+        bool pooled = analysis_pool[scale].gray != NULL;
+        for (uint8_t i = 0; i < rounds && err == ESP_OK; i++) {
+            analysis_pool[scale].valid = false; // Force a real decode
+            err = cam_config_analysis_decode_scaled(fb, (cam_analysis_scale_t)scale);
+        }
+        if (!pooled) {
+            cam_config_analysis_release((cam_analysis_scale_t)scale);
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+void cam_config_analysis_release(cam_analysis_scale_t scale)
+{
+    if (scale >= CAM_ANALYSIS_SCALE_COUNT) {
+        return;
+    }
+
+    // Statistics (and capacity, for reporting) stay; the next decode allocates again
+    analysis_slot_t *slot = &analysis_pool[scale];
+    slot->valid = false;
+    slot->src_buf = NULL;
+    heap_caps_free(slot->gray);
+    slot->gray = NULL;
+}
+
+esp_err_t cam_config_get_analysis_stats(cam_analysis_scale_t scale, cam_analysis_stats_t *stats)
+{
+    if (!stats || scale >= CAM_ANALYSIS_SCALE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const analysis_slot_t *slot = &analysis_pool[scale];
+    memset(stats, 0, sizeof(*stats));
+    stats->width = slot->width;
+    stats->height = slot->height;
+    stats->decodes = slot->decodes;
+    stats->shared = slot->shared;
+    stats->last_us = slot->last_us;
+    stats->max_us = slot->max_us;
+    stats->buffer_bytes = slot->capacity;
+    stats->decoder_bytes = slot->decoder_bytes;
+    if (slot->decodes > 0) {
+        stats->avg_us = (uint32_t)(slot->total_us / slot->decodes);
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Change Trigger
+// ============================================================================
+
+#define TRIGGER_BLOCK       8
+
+static cam_trigger_config_t trigger_config;
+static bool trigger_enabled = false;
+static uint8_t *trigger_ref = NULL;
+static uint16_t trigger_ref_w = 0;
+static uint16_t trigger_ref_h = 0;
+static bool trigger_have_ref = false;
+static cam_trigger_stats_t trigger_stats = {0};
+static uint64_t trigger_eval_total_us = 0;
+
+// Sum of absolute differences over one block; plain row loops on contiguous
+// bytes so the compiler can unroll/vectorise them
+static uint32_t block_sad(const uint8_t *a, const uint8_t *b, uint16_t stride, uint16_t bw, uint16_t bh)
+{
+    uint32_t sad = 0;
+    for (uint16_t row = 0; row < bh; row++) {
+        for (uint16_t col = 0; col < bw; col++) {
+            int d = a[col] - b[col];
+            sad += (d < 0) ? -d : d;
+        }
+        a += stride;
+        b += stride;
+    }
+    return sad;
+}
+
+esp_err_t cam_config_trigger_enable(const cam_trigger_config_t *config)
+{
+    if (!config || config->trigger_percent > 100) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!trigger_ref) {
+        trigger_ref = heap_caps_malloc(ANALYSIS_MAX_W * ANALYSIS_MAX_H, MALLOC_CAP_SPIRAM);
+        if (!trigger_ref) {
+            ESP_LOGE(TAG, "Failed to allocate trigger buffer");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    trigger_config = *config;
+    trigger_have_ref = false;
+    trigger_enabled = true;
+    ESP_LOGI(TAG, "Change trigger enabled (block threshold %u, trigger %u%%)",
+             config->block_threshold, config->trigger_percent);
+    return ESP_OK;
+}
+
+void cam_config_trigger_disable(void)
+{
+    trigger_enabled = false;
+    heap_caps_free(trigger_ref);
+    trigger_ref = NULL;
+    trigger_have_ref = false;
+}
+
+bool cam_config_trigger_evaluate(const camera_fb_t *fb)
+{
+    if (!trigger_enabled || !fb || fb->format != PIXFORMAT_JPEG) {
+        return true; // Trigger disabled: keep every frame
+    }
+
+    int64_t start_us = esp_timer_get_time();
+
+    const uint8_t *cur;
+    uint16_t width, height;
+    if (cam_config_analysis_decode(fb) != ESP_OK ||
+        cam_config_analysis_get(&cur, &width, &height) != ESP_OK) {
+        ESP_LOGW(TAG, "Trigger decode failed, keeping frame");
+        return true;
+    }
+
+    bool triggered = true;
+    uint8_t changed_percent = 100;
+
+    if (trigger_have_ref && width == trigger_ref_w && height == trigger_ref_h) {
+        uint32_t blocks = 0;
+        uint32_t changed = 0;
+
+        for (uint16_t by = 0; by + TRIGGER_BLOCK <= height; by += TRIGGER_BLOCK) {
+            for (uint16_t bx = 0; bx + TRIGGER_BLOCK <= width; bx += TRIGGER_BLOCK) {
+                size_t offset = by * width + bx;
+                uint32_t sad = block_sad(cur + offset, trigger_ref + offset,
+                                         width, TRIGGER_BLOCK, TRIGGER_BLOCK);
+                if (sad > (uint32_t)trigger_config.block_threshold * TRIGGER_BLOCK * TRIGGER_BLOCK) {
+                    changed++;
+                }
+                blocks++;
+            }
+        }
+
+        changed_percent = blocks ? (uint8_t)(changed * 100 / blocks) : 0;
+        triggered = changed_percent >= trigger_config.trigger_percent;
+    }
+
+    // Current frame becomes the reference for the next evaluation
+    memcpy(trigger_ref, cur, (size_t)width * height);
+    trigger_ref_w = width;
+    trigger_ref_h = height;
+    trigger_have_ref = true;
+
+    uint32_t eval_us = (uint32_t)(esp_timer_get_time() - start_us);
+    trigger_stats.evaluated++;
+    trigger_stats.last_eval_us = eval_us;
+    trigger_stats.last_changed_percent = changed_percent;
+    trigger_stats.bytes_evaluated += fb->len;
+    trigger_eval_total_us += eval_us;
+    if (triggered) {
+        trigger_stats.triggered++;
+        trigger_stats.bytes_triggered += fb->len;
+        ESP_LOGD(TAG, "Change trigger fired (%u%% blocks changed)", changed_percent);
+    }
+
+    return triggered;
+}
+
+esp_err_t cam_config_get_trigger_stats(cam_trigger_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *stats = trigger_stats;
+    if (trigger_stats.evaluated > 0) {
+        stats->avg_eval_us = (uint32_t)(trigger_eval_total_us / trigger_stats.evaluated);
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Adaptive Quality
+// ============================================================================
+
+// Quality ladder, largest images first. rel_size is the rough JPEG size
+// relative to SVGA q12 (= 100), used to predict the size of other levels
+// from what the current level actually produces.
+typedef struct {
+    framesize_t frame_size;
+    uint8_t quality;
+    uint8_t rel_size;
+    const char *name;
+} adaptive_level_t;
+
+static const adaptive_level_t adaptive_ladder[] = {
+    {FRAMESIZE_SVGA, 10, 120, "SVGA q10"},
+    {FRAMESIZE_SVGA, 12, 100, "SVGA q12"},
+    {FRAMESIZE_SVGA, 16, 75,  "SVGA q16"},
+    {FRAMESIZE_VGA,  14, 55,  "VGA q14"},
+    {FRAMESIZE_VGA,  20, 40,  "VGA q20"},
+    {FRAMESIZE_CIF,  20, 25,  "CIF q20"},
+    {FRAMESIZE_QVGA, 25, 15,  "QVGA q25"},
+};
+#define ADAPTIVE_LEVELS     (sizeof(adaptive_ladder) / sizeof(adaptive_ladder[0]))
+#define ADAPTIVE_START      1   // SVGA q12, as set by cam_config_init
+#define ADAPTIVE_EWMA_SHIFT 2   // New samples weigh 1/4
+
+static cam_adaptive_config_t adaptive_config;
+static bool adaptive_enabled = false;
+static cam_adaptive_stats_t adaptive_stats = {0};
+static uint8_t adaptive_hold = 0;
+static volatile int adaptive_pending = -1;  // Level to apply on the next capture
+
+static uint32_t ewma(uint32_t avg, uint32_t sample)
+{
+    if (avg == 0) {
+        return sample;
+    }
+    return (uint32_t)((int64_t)avg + ((int64_t)sample - avg) / (1 << ADAPTIVE_EWMA_SHIFT));
+}
+
+// Upload time a ladder level would need at the current throughput
+static uint32_t adaptive_predict_ms(uint8_t level)
+{
+    uint64_t bytes = (uint64_t)adaptive_stats.avg_bytes * adaptive_ladder[level].rel_size /
+                     adaptive_ladder[adaptive_stats.level].rel_size;
+    return (uint32_t)(bytes * 1000 / adaptive_stats.throughput_bps);
+}
+
+static void adaptive_apply_pending(void)
+{
+    int level = adaptive_pending;
+    if (level < 0 || product_is_roi()) {
+        return; // Applied when the full product is active again
+    }
+    adaptive_pending = -1;
+
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s) {
+        return;
+    }
+
+    const adaptive_level_t *l = &adaptive_ladder[level];
+    if (s->status.framesize != l->frame_size) {
+        s->set_framesize(s, l->frame_size);
+    }
+    if (s->status.quality != l->quality) {
+        s->set_quality(s, l->quality);
+    }
+}
+
+esp_err_t cam_config_adaptive_enable(const cam_adaptive_config_t *config)
+{
+    if (!config || config->target_latency_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    adaptive_config = *config;
+    memset(&adaptive_stats, 0, sizeof(adaptive_stats));
+    adaptive_stats.level = ADAPTIVE_START;
+    adaptive_stats.frame_size = adaptive_ladder[ADAPTIVE_START].frame_size;
+    adaptive_stats.jpeg_quality = adaptive_ladder[ADAPTIVE_START].quality;
+    adaptive_hold = config->hold_images;
+    adaptive_enabled = true;
+
+    ESP_LOGI(TAG, "Adaptive quality enabled (target %lu ms per image)", config->target_latency_ms);
+    return ESP_OK;
+}
+
+void cam_config_adaptive_report(size_t image_bytes, uint32_t upload_ms)
+{
+    if (!adaptive_enabled || image_bytes == 0) {
+        return;
+    }
+    if (upload_ms == 0) {
+        upload_ms = 1;
+    }
+
+    adaptive_stats.avg_bytes = ewma(adaptive_stats.avg_bytes, image_bytes);
+    adaptive_stats.avg_latency_ms = ewma(adaptive_stats.avg_latency_ms, upload_ms);
+    adaptive_stats.throughput_bps = ewma(adaptive_stats.throughput_bps,
+                                         (uint32_t)((uint64_t)image_bytes * 1000 / upload_ms));
+
+    ESP_LOGD(TAG, "Adaptive: %zu bytes in %lu ms (%s)", image_bytes, upload_ms,
+             adaptive_ladder[adaptive_stats.level].name);
+
+    if (adaptive_hold > 0) {
+        adaptive_hold--;
+        return;
+    }
+
+    uint8_t level = adaptive_stats.level;
+    uint32_t target = adaptive_config.target_latency_ms;
+
+    if (adaptive_stats.avg_latency_ms > target + target / 4 && level + 1 < ADAPTIVE_LEVELS) {
+        // Too slow: step down to smaller images
+        level++;
+    } else if (level > 0 && adaptive_stats.throughput_bps > 0 &&
+               adaptive_predict_ms(level - 1) < target - target / 4) {
+        // Headroom: the next larger level still fits comfortably
+        level--;
+    }
+
+    if (level == adaptive_stats.level) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Adaptive: %s -> %s (throughput %lu B/s, %lu bytes/image, %lu ms/image, target %lu ms)",
+             adaptive_ladder[adaptive_stats.level].name, adaptive_ladder[level].name,
+             adaptive_stats.throughput_bps, adaptive_stats.avg_bytes,
+             adaptive_stats.avg_latency_ms, target);
+
+    // Rescale the size estimate to the new level until real samples arrive
+    adaptive_stats.avg_bytes = (uint32_t)((uint64_t)adaptive_stats.avg_bytes * adaptive_ladder[level].rel_size /
+                                          adaptive_ladder[adaptive_stats.level].rel_size);
+    adaptive_stats.avg_latency_ms = 0;
+    adaptive_stats.level = level;
+    adaptive_stats.frame_size = adaptive_ladder[level].frame_size;
+    adaptive_stats.jpeg_quality = adaptive_ladder[level].quality;
+    adaptive_stats.changes++;
+    adaptive_hold = adaptive_config.hold_images;
+    adaptive_pending = level;
+}
+
+esp_err_t cam_config_get_adaptive_stats(cam_adaptive_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!adaptive_enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *stats = adaptive_stats;
+    return ESP_OK;
+}
+
+// ============================================================================
+// Image Products
+// ============================================================================
+
+#define SENSOR_UXGA_W       1600
+#define SENSOR_UXGA_H       1200
+#define OV2640_MODE_UXGA    0   // set_res_raw() startX selects the OV2640 sensor mode
+#define PRODUCT_DISCARD     2   // Frames queued under the old window, or the newest one plus one in flight
+
+static cam_roi_t product_roi;
+static bool product_roi_valid = false;
+static cam_product_t product_active = CAM_PRODUCT_FULL;
+static cam_product_stats_t product_stats[CAM_PRODUCT_COUNT];
+static uint64_t product_bytes_total[CAM_PRODUCT_COUNT];
+static uint64_t product_latency_total[CAM_PRODUCT_COUNT];
+
+static bool product_is_roi(void)
+{
+    return product_active == CAM_PRODUCT_ROI;
+}
+
+esp_err_t cam_config_set_roi(const cam_roi_t *roi)
+{
+    if (!roi || roi->width == 0 || roi->height == 0 ||
+        roi->x + roi->width > SENSOR_UXGA_W || roi->y + roi->height > SENSOR_UXGA_H ||
+        roi->out_width == 0 || roi->out_height == 0 ||
+        roi->out_width > roi->width || roi->out_height > roi->height ||
+        (roi->width | roi->height | roi->out_width | roi->out_height) % 4 != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    product_roi = *roi;
+    product_roi_valid = true;
+    if (product_active == CAM_PRODUCT_ROI) {
+        product_active = CAM_PRODUCT_COUNT; // Force reprogramming on the next ROI capture
+    }
+
+    ESP_LOGI(TAG, "ROI set to %ux%u at (%u,%u), output %ux%u q%u",
+             roi->width, roi->height, roi->x, roi->y, roi->out_width, roi->out_height, roi->jpeg_quality);
+    return ESP_OK;
+}
+
+// Reprogram the sensor for a product; true on success
+static bool product_switch(sensor_t *s, cam_product_t product)
+{
+    if (product == CAM_PRODUCT_ROI) {
+        if (s->set_res_raw(s, OV2640_MODE_UXGA, 0, 0, 0,
+                           product_roi.x, product_roi.y, product_roi.width, product_roi.height,
+                           product_roi.out_width, product_roi.out_height, false, false) != 0) {
+            return false;
+        }
+        s->set_quality(s, product_roi.jpeg_quality);
+    } else {
+        // Back to the full frame at the adaptive level (or the init settings)
+        framesize_t size = adaptive_enabled ? adaptive_stats.frame_size : FRAMESIZE_SVGA;
+        uint8_t quality = adaptive_enabled ? adaptive_stats.jpeg_quality : 12;
+        if (s->set_framesize(s, size) != 0) {
+            return false;
+        }
+        s->set_quality(s, quality);
+        adaptive_pending = -1; // Just applied
+    }
+    return true;
+}
+
+camera_fb_t* cam_config_capture_product(cam_product_t product)
+{
+    if (product >= CAM_PRODUCT_COUNT || (product == CAM_PRODUCT_ROI && !product_roi_valid)) {
+        return NULL;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+
+    if (product != product_active) {
+        sensor_t *s = esp_camera_sensor_get();
+        if (!s || !product_switch(s, product)) {
+            ESP_LOGE(TAG, "Failed to switch image product");
+            product_active = CAM_PRODUCT_COUNT;
+            return NULL;
+        }
+        product_active = product;
+        product_stats[product].switches++;
+
+        // Drop frames exposed under the previous window
+        for (int i = 0; i < PRODUCT_DISCARD; i++) {
+            cam_config_return_fb(esp_camera_fb_get());
+        }
+    }
+
+    camera_fb_t *fb = cam_config_capture();
+    if (!fb) {
+        return NULL;
+    }
+
+    cam_product_stats_t *st = &product_stats[product];
+    st->captures++;
+    st->last_bytes = fb->len;
+    st->last_latency_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    product_bytes_total[product] += fb->len;
+    product_latency_total[product] += st->last_latency_ms;
+    return fb;
+}
+
+esp_err_t cam_config_get_product_stats(cam_product_t product, cam_product_stats_t *stats)
+{
+    if (!stats || product >= CAM_PRODUCT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *stats = product_stats[product];
+    if (stats->captures > 0) {
+        stats->avg_bytes = (uint32_t)(product_bytes_total[product] / stats->captures);
+        stats->avg_latency_ms = (uint32_t)(product_latency_total[product] / stats->captures);
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Warm Start
+// ============================================================================
+
+// OV2640 sensor-bank registers as addressed by get_reg/set_reg (bank 1 << 8)
+#define OV2640_REG_GAIN     0x100   // AGC gain
+#define OV2640_REG_REG04    0x104   // AEC[1:0] in bits 1:0
+#define OV2640_REG_AEC      0x110   // AEC[9:2]
+#define OV2640_REG_REG45    0x145   // AEC[15:10] in bits 5:0
+
+#define WARM_MAGIC              0x57524D31  // "WRM1"
+#define WARM_SNAPSHOT_INTERVAL_US (10 * 1000000LL)
+#define WARM_APPLY_DELAY_US     (100 * 1000)  // Frames older than this after restore used init defaults
+
+#define STARTUP_MAX_FRAMES      40
+#define STARTUP_STABLE_FRAMES   3   // Frames in a row within tolerance
+#define STARTUP_TOLERANCE_PCT   4   // Mean luma change allowed between them
+
+typedef struct {
+    uint32_t magic;
+    uint16_t aec;
+    uint8_t gain;
+    uint32_t last_cold_ms;
+    uint32_t last_warm_ms;
+    uint32_t check;             // magic ^ payload, catches power-on garbage
+} warm_state_t;
+
+// Survives deep sleep and software resets; validated by magic and check
+static RTC_NOINIT_ATTR warm_state_t warm_state;
+
+static bool warm_restored = false;
+static bool warm_resume_pending = false;
+static int64_t warm_restore_us = 0;
+static int64_t warm_last_snapshot_us = 0;
+
+static uint32_t warm_check(const warm_state_t *w)
+{
+    return w->magic ^ ((uint32_t)w->aec << 16 | w->gain) ^
+           (w->last_cold_ms * 31) ^ (w->last_warm_ms * 17);
+}
+
+static bool warm_valid(void)
+{
+    return warm_state.magic == WARM_MAGIC && warm_state.check == warm_check(&warm_state);
+}
+
+static void warm_seal(void)
+{
+    warm_state.magic = WARM_MAGIC;
+    warm_state.check = warm_check(&warm_state);
+}
+
+static void warm_restore(sensor_t *s)
+{
+    warm_restored = false;
+    warm_resume_pending = false;
+    if (!warm_valid()) {
+        memset(&warm_state, 0, sizeof(warm_state));
+        warm_seal();
+        return;
+    }
+    if (warm_state.aec == 0) {
+        return; // Timing records only, no exposure snapshot yet
+    }
+
+    // Manual exposure/gain for the first frame, AEC/AGC resume from there
+    s->set_exposure_ctrl(s, 0);
+    s->set_gain_ctrl(s, 0);
+    s->set_reg(s, OV2640_REG_REG04, 0x03, warm_state.aec & 0x03);
+    s->set_reg(s, OV2640_REG_AEC, 0xFF, (warm_state.aec >> 2) & 0xFF);
+    s->set_reg(s, OV2640_REG_REG45, 0x3F, (warm_state.aec >> 10) & 0x3F);
+    s->set_reg(s, OV2640_REG_GAIN, 0xFF, warm_state.gain);
+
+    warm_restored = true;
+    warm_resume_pending = true;
+    warm_restore_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Warm start: exposure %u, gain 0x%02X restored", warm_state.aec, warm_state.gain);
+}
+
+static int64_t fb_time_us(const camera_fb_t *fb)
+{
+    return (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+}
+
+// After a warm restore: skip frames exposed before the restored values took
+// effect, then switch auto exposure/gain back on
+static camera_fb_t *warm_first_frame(camera_fb_t *fb)
+{
+    if (!warm_resume_pending) {
+        return fb;
+    }
+
+    while (fb && fb_time_us(fb) < warm_restore_us + WARM_APPLY_DELAY_US) {
+        esp_camera_fb_return(fb);
+        fb = esp_camera_fb_get();
+    }
+
+    sensor_t *s = esp_camera_sensor_get();
+    if (s) {
+        s->set_exposure_ctrl(s, 1);
+        s->set_gain_ctrl(s, 1);
+    }
+    warm_resume_pending = false;
+    return fb;
+}
+
+static uint8_t analysis_mean_luma(void)
+{
+    const uint8_t *gray;
+    uint16_t w, h;
+    if (cam_config_analysis_get(&gray, &w, &h) != ESP_OK || w == 0 || h == 0) {
+        return 0;
+    }
+    uint32_t sum = 0;
+    uint32_t pixels = (uint32_t)w * h;
+    for (uint32_t i = 0; i < pixels; i++) {
+        sum += gray[i];
+    }
+    return (uint8_t)(sum / pixels);
+}
+
+esp_err_t cam_config_warm_snapshot(void)
+{
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s || product_active != CAM_PRODUCT_FULL ||
+        s->status.framesize != FRAMESIZE_SVGA || warm_resume_pending) {
+        return ESP_ERR_INVALID_STATE; // AEC lines differ between sensor modes
+    }
+
+    int r04 = s->get_reg(s, OV2640_REG_REG04, 0x03);
+    int aec = s->get_reg(s, OV2640_REG_AEC, 0xFF);
+    int r45 = s->get_reg(s, OV2640_REG_REG45, 0x3F);
+    int gain = s->get_reg(s, OV2640_REG_GAIN, 0xFF);
+    if (r04 < 0 || aec < 0 || r45 < 0 || gain < 0) {
+        return ESP_FAIL;
+    }
+
+    if (!warm_valid()) {
+        memset(&warm_state, 0, sizeof(warm_state));
+    }
+    warm_state.aec = (uint16_t)((r45 << 10) | (aec << 2) | r04);
+    warm_state.gain = (uint8_t)gain;
+    warm_seal();
+    warm_last_snapshot_us = esp_timer_get_time();
+
+    ESP_LOGD(TAG, "Warm snapshot: exposure %u, gain 0x%02X", warm_state.aec, warm_state.gain);
+    return ESP_OK;
+}
+
+static void warm_autosnapshot(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    // Leave AE time to converge after init before trusting its values
+    if (now_us - init_start_us < WARM_SNAPSHOT_INTERVAL_US ||
+        now_us - warm_last_snapshot_us < WARM_SNAPSHOT_INTERVAL_US) {
+        return;
+    }
+    warm_last_snapshot_us = now_us; // Also throttles failed attempts
+    cam_config_warm_snapshot();
+}
+
+esp_err_t cam_config_measure_startup(cam_startup_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->warm = warm_restored;
+    stats->init_ms = init_ms;
+
+    int64_t frame_us[STARTUP_MAX_FRAMES];
+    uint8_t luma[STARTUP_MAX_FRAMES];
+    int first_good = -1;
+
+    for (int i = 0; i < STARTUP_MAX_FRAMES && first_good < 0; i++) {
+        camera_fb_t *fb = cam_config_capture();
+        if (!fb) {
+            return ESP_FAIL;
+        }
+        frame_us[i] = fb_time_us(fb);
+        luma[i] = (cam_config_analysis_decode(fb) == ESP_OK) ? analysis_mean_luma() : 0;
+        esp_camera_fb_return(fb);
+
+        // Settled once the last STARTUP_STABLE_FRAMES agree with each other
+        int start = i - (STARTUP_STABLE_FRAMES - 1);
+        if (start < 0) {
+            continue;
+        }
+        bool stable = true;
+        for (int j = start + 1; j <= i; j++) {
+            int diff = luma[j] - luma[j - 1];
+            if (diff < 0) {
+                diff = -diff;
+            }
+            if (diff * 100 > STARTUP_TOLERANCE_PCT * (luma[j - 1] + 1)) {
+                stable = false;
+                break;
+            }
+        }
+        if (stable) {
+            first_good = start;
+        }
+    }
+
+    if (first_good < 0) {
+        ESP_LOGW(TAG, "Brightness did not settle within %d frames", STARTUP_MAX_FRAMES);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    stats->frames = (uint8_t)(first_good + 1);
+    stats->first_good_ms = (uint32_t)((frame_us[first_good] - init_start_us) / 1000);
+
+    if (!warm_valid()) {
+        memset(&warm_state, 0, sizeof(warm_state));
+    }
+    if (stats->warm) {
+        warm_state.last_warm_ms = stats->first_good_ms;
+    } else {
+        warm_state.last_cold_ms = stats->first_good_ms;
+    }
+    warm_seal();
+    stats->last_cold_ms = warm_state.last_cold_ms;
+    stats->last_warm_ms = warm_state.last_warm_ms;
+
+    ESP_LOGI(TAG, "%s start: first settled frame after %lu ms (%u frames, init %lu ms)",
+             stats->warm ? "Warm" : "Cold", stats->first_good_ms, stats->frames, stats->init_ms);
+    return ESP_OK;
+}
@@ -8,11 +8,32 @@
 
 #include "esp_camera.h"
 #include "esp_err.h"
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Frame buffers in PSRAM. The driver only takes the pool size and grab mode
+// at init, so burst mode has to be chosen before cam_config_init().
+#define CAM_FB_COUNT 2        // Default: double buffering, frames handed out in order
+#define CAM_FB_COUNT_BURST 4  // Burst mode: deep pool, newest frame first
+
+/**
+ * @brief Choose the frame pool for the next cam_config_init()
+ *
+ * Burst mode runs the driver in grab-latest mode with CAM_FB_COUNT_BURST
+ * buffers so back-to-back captures run at sensor frame rate. It costs two
+ * more SVGA frame buffers of PSRAM, so enable it only when bursts are used.
+ * @param enabled true for burst mode
+ */
+void cam_config_set_burst_mode(bool enabled);
+
+/**
+ * @brief Whether the camera was initialized in burst mode
+ */
+bool cam_config_burst_mode(void);
+
 /**
  * @brief Initialize camera with default configuration
  * @return ESP_OK on success
@@ -27,6 +48,7 @@ esp_err_t cam_config_deinit(void);
 
 /**
  * @brief Capture a single frame
+ * In burst mode this is the newest complete frame, otherwise the oldest queued one.
  * @return Pointer to camera frame buffer, NULL on error
  */
 camera_fb_t* cam_config_capture(void);
@@ -43,6 +65,313 @@ void cam_config_return_fb(camera_fb_t *fb);
  */
 sensor_t* cam_config_get_sensor(void);
 
+// ============================================================================
+// Analysis Frames (downscaled grayscale shared by analysis stages)
+// ============================================================================
+
+/**
+ * @brief Analysis decode scale
+ */
+typedef enum {
+    CAM_ANALYSIS_SCALE_1_2 = 0,   // 400x300 from SVGA
+    CAM_ANALYSIS_SCALE_1_4,       // 200x150 from SVGA
+    CAM_ANALYSIS_SCALE_1_8,       // 100x75 from SVGA (default for all stages)
+    CAM_ANALYSIS_SCALE_COUNT,
+} cam_analysis_scale_t;
+
+/**
+ * @brief Analysis decode statistics for one scale
+ */
+typedef struct {
+    uint16_t width;               // Size of the last decoded frame
+    uint16_t height;
+    uint32_t decodes;             // JPEG decodes run
+    uint32_t shared;              // Requests served from the frame already decoded
+    uint32_t last_us;             // Decode time of the last frame
+    uint32_t avg_us;              // Average decode time
+    uint32_t max_us;              // Worst decode time
+    uint32_t buffer_bytes;        // Grayscale buffer size (PSRAM, allocated on first decode)
+    uint32_t decoder_bytes;       // Peak heap used by the JPEG decoder itself
+} cam_analysis_stats_t;
+
+/**
+ * @brief Decode a JPEG frame at the given scale into that scale's pooled buffer
+ *
+ * Each scale has one cache-line-aligned PSRAM buffer, allocated on first
+ * use for the largest frame size and reused for every frame after that.
+ * Decoding the same frame twice is a no-op, so every stage can call this.
+ *
+ * @param fb JPEG frame buffer
+ * @param scale Output scale
+ * @return ESP_OK on success
+ */
+esp_err_t cam_config_analysis_decode_scaled(const camera_fb_t *fb, cam_analysis_scale_t scale);
+
+/**
+ * @brief Get the last frame decoded at the given scale
+ * The buffer stays valid until the next decode at that scale.
+ * @param scale Output scale
+ * @param gray Receives pointer to width*height luma bytes
+ * @param width Receives frame width
+ * @param height Receives frame height
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if nothing was decoded
+ */
+esp_err_t cam_config_analysis_get_scaled(cam_analysis_scale_t scale, const uint8_t **gray,
+                                         uint16_t *width, uint16_t *height);
+
+/**
+ * @brief Decode a JPEG frame at 1/8 scale (cam_config_analysis_decode_scaled)
+ * @param fb JPEG frame buffer
+ * @return ESP_OK on success
+ */
+esp_err_t cam_config_analysis_decode(const camera_fb_t *fb);
+
+/**
+ * @brief Get the last 1/8-scale frame (cam_config_analysis_get_scaled)
+ * @param gray Receives pointer to width*height luma bytes
+ * @param width Receives frame width
+ * @param height Receives frame height
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if nothing was decoded
+ */
+esp_err_t cam_config_analysis_get(const uint8_t **gray, uint16_t *width, uint16_t *height);
+
+/**
+ * @brief Decode one frame rounds times at every scale to fill the statistics
+ * Buffers the benchmark had to allocate (about 600 KB of PSRAM for 1/2 and
+ * 1/4) are released again before it returns.
+ * @param fb JPEG frame buffer
+ * @param rounds Decodes per scale
+ * @return ESP_OK on success
+ */
+esp_err_t cam_config_analysis_benchmark(const camera_fb_t *fb, uint8_t rounds);
+
+/**
+ * @brief Free a scale's pooled grayscale buffer; the next decode at that scale allocates it again
+ * @param scale Output scale
+ */
+void cam_config_analysis_release(cam_analysis_scale_t scale);
+
+/**
+ * @brief Get analysis decode statistics
+ * @param scale Output scale
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t cam_config_get_analysis_stats(cam_analysis_scale_t scale, cam_analysis_stats_t *stats);
+
+// ============================================================================
+// Change Trigger (downscaled frame differencing)
+// ============================================================================
+
+/**
+ * @brief Change trigger configuration
+ */
+typedef struct {
+    uint8_t block_threshold;   // Mean absolute difference per pixel (0-255) for a block to count as changed
+    uint8_t trigger_percent;   // Percentage of changed blocks needed to trigger
+} cam_trigger_config_t;
+
+/**
+ * @brief Change trigger statistics
+ */
+typedef struct {
+    uint32_t evaluated;        // Frames evaluated
+    uint32_t triggered;        // Frames that passed the threshold
+    uint8_t last_changed_percent; // Changed blocks in the last evaluated frame
+    uint32_t last_eval_us;     // CPU time of the last evaluation (decode + diff)
+    uint32_t avg_eval_us;      // Average CPU time per evaluated frame
+    uint64_t bytes_evaluated;  // JPEG bytes of all evaluated frames
+    uint64_t bytes_triggered;  // JPEG bytes of triggered frames
+} cam_trigger_stats_t;
+
+/**
+ * @brief Enable the change trigger and allocate its buffers
+ * @param config Trigger configuration
+ * @return ESP_OK on success
+ */
+esp_err_t cam_config_trigger_enable(const cam_trigger_config_t *config);
+
+/**
+ * @brief Disable the change trigger and free its buffers
+ */
+void cam_config_trigger_disable(void);
+
+/**
+ * @brief Evaluate a JPEG frame against the previously evaluated one
+ *
+ * The frame's analysis buffer (see cam_config_analysis_decode) is compared
+ * block by block. The first frame after enabling always triggers.
+ *
+ * @param fb JPEG frame buffer
+ * @return true if the scene changed enough to keep this frame
+ */
+bool cam_config_trigger_evaluate(const camera_fb_t *fb);
+
+/**
+ * @brief Get change trigger statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t cam_config_get_trigger_stats(cam_trigger_stats_t *stats);
+
+// ============================================================================
+// Adaptive Quality (frame size / JPEG quality driven by upload throughput)
+// ============================================================================
+
+/**
+ * @brief Adaptive quality configuration
+ */
+typedef struct {
+    uint32_t target_latency_ms;  // Desired upload time per image
+    uint8_t hold_images;         // Uploads to observe after a change before deciding again
+} cam_adaptive_config_t;
+
+/**
+ * @brief Adaptive quality statistics
+ */
+typedef struct {
+    uint8_t level;               // Current ladder level (0 = largest images)
+    framesize_t frame_size;      // Current frame size
+    uint8_t jpeg_quality;        // Current JPEG quality (lower = better)
+    uint32_t throughput_bps;     // Smoothed upload throughput (bytes/s)
+    uint32_t avg_bytes;          // Smoothed bytes per image at the current level
+    uint32_t avg_latency_ms;     // Smoothed upload time per image
+    uint32_t changes;            // Level changes so far
+} cam_adaptive_stats_t;
+
+/**
+ * @brief Enable the adaptive quality controller
+ * Starts from the cam_config_init settings (SVGA, quality 12).
+ * @param config Controller configuration
+ * @return ESP_OK on success
+ */
+esp_err_t cam_config_adaptive_enable(const cam_adaptive_config_t *config);
+
+/**
+ * @brief Feed the result of one image upload to the controller
+ * A resulting change of frame size or quality is applied through the
+ * sensor setters on the next cam_config_capture(), without reinitialising
+ * the camera.
+ * @param image_bytes Size of the uploaded JPEG
+ * @param upload_ms Time the upload took
+ */
+void cam_config_adaptive_report(size_t image_bytes, uint32_t upload_ms);
+
+/**
+ * @brief Get adaptive quality statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t cam_config_get_adaptive_stats(cam_adaptive_stats_t *stats);
+
+// ============================================================================
+// Image Products (full frame / sensor-windowed region of interest)
+// ============================================================================
+
+/**
+ * @brief Image product captured by cam_config_capture_product()
+ */
+typedef enum {
+    CAM_PRODUCT_FULL = 0,        // Whole scene at the configured (or adaptive) frame size
+    CAM_PRODUCT_ROI,             // Region of interest cut out by the sensor window
+    CAM_PRODUCT_COUNT
+} cam_product_t;
+
+/**
+ * @brief Region of interest in OV2640 UXGA sensor coordinates (1600x1200)
+ */
+typedef struct {
+    uint16_t x;                  // Window left edge
+    uint16_t y;                  // Window top edge
+    uint16_t width;              // Window width (multiple of 4)
+    uint16_t height;             // Window height (multiple of 4)
+    uint16_t out_width;          // Output width, <= width (multiple of 4)
+    uint16_t out_height;         // Output height, <= height (multiple of 4)
+    uint8_t jpeg_quality;        // JPEG quality of ROI images
+} cam_roi_t;
+
+/**
+ * @brief Per-product statistics
+ */
+typedef struct {
+    uint32_t captures;           // Frames delivered
+    uint32_t switches;           // Sensor reconfigurations into this product
+    uint32_t last_bytes;         // JPEG size of the last frame
+    uint32_t avg_bytes;          // Average JPEG size
+    uint32_t last_latency_ms;    // Request-to-frame time of the last capture (including any switch)
+    uint32_t avg_latency_ms;     // Average request-to-frame time
+} cam_product_stats_t;
+
+/**
+ * @brief Set the region of interest used by CAM_PRODUCT_ROI
+ * @param roi Window and output size
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the window is off-sensor
+ */
+esp_err_t cam_config_set_roi(const cam_roi_t *roi);
+
+/**
+ * @brief Capture a frame of the given product
+ *
+ * Switching products reprograms the sensor window and discards the frames
+ * that were already queued in the old configuration, so alternating
+ * products costs a few frame times. Adaptive quality changes only apply to
+ * the full product and wait while the ROI is active.
+ *
+ * @param product Product to capture
+ * @return Pointer to camera frame buffer, NULL on error
+ */
+camera_fb_t* cam_config_capture_product(cam_product_t product);
+
+/**
+ * @brief Get statistics for one product
+ * @param product Product
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t cam_config_get_product_stats(cam_product_t product, cam_product_stats_t *stats);
+
+// ============================================================================
+// Warm Start (converged exposure/gain kept in RTC memory)
+// ============================================================================
+
+/**
+ * @brief Startup measurement (init to first good frame)
+ */
+typedef struct {
+    bool warm;                   // Exposure/gain were restored from RTC memory
+    uint32_t init_ms;            // Time spent in cam_config_init()
+    uint32_t first_good_ms;      // cam_config_init() start to the first settled frame
+    uint8_t frames;              // Frames captured until the first settled one
+    uint32_t last_cold_ms;       // first_good_ms of the most recent cold start (0 = none yet)
+    uint32_t last_warm_ms;       // first_good_ms of the most recent warm start (0 = none yet)
+} cam_startup_stats_t;
+
+/**
+ * @brief Save the current converged exposure and gain to RTC memory
+ *
+ * cam_config_capture() also does this on its own every few seconds once
+ * the full SVGA frame is active, so an explicit call is only needed right
+ * before sleeping. The next cam_config_init() (after deep sleep or a
+ * software reset) restores these values with auto exposure/gain off for
+ * the first frame, then hands control back to AEC/AGC from there.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the sensor is not in
+ *         the full SVGA configuration
+ */
+esp_err_t cam_config_warm_snapshot(void);
+
+/**
+ * @brief Capture frames until brightness settles and report startup latency
+ *
+ * Call right after cam_config_init(). A frame counts as good when it starts
+ * a run of frames whose mean luma stays within a few percent, i.e. auto
+ * exposure has converged. The same criterion applies to cold and warm starts.
+ *
+ * @param stats Receives the measurement
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if brightness never settled
+ */
+esp_err_t cam_config_measure_startup(cam_startup_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
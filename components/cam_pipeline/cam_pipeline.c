@@ -0,0 +1,1332 @@
+/**
+ * @file cam_pipeline.c
+ * @brief Camera Capture Pipeline Implementation
+ *
+ * The capture task copies each JPEG into a PSRAM ring slot and returns the
+ * camera frame buffer immediately, so capture cadence does not depend on the
+ * uplink. The upload worker drains the ring oldest-first. When the ring is
+ * full the oldest queued frame is overwritten. With the spool enabled,
+ * frames that cannot be sent (link down, retries exhausted) move to flash
+ * and are drained once the link is back and the ring is empty.
+ *
+ * With snapshot records enabled, each slot also holds the sensor readings
+ * taken at capture time. The record references the slot's JPEG and both go
+ * out together: as the manifest of a one-image multipart request over HTTP,
+ * or inside the image meta message over MQTT. The record travels with the
+ * frame through the flash spool as well.
+ */
+
+#include "cam_pipeline.h"
+#include "cam_config.h"
+#include "app_network.h"
+#include "live_view.h"
+#include "sensor_mpu6050.h"
+#include "image_spool.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+static const char *TAG = "CAM_PIPELINE";
+
+#define UPLOAD_MAX_ATTEMPTS 3
+#define UPLOAD_RETRY_DELAY_MS 1000
+#define BATCH_MANIFEST_SIZE 2048
+#define CLOCK_VALID_AFTER_S 1577836800 // 2020-01-01: an earlier system time was never set
+
+typedef enum {
+    SLOT_FREE = 0,
+    SLOT_READY,   // Captured, waiting for upload
+    SLOT_SENDING, // Owned by the upload worker
+} slot_state_t;
+
+// Burst membership of a queued frame
+typedef struct {
+    uint32_t event_id;  // 0 = not part of a burst
+    int64_t event_us;   // Trigger time (esp_timer)
+    int32_t offset_ms;  // Frame timestamp relative to the trigger
+    uint8_t index;      // Position in the burst
+} burst_tag_t;
+
+// Frame metadata carried through the flash spool; the slot's record goes
+// along as the spool context
+typedef struct __attribute__((packed)) {
+    uint8_t product;
+    uint8_t index;
+    uint32_t event_id;
+    int32_t offset_ms;
+    uint32_t event_ms;
+    uint32_t capture_ms;
+    int64_t capture_utc_ms;
+    uint32_t seq;
+} spool_meta_t;
+
+_Static_assert(sizeof(spool_meta_t) <= IMAGE_SPOOL_META_SIZE, "spool meta too large");
+_Static_assert(CAM_PIPELINE_SNAPSHOT_SIZE <= IMAGE_SPOOL_CONTEXT_MAX, "record does not fit the spool context");
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    char *record;       // Snapshot record or manifest context (after the JPEG area; NULL = neither)
+    int record_len;     // 0 = no record for this frame
+    uint32_t seq;
+    int64_t capture_us;
+    int64_t capture_utc_ms; // 0 = clock not set
+    uint8_t attempts;
+    cam_product_t product;
+    burst_tag_t burst;
+    slot_state_t state;
+} frame_slot_t;
+
+static frame_slot_t ring[CAM_PIPELINE_RING_SLOTS];
+static SemaphoreHandle_t ring_mutex = NULL;
+static SemaphoreHandle_t frame_ready = NULL;
+static SemaphoreHandle_t snapshot_mutex = NULL; // Guards snapshot_record (upload and spool drain tasks)
+static char snapshot_record[BATCH_MANIFEST_SIZE];
+static cam_pipeline_config_t pipeline_config;
+static uint32_t next_seq = 0;
+static bool running = false;
+static TaskHandle_t capture_handle = NULL;
+
+static volatile bool burst_pending = false;
+static int64_t burst_trigger_us = 0; // Guarded by ring_mutex
+static uint32_t burst_event_id = 0;
+
+static cam_pipeline_stats_t stats = {0};
+static uint64_t latency_total_ms = 0;
+
+static rain_detector_t rain_detector;
+static rain_result_t rain_result;
+static bool rain_valid = false;
+static uint32_t rain_frames = 0;
+static uint64_t rain_total_us = 0;
+static uint64_t snapshot_skew_total_ms = 0;
+
+static visibility_result_t visibility_result;
+static bool visibility_valid = false;
+static uint32_t visibility_frames = 0;
+static uint64_t visibility_total_us = 0;
+
+// Vibration gate: sums for kept (0) and rejected (1) frames
+static uint64_t gate_sharpness_sum[2] = {0};
+static uint32_t gate_sharpness_n[2] = {0};
+static uint64_t gate_bytes_sum[2] = {0};
+static uint32_t gate_kept = 0;
+
+// Perceptual dedup against the last kept frame
+static uint64_t frame_hash = 0;
+static bool frame_hash_valid = false; // Any 64-bit value, 0 included, is a valid hash
+static uint64_t kept_hash = 0;
+static bool kept_hash_valid = false;
+static uint32_t hash_frames = 0;
+static uint64_t hash_total_us = 0;
+
+// ============================================================================
+// Ring Helpers (call with ring_mutex held)
+// ============================================================================
+
+static uint8_t ring_depth(void)
+{
+    uint8_t depth = 0;
+    for (int i = 0; i < CAM_PIPELINE_RING_SLOTS; i++)
+    {
+        if (ring[i].state == SLOT_READY)
+        {
+            depth++;
+        }
+    }
+    return depth;
+}
+
+static frame_slot_t *ring_oldest_ready(void)
+{
+    frame_slot_t *oldest = NULL;
+    for (int i = 0; i < CAM_PIPELINE_RING_SLOTS; i++)
+    {
+        if (ring[i].state == SLOT_READY &&
+            (!oldest || (int32_t)(ring[i].seq - oldest->seq) < 0))
+        {
+            oldest = &ring[i];
+        }
+    }
+    return oldest;
+}
+
+// Free slot for a new frame, overwriting the oldest queued frame if needed
+static frame_slot_t *ring_claim(void)
+{
+    for (int i = 0; i < CAM_PIPELINE_RING_SLOTS; i++)
+    {
+        if (ring[i].state == SLOT_FREE)
+        {
+            return &ring[i];
+        }
+    }
+
+    frame_slot_t *victim = ring_oldest_ready();
+    if (victim)
+    {
+        stats.dropped++;
+        victim->state = SLOT_FREE;
+    }
+    return victim;
+}
+
+// Count an event seen outside the ring_mutex sections; every stats update
+// goes through ring_mutex, which cam_pipeline_get_stats() copies under
+static void stats_count(uint32_t *counter)
+{
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    (*counter)++;
+    xSemaphoreGive(ring_mutex);
+}
+
+// ============================================================================
+// Capture Task
+// ============================================================================
+
+// Returns true when this frame turned the estimate from dry to raining
+static bool analyse_rain(const camera_fb_t *fb)
+{
+    int64_t start_us = esp_timer_get_time();
+
+    const uint8_t *gray;
+    uint16_t width, height;
+    if (cam_config_analysis_decode(fb) != ESP_OK ||
+        cam_config_analysis_get(&gray, &width, &height) != ESP_OK)
+    {
+        return false;
+    }
+
+    rain_result_t result;
+    if (!image_analysis_rain_update(&rain_detector, gray, width, height, &result))
+    {
+        return false;
+    }
+
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    bool onset = result.raining && !(rain_valid && rain_result.raining);
+    rain_result = result;
+    rain_valid = true;
+    rain_frames++;
+    rain_total_us += elapsed_us;
+    stats.rain_last_us = elapsed_us;
+    xSemaphoreGive(ring_mutex);
+
+    ESP_LOGD(TAG, "Rain score %u (streaks %u, droplets %u, contrast loss %u%%) in %lu us",
+             result.score, result.streak_permille, result.droplet_permille,
+             result.contrast_loss_percent, elapsed_us);
+    return onset;
+}
+
+// Visibility on the same 1/8 analysis frame (decoded once, shared with rain)
+static void analyse_visibility(const camera_fb_t *fb)
+{
+    int64_t start_us = esp_timer_get_time();
+
+    const uint8_t *gray;
+    uint16_t width, height;
+    if (cam_config_analysis_decode(fb) != ESP_OK ||
+        cam_config_analysis_get(&gray, &width, &height) != ESP_OK)
+    {
+        return;
+    }
+
+    visibility_result_t result;
+    if (!image_analysis_visibility(gray, width, height, &result))
+    {
+        return;
+    }
+
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    visibility_result = result;
+    visibility_valid = true;
+    visibility_frames++;
+    visibility_total_us += elapsed_us;
+    stats.visibility_last_us = elapsed_us;
+    if (elapsed_us > stats.visibility_max_us)
+    {
+        stats.visibility_max_us = elapsed_us;
+    }
+    xSemaphoreGive(ring_mutex);
+
+    ESP_LOGD(TAG, "Visibility %u (contrast %u, edges %u, dark %u/%u) in %lu us", result.index,
+             result.contrast_permille, result.edge_permille, result.dark_channel, result.airlight,
+             elapsed_us);
+}
+
+// Hash the frame; true if it is a near-duplicate of the last kept frame
+static bool frame_is_duplicate(const camera_fb_t *fb)
+{
+    int64_t start_us = esp_timer_get_time();
+
+    const uint8_t *gray;
+    uint16_t width, height;
+    if (cam_config_analysis_decode(fb) != ESP_OK ||
+        cam_config_analysis_get(&gray, &width, &height) != ESP_OK)
+    {
+        frame_hash_valid = false;
+        return false;
+    }
+    frame_hash = image_analysis_dhash(gray, width, height);
+    frame_hash_valid = true;
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    uint8_t distance = kept_hash_valid ? image_analysis_hash_distance(frame_hash, kept_hash) : 0;
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    hash_frames++;
+    hash_total_us += elapsed_us;
+    if (kept_hash_valid)
+    {
+        stats.dedup_last_distance = distance;
+    }
+    xSemaphoreGive(ring_mutex);
+
+    return kept_hash_valid && distance <= pipeline_config.dedup_distance;
+}
+
+// Record the sharpness proxies of a gated frame (kept = 0, rejected = 1)
+static void gate_record(const camera_fb_t *fb, int rejected)
+{
+    uint32_t sharpness = 0;
+    const uint8_t *gray;
+    uint16_t width, height;
+    bool have_sharpness = cam_config_analysis_decode(fb) == ESP_OK &&
+                          cam_config_analysis_get(&gray, &width, &height) == ESP_OK;
+    if (have_sharpness)
+    {
+        sharpness = image_analysis_sharpness(gray, width, height);
+    }
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    gate_bytes_sum[rejected] += fb->len;
+    if (rejected)
+    {
+        stats.vib_rejected++;
+    }
+    else
+    {
+        gate_kept++;
+    }
+    if (have_sharpness)
+    {
+        gate_sharpness_sum[rejected] += sharpness;
+        gate_sharpness_n[rejected]++;
+    }
+    xSemaphoreGive(ring_mutex);
+}
+
+// Check the IMU over the frame's exposure; true if the frame should be kept
+static bool frame_is_steady(const camera_fb_t *fb)
+{
+    const cam_vibration_config_t *cfg = &pipeline_config.vibration;
+
+    // The driver stamps frames with the esp_timer clock the IMU samples use
+    int64_t frame_us = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+    mpu6050_vibration_t vib;
+    stats_count(&stats.vib_checked);
+    if (sensor_mpu6050_vibration_window(frame_us - (int64_t)cfg->exposure_window_ms * 1000,
+                                        frame_us, &vib) != ESP_OK)
+    {
+        return true; // No IMU data: do not block capture
+    }
+
+    bool steady = vib.gyro_peak_dps <= cfg->gyro_threshold_dps &&
+                  vib.accel_peak_g <= cfg->accel_threshold_g;
+    if (!steady)
+    {
+        ESP_LOGD(TAG, "Frame rejected: gyro %.1f dps, accel %.2f g", vib.gyro_peak_dps, vib.accel_peak_g);
+    }
+    gate_record(fb, steady ? 0 : 1);
+    return steady;
+}
+
+// Free the ring slots and semaphores after a failed start
+static void ring_release(void)
+{
+    for (int i = 0; i < CAM_PIPELINE_RING_SLOTS; i++)
+    {
+        heap_caps_free(ring[i].buf);
+        ring[i].buf = NULL;
+        ring[i].record = NULL;
+    }
+    if (ring_mutex)
+    {
+        vSemaphoreDelete(ring_mutex);
+        ring_mutex = NULL;
+    }
+    if (frame_ready)
+    {
+        vSemaphoreDelete(frame_ready);
+        frame_ready = NULL;
+    }
+    if (snapshot_mutex)
+    {
+        vSemaphoreDelete(snapshot_mutex);
+        snapshot_mutex = NULL;
+    }
+}
+
+// Capture a frame, recapturing while the vibration gate rejects it
+static camera_fb_t *capture_steady(cam_product_t product, bool *deferred)
+{
+    *deferred = false;
+    for (int attempt = 0;; attempt++)
+    {
+        camera_fb_t *fb = cam_config_capture_product(product);
+        if (!fb || !pipeline_config.vibration_gate || frame_is_steady(fb))
+        {
+            return fb;
+        }
+
+        cam_config_return_fb(fb);
+        if (attempt >= pipeline_config.vibration.max_retries)
+        {
+            stats_count(&stats.vib_deferred);
+            *deferred = true;
+            return NULL;
+        }
+        vTaskDelay(pdMS_TO_TICKS(pipeline_config.vibration.retry_delay_ms));
+    }
+}
+
+// Wall-clock time in ms, 0 while the clock is not set
+static int64_t utc_now_ms(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (now.tv_sec < CLOCK_VALID_AFTER_S)
+    {
+        return 0;
+    }
+    return (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+// Copy a frame into the ring; true if it was queued
+static bool ring_push(const camera_fb_t *fb, int64_t capture_us, cam_product_t product,
+                      const burst_tag_t *burst)
+{
+    if (fb->len > CAM_PIPELINE_SLOT_SIZE)
+    {
+        ESP_LOGW(TAG, "Frame too large for ring slot (%zu bytes)", fb->len);
+        stats_count(&stats.oversize);
+        return false;
+    }
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    frame_slot_t *slot = ring_claim();
+    if (slot)
+    {
+        memcpy(slot->buf, fb->buf, fb->len);
+        slot->len = fb->len;
+        slot->seq = next_seq++;
+        slot->capture_us = capture_us;
+        slot->capture_utc_ms = utc_now_ms();
+        if (slot->capture_utc_ms)
+        {
+            slot->capture_utc_ms -= (esp_timer_get_time() - capture_us) / 1000;
+        }
+        slot->attempts = 0;
+        slot->product = product;
+        if (burst)
+        {
+            slot->burst = *burst;
+        }
+        else
+        {
+            slot->burst.event_id = 0;
+        }
+        slot->record_len = 0;
+        if (pipeline_config.snapshot)
+        {
+            // Sensor values as of capture, stored next to the frame they describe
+            uint32_t skew_ms = 0;
+            int n = pipeline_config.snapshot(slot->record, CAM_PIPELINE_SNAPSHOT_SIZE, capture_us, &skew_ms,
+                                             pipeline_config.snapshot_ctx);
+            if (n > 0 && n < CAM_PIPELINE_SNAPSHOT_SIZE)
+            {
+                slot->record_len = n;
+                stats.snapshots++;
+                stats.snapshot_skew_last_ms = skew_ms;
+                snapshot_skew_total_ms += skew_ms;
+                if (skew_ms > stats.snapshot_skew_max_ms)
+                {
+                    stats.snapshot_skew_max_ms = skew_ms;
+                }
+            }
+        }
+        else if (pipeline_config.manifest_context)
+        {
+            // Context as of capture, for the manifest of a later spool batch
+            int n = pipeline_config.manifest_context(slot->record, CAM_PIPELINE_SNAPSHOT_SIZE,
+                                                     pipeline_config.manifest_ctx);
+            slot->record_len = n > 0 && n < CAM_PIPELINE_SNAPSHOT_SIZE ? n : 0;
+        }
+        slot->state = SLOT_READY;
+        stats.captured++;
+
+        uint8_t depth = ring_depth();
+        if (depth > stats.queue_peak)
+        {
+            stats.queue_peak = depth;
+        }
+    }
+    xSemaphoreGive(ring_mutex);
+
+    if (slot)
+    {
+        xSemaphoreGive(frame_ready);
+    }
+    return slot != NULL;
+}
+
+// Something happened in the ROI: follow up with one full frame
+static void capture_event_frame(void)
+{
+    bool deferred;
+    camera_fb_t *fb = capture_steady(CAM_PRODUCT_FULL, &deferred);
+    if (!fb)
+    {
+        return;
+    }
+
+    if (ring_push(fb, esp_timer_get_time(), CAM_PRODUCT_FULL, NULL))
+    {
+        stats_count(&stats.event_frames);
+    }
+    cam_config_return_fb(fb);
+}
+
+// Grab burst_frames frames back to back; no gating, the event is the point
+static void run_burst(void)
+{
+    burst_tag_t tag = {
+        .event_id = ++burst_event_id,
+    };
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    tag.event_us = burst_trigger_us;
+    burst_pending = false;
+    xSemaphoreGive(ring_mutex);
+
+    int64_t first_us = 0;
+    int64_t last_us = 0;
+    uint8_t grabbed = 0;
+    uint8_t queued = 0;
+
+    for (uint8_t i = 0; i < pipeline_config.burst_frames; i++)
+    {
+        camera_fb_t *fb = cam_config_capture_product(CAM_PRODUCT_FULL);
+        if (!fb)
+        {
+            break;
+        }
+
+        last_us = esp_timer_get_time();
+        if (grabbed == 0)
+        {
+            first_us = last_us;
+        }
+        grabbed++;
+
+        int64_t frame_us = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+        tag.offset_ms = (int32_t)((frame_us - tag.event_us) / 1000);
+        tag.index = i;
+        if (ring_push(fb, last_us, CAM_PRODUCT_FULL, &tag))
+        {
+            queued++;
+        }
+        cam_config_return_fb(fb);
+    }
+
+    if (grabbed == 0)
+    {
+        ESP_LOGW(TAG, "Burst %lu captured no frames", tag.event_id);
+        return;
+    }
+
+    uint32_t first_ms = (uint32_t)((first_us - tag.event_us) / 1000);
+    float fps = grabbed > 1 ? (grabbed - 1) * 1000000.0f / (last_us - first_us) : 0.0f;
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    stats.bursts++;
+    stats.burst_frames += queued;
+    stats.burst_fps = fps;
+    stats.burst_first_ms = first_ms;
+    if (first_ms > stats.burst_first_max_ms)
+    {
+        stats.burst_first_max_ms = first_ms;
+    }
+    xSemaphoreGive(ring_mutex);
+
+    ESP_LOGI(TAG, "Burst %lu: %u frames queued, %.1f fps, first frame %lu ms after trigger",
+             tag.event_id, queued, fps, first_ms);
+}
+
+// Sleep until the next capture period, serving burst requests meanwhile
+static void capture_wait(TickType_t *last_wake, uint32_t period_ms)
+{
+    TickType_t next = *last_wake + pdMS_TO_TICKS(period_ms);
+    while (1)
+    {
+        if (burst_pending)
+        {
+            run_burst();
+        }
+
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(next - now) <= 0)
+        {
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, next - now);
+    }
+    *last_wake = next;
+}
+
+static bool keyframe_due(int64_t last_kept_us, int64_t now_us)
+{
+    return pipeline_config.keyframe_interval_ms > 0 &&
+           now_us - last_kept_us >= (int64_t)pipeline_config.keyframe_interval_ms * 1000;
+}
+
+static void capture_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "Capture task started (interval: %lu ms)", pipeline_config.capture_interval_ms);
+
+    TickType_t last_wake = xTaskGetTickCount();
+    int64_t last_capture_us = 0;
+    int64_t last_kept_us = 0;
+
+    while (1)
+    {
+        cam_product_t product = pipeline_config.roi_enabled ? CAM_PRODUCT_ROI : CAM_PRODUCT_FULL;
+        bool deferred;
+        camera_fb_t *fb = capture_steady(product, &deferred);
+        int64_t now_us = esp_timer_get_time();
+
+        bool rain_onset = false;
+        if (fb && pipeline_config.rain_analysis)
+        {
+            rain_onset = analyse_rain(fb);
+        }
+        if (fb && pipeline_config.visibility_analysis)
+        {
+            analyse_visibility(fb);
+        }
+
+        // Viewers get every frame, independent of the trigger and the ring
+        bool live = pipeline_config.live_view_interval_ms > 0 && live_view_has_clients();
+        if (fb && live)
+        {
+            live_view_publish(fb->buf, fb->len);
+        }
+
+        if (!fb)
+        {
+            if (!deferred)
+            {
+                stats_count(&stats.capture_failed);
+            }
+        }
+        else
+        {
+            // Rain onset is always kept, whatever the trigger and dedup say
+            bool keep = true;
+            bool event = rain_onset;
+            frame_hash_valid = false;
+
+            if (pipeline_config.change_trigger && !rain_onset)
+            {
+                bool changed = cam_config_trigger_evaluate(fb);
+                event = event || changed;
+                if (!changed && !keyframe_due(last_kept_us, now_us))
+                {
+                    // Nothing changed and no keyframe due: skip without copying
+                    stats_count(&stats.skipped);
+                    keep = false;
+                }
+            }
+
+            if (keep && pipeline_config.dedup && !rain_onset &&
+                frame_is_duplicate(fb) &&
+                !keyframe_due(last_kept_us, now_us))
+            {
+                // Same scene as the last kept frame (e.g. standing in a depot)
+                xSemaphoreTake(ring_mutex, portMAX_DELAY);
+                stats.dedup_skipped++;
+                stats.dedup_bytes_saved += fb->len;
+                xSemaphoreGive(ring_mutex);
+                keep = false;
+                event = false;
+            }
+
+            if (rain_onset && pipeline_config.dedup)
+            {
+                frame_is_duplicate(fb); // Not filtered, but still the reference for the next frame
+            }
+
+            if (keep && ring_push(fb, now_us, product, NULL))
+            {
+                last_kept_us = now_us;
+                if (pipeline_config.dedup)
+                {
+                    kept_hash = frame_hash;
+                    kept_hash_valid = frame_hash_valid;
+                }
+            }
+
+            // Frame buffer goes back to the driver as soon as it is copied
+            cam_config_return_fb(fb);
+
+            if (rain_onset || (keep && event && product == CAM_PRODUCT_ROI))
+            {
+                capture_event_frame();
+            }
+        }
+
+        if (last_capture_us != 0)
+        {
+            uint32_t interval_ms = (uint32_t)((now_us - last_capture_us) / 1000);
+            xSemaphoreTake(ring_mutex, portMAX_DELAY);
+            if (interval_ms > stats.interval_max_ms)
+            {
+                stats.interval_max_ms = interval_ms;
+            }
+            xSemaphoreGive(ring_mutex);
+        }
+        last_capture_us = now_us;
+
+        if (rain_onset && pipeline_config.burst_on_rain)
+        {
+            cam_pipeline_burst_request();
+        }
+
+        uint32_t period_ms = live ? pipeline_config.live_view_interval_ms : pipeline_config.capture_interval_ms;
+        capture_wait(&last_wake, period_ms);
+    }
+}
+
+// ============================================================================
+// Upload Worker
+// ============================================================================
+
+static esp_err_t upload_frame(const uint8_t *buf, size_t len, cam_product_t product, const burst_tag_t *burst)
+{
+    bool roi = product == CAM_PRODUCT_ROI;
+    if (pipeline_config.transport == CAM_TRANSPORT_MQTT)
+    {
+        const char *topic = (roi && pipeline_config.roi_mqtt_topic) ? pipeline_config.roi_mqtt_topic
+                                                                   : pipeline_config.mqtt_topic;
+        char meta[96];
+        if (burst->event_id)
+        {
+            snprintf(meta, sizeof(meta), "\"event\":%lu,\"frame\":%u,\"eventMs\":%lld,\"offsetMs\":%ld",
+                     burst->event_id, burst->index, burst->event_us / 1000, burst->offset_ms);
+        }
+        return app_network_mqtt_publish_image(topic, buf, len, burst->event_id ? meta : NULL);
+    }
+
+    const char *url = (roi && pipeline_config.roi_upload_url) ? pipeline_config.roi_upload_url
+                                                             : pipeline_config.upload_url;
+    char event_url[192];
+    if (burst->event_id)
+    {
+        snprintf(event_url, sizeof(event_url), "%s%cevent=%lu&frame=%u&eventMs=%lld&offsetMs=%ld",
+                 url, strchr(url, '?') ? '&' : '?', burst->event_id, burst->index,
+                 burst->event_us / 1000, burst->offset_ms);
+        url = event_url;
+    }
+    if (pipeline_config.resumable_upload)
+    {
+        return app_network_upload_image_resumable(url, buf, len);
+    }
+    return app_network_upload_image_stream(url, buf, len, NULL, NULL);
+}
+
+// A frame and its sensor record as one unit (call with snapshot_mutex held)
+static esp_err_t upload_snapshot_locked(const frame_slot_t *slot)
+{
+    char *record = snapshot_record;
+    bool mqtt = pipeline_config.transport == CAM_TRANSPORT_MQTT;
+    bool roi = slot->product == CAM_PRODUCT_ROI;
+    const burst_tag_t *burst = &slot->burst;
+
+    size_t size = sizeof(snapshot_record);
+    int n = snprintf(record, size, "%s\"snapshot\":%lu,\"captureMs\":%lld,", mqtt ? "" : "{",
+                     slot->seq, slot->capture_us / 1000);
+    if (slot->capture_utc_ms && n < (int)size)
+    {
+        n += snprintf(record + n, size - n, "\"captureUtcMs\":%lld,", slot->capture_utc_ms);
+    }
+    if (n < (int)size)
+    {
+        n += snprintf(record + n, size - n, "%.*s", slot->record_len, slot->record);
+    }
+    if (burst->event_id && n < (int)size)
+    {
+        n += snprintf(record + n, size - n, ",\"event\":%lu,\"frame\":%u,\"eventMs\":%lld,\"offsetMs\":%ld",
+                      burst->event_id, burst->index, burst->event_us / 1000, burst->offset_ms);
+    }
+
+    if (mqtt)
+    {
+        if (n >= (int)size)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        const char *topic = (roi && pipeline_config.roi_mqtt_topic) ? pipeline_config.roi_mqtt_topic
+                                                                   : pipeline_config.mqtt_topic;
+        return app_network_mqtt_publish_image(topic, slot->buf, slot->len, record);
+    }
+
+    if (n < (int)size)
+    {
+        n += snprintf(record + n, size - n,
+                      ",\"count\":1,\"images\":[{\"part\":\"image0\",\"seq\":%lu,\"product\":\"%s\","
+                      "\"captureMs\":%lld,\"len\":%u}]}",
+                      slot->seq, roi ? "roi" : "full", slot->capture_us / 1000, (unsigned int)slot->len);
+    }
+    if (n >= (int)size)
+    {
+        ESP_LOGE(TAG, "Snapshot record does not fit in %d bytes", BATCH_MANIFEST_SIZE);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const char *url = pipeline_config.snapshot_url       ? pipeline_config.snapshot_url
+                      : pipeline_config.batch_upload_url ? pipeline_config.batch_upload_url
+                                                         : pipeline_config.upload_url;
+    return app_network_upload_image_record(url, record, slot->buf, slot->len);
+}
+
+static esp_err_t upload_snapshot(const frame_slot_t *slot)
+{
+    xSemaphoreTake(snapshot_mutex, portMAX_DELAY);
+    esp_err_t err = upload_snapshot_locked(slot);
+    xSemaphoreGive(snapshot_mutex);
+    return err;
+}
+
+// Move a SENDING slot to the flash spool and free it
+static void spool_slot(frame_slot_t *slot)
+{
+    spool_meta_t meta = {
+        .product = slot->product,
+        .index = slot->burst.index,
+        .event_id = slot->burst.event_id,
+        .offset_ms = slot->burst.offset_ms,
+        .event_ms = (uint32_t)(slot->burst.event_us / 1000),
+        .capture_ms = (uint32_t)(slot->capture_us / 1000),
+        .capture_utc_ms = slot->capture_utc_ms,
+        .seq = slot->seq,
+    };
+    uint8_t raw[IMAGE_SPOOL_META_SIZE] = {0};
+    memcpy(raw, &meta, sizeof(meta));
+    esp_err_t err = image_spool_write(slot->buf, slot->len, raw, slot->record, slot->record_len);
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    if (err == ESP_OK)
+    {
+        stats.spooled++;
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Frame %lu lost: spool write failed", slot->seq);
+        stats.upload_failed++;
+    }
+    slot->state = SLOT_FREE;
+    xSemaphoreGive(ring_mutex);
+}
+
+// The spool partition is shared with time-lapse mode, whose records carry
+// their own meta; those go out as plain full frames. Returns false for them.
+static bool spool_meta_load(const image_spool_meta_t *spool, spool_meta_t *meta)
+{
+    if (spool->meta[0] == IMAGE_SPOOL_KIND_TIMELAPSE)
+    {
+        memset(meta, 0, sizeof(*meta));
+        meta->product = CAM_PRODUCT_FULL;
+        meta->seq = spool->seq;
+        return false;
+    }
+    memcpy(meta, spool->meta, sizeof(*meta));
+    return true;
+}
+
+static esp_err_t spool_send(const uint8_t *data, size_t len, const image_spool_meta_t *spool, void *ctx)
+{
+    spool_meta_t meta;
+    bool own = spool_meta_load(spool, &meta);
+    burst_tag_t burst = {
+        .event_id = meta.event_id,
+        .event_us = (int64_t)meta.event_ms * 1000,
+        .offset_ms = meta.offset_ms,
+        .index = meta.index,
+    };
+
+    esp_err_t err;
+    if (own && pipeline_config.snapshot && spool->context_len > 0)
+    {
+        // Same request as from the ring; captureMs may be from an earlier boot
+        const frame_slot_t slot = {
+            .buf = (uint8_t *)data,
+            .len = len,
+            .record = (char *)spool->context,
+            .record_len = spool->context_len,
+            .seq = meta.seq,
+            .capture_us = (int64_t)meta.capture_ms * 1000,
+            .capture_utc_ms = meta.capture_utc_ms,
+            .product = (cam_product_t)meta.product,
+            .burst = burst,
+        };
+        err = upload_snapshot(&slot);
+    }
+    else
+    {
+        err = upload_frame(data, len, (cam_product_t)meta.product, &burst);
+    }
+    if (err == ESP_OK)
+    {
+        xSemaphoreTake(ring_mutex, portMAX_DELAY);
+        stats.spool_uploaded++;
+        xSemaphoreGive(ring_mutex);
+    }
+    return err;
+}
+
+static esp_err_t spool_batch_read(uint8_t index, size_t offset, uint8_t *buf, size_t len, void *ctx)
+{
+    const image_spool_meta_t *spool = (const image_spool_meta_t *)ctx;
+    return image_spool_read(spool[index].seq, offset, buf, len);
+}
+
+// Several spooled frames in one multipart request, described by a manifest
+static esp_err_t spool_send_batch(const image_spool_meta_t *spool, const size_t *len, uint8_t count, void *ctx)
+{
+    static char manifest[BATCH_MANIFEST_SIZE]; // Only the spool drain task gets here
+    app_network_batch_t batch = {
+        .manifest = manifest,
+        .count = count,
+        .read = spool_batch_read,
+        .ctx = (void *)spool,
+    };
+
+    // Context and times are per image, as captured; only uptimeMs is the time of sending
+    size_t size = sizeof(manifest);
+    int n = snprintf(manifest, size, "{\"uptimeMs\":%lld,\"count\":%u,\"images\":[",
+                     esp_timer_get_time() / 1000, count);
+
+    for (uint8_t i = 0; i < count && n < (int)size; i++)
+    {
+        spool_meta_t meta;
+        bool own = spool_meta_load(&spool[i], &meta);
+        batch.len[i] = len[i];
+        n += snprintf(manifest + n, size - n,
+                      "%s{\"part\":\"image%u\",\"seq\":%lu,\"product\":\"%s\",\"captureMs\":%lu,\"len\":%u",
+                      i ? "," : "", i, spool[i].seq, meta.product == CAM_PRODUCT_ROI ? "roi" : "full",
+                      meta.capture_ms, (unsigned int)len[i]);
+        if (meta.capture_utc_ms && n < (int)size)
+        {
+            n += snprintf(manifest + n, size - n, ",\"captureUtcMs\":%lld", meta.capture_utc_ms);
+        }
+        if (meta.event_id && n < (int)size)
+        {
+            n += snprintf(manifest + n, size - n, ",\"event\":%lu,\"frame\":%u,\"eventMs\":%lu,\"offsetMs\":%ld",
+                          meta.event_id, meta.index, meta.event_ms, meta.offset_ms);
+        }
+        if (!own && n < (int)size)
+        {
+            n += snprintf(manifest + n, size - n, ",\"timelapse\":true");
+        }
+        if (own && spool[i].context_len && n < (int)size)
+        {
+            n += snprintf(manifest + n, size - n, ",\"context\":{%.*s}", spool[i].context_len,
+                          (const char *)spool[i].context);
+        }
+        if (n < (int)size)
+        {
+            n += snprintf(manifest + n, size - n, "}");
+        }
+    }
+    if (n < (int)size)
+    {
+        n += snprintf(manifest + n, size - n, "]}");
+    }
+    if (n >= (int)size)
+    {
+        ESP_LOGE(TAG, "Batch manifest does not fit in %d bytes", BATCH_MANIFEST_SIZE);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const char *url = pipeline_config.batch_upload_url ? pipeline_config.batch_upload_url
+                                                       : pipeline_config.upload_url;
+    esp_err_t err = app_network_upload_batch(url, &batch);
+    if (err == ESP_OK)
+    {
+        xSemaphoreTake(ring_mutex, portMAX_DELAY);
+        stats.spool_uploaded += count;
+        xSemaphoreGive(ring_mutex);
+    }
+    return err;
+}
+
+// Spooled frames are older than anything in the ring, which goes first
+static bool spool_ready(void *ctx)
+{
+    if (app_network_get_status() != NETWORK_CONNECTED)
+    {
+        return false;
+    }
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    bool idle = ring_depth() == 0;
+    xSemaphoreGive(ring_mutex);
+    return idle;
+}
+
+static void upload_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "Upload worker started (%s: %s)",
+             pipeline_config.transport == CAM_TRANSPORT_MQTT ? "mqtt" : "http",
+             pipeline_config.transport == CAM_TRANSPORT_MQTT ? pipeline_config.mqtt_topic : pipeline_config.upload_url);
+
+    bool was_connected = false;
+
+    while (1)
+    {
+        xSemaphoreTake(frame_ready, pdMS_TO_TICKS(UPLOAD_RETRY_DELAY_MS));
+
+        bool connected = app_network_get_status() == NETWORK_CONNECTED;
+        if (connected && !was_connected && pipeline_config.spool)
+        {
+            image_spool_kick();
+        }
+        was_connected = connected;
+
+        if (!connected && !pipeline_config.spool)
+        {
+            continue;
+        }
+
+        xSemaphoreTake(ring_mutex, portMAX_DELAY);
+        frame_slot_t *slot = ring_oldest_ready();
+        if (slot)
+        {
+            slot->state = SLOT_SENDING;
+            slot->attempts += connected;
+        }
+        xSemaphoreGive(ring_mutex);
+
+        if (!slot)
+        {
+            if (connected && pipeline_config.spool)
+            {
+                image_spool_kick(); // Ring empty: spooled frames may go now
+            }
+            continue;
+        }
+
+        // Offline: move queued frames to flash so the ring keeps its headroom
+        // and nothing is lost to a reset or a long outage
+        if (!connected)
+        {
+            spool_slot(slot);
+            xSemaphoreGive(frame_ready);
+            continue;
+        }
+
+        int64_t upload_start_us = esp_timer_get_time();
+        esp_err_t err = (pipeline_config.snapshot && slot->record_len > 0)
+                            ? upload_snapshot(slot)
+                            : upload_frame(slot->buf, slot->len, slot->product, &slot->burst);
+        // Adaptive sizing is calibrated on full frames only
+        if (err == ESP_OK && slot->product != CAM_PRODUCT_ROI && pipeline_config.adaptive_quality)
+        {
+            cam_config_adaptive_report(slot->len, (uint32_t)((esp_timer_get_time() - upload_start_us) / 1000));
+        }
+
+        bool give_up = false;
+        xSemaphoreTake(ring_mutex, portMAX_DELAY);
+        if (err == ESP_OK)
+        {
+            uint32_t latency_ms = (uint32_t)((esp_timer_get_time() - slot->capture_us) / 1000);
+            stats.uploaded++;
+            stats.latency_last_ms = latency_ms;
+            latency_total_ms += latency_ms;
+            if (latency_ms > stats.latency_max_ms)
+            {
+                stats.latency_max_ms = latency_ms;
+            }
+            slot->state = SLOT_FREE;
+        }
+        else if (slot->attempts < UPLOAD_MAX_ATTEMPTS)
+        {
+            slot->state = SLOT_READY;
+        }
+        else if (pipeline_config.spool)
+        {
+            give_up = true; // Slot stays SENDING until it is in flash
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Frame %lu dropped after %d upload attempts", slot->seq, slot->attempts);
+            stats.upload_failed++;
+            slot->state = SLOT_FREE;
+        }
+        xSemaphoreGive(ring_mutex);
+
+        // Retries exhausted: keep the frame in flash instead of dropping it
+        if (give_up)
+        {
+            spool_slot(slot);
+        }
+
+        if (err != ESP_OK)
+        {
+            vTaskDelay(pdMS_TO_TICKS(UPLOAD_RETRY_DELAY_MS));
+        }
+        else
+        {
+            // More frames may be queued behind this one
+            xSemaphoreGive(frame_ready);
+        }
+    }
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t cam_pipeline_start(const cam_pipeline_config_t *config)
+{
+    if (config && config->snapshot && config->resumable_upload && config->transport == CAM_TRANSPORT_HTTP)
+    {
+        // A frame and its record are one multipart request, which cannot be resumed
+        ESP_LOGE(TAG, "Snapshot records and resumable upload cannot be combined");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!config || config->capture_interval_ms == 0 ||
+        config->burst_frames > CAM_PIPELINE_BURST_MAX ||
+        config->spool_batch > IMAGE_SPOOL_BATCH_MAX ||
+        (config->transport == CAM_TRANSPORT_HTTP && !config->upload_url) ||
+        (config->transport == CAM_TRANSPORT_MQTT && !config->mqtt_topic))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pipeline_config = *config;
+    if (pipeline_config.burst_frames && !cam_config_burst_mode())
+    {
+        ESP_LOGW(TAG, "Bursts requested but the camera is not in burst mode; frames come at the queue's pace");
+    }
+
+    if (config->rain_analysis)
+    {
+        image_analysis_rain_init(&rain_detector, NULL);
+    }
+
+    if (config->adaptive_quality)
+    {
+        esp_err_t err = cam_config_adaptive_enable(&config->adaptive);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+
+    if (config->roi_enabled)
+    {
+        esp_err_t err = cam_config_set_roi(&config->roi);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+
+    if (config->change_trigger)
+    {
+        esp_err_t err = cam_config_trigger_enable(&config->trigger);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+
+    for (int i = 0; i < CAM_PIPELINE_RING_SLOTS; i++)
+    {
+        size_t record_size = (config->snapshot || config->manifest_context) ? CAM_PIPELINE_SNAPSHOT_SIZE : 0;
+        ring[i].buf = heap_caps_malloc(CAM_PIPELINE_SLOT_SIZE + record_size, MALLOC_CAP_SPIRAM);
+        if (!ring[i].buf)
+        {
+            ESP_LOGE(TAG, "Failed to allocate ring slot %d in PSRAM", i);
+            ring_release();
+            return ESP_ERR_NO_MEM;
+        }
+        ring[i].record = record_size ? (char *)ring[i].buf + CAM_PIPELINE_SLOT_SIZE : NULL;
+        ring[i].state = SLOT_FREE;
+    }
+
+    ring_mutex = xSemaphoreCreateMutex();
+    frame_ready = xSemaphoreCreateBinary();
+    snapshot_mutex = xSemaphoreCreateMutex();
+    if (!ring_mutex || !frame_ready || !snapshot_mutex)
+    {
+        ESP_LOGE(TAG, "Failed to create pipeline semaphores");
+        ring_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (config->spool)
+    {
+        const image_spool_config_t spool_config = {
+            .max_image_size = CAM_PIPELINE_SLOT_SIZE,
+            .send = spool_send,
+            .ready = spool_ready,
+            // Batches are HTTP only; MQTT keeps sending one image at a time
+            .send_batch = config->transport == CAM_TRANSPORT_HTTP ? spool_send_batch : NULL,
+            .batch_max = config->spool_batch,
+            .ctx = NULL,
+            .drain_core = config->upload_core,
+        };
+        esp_err_t err = image_spool_start(&spool_config);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Image spool unavailable (%s), frames will be dropped while offline",
+                     esp_err_to_name(err));
+            pipeline_config.spool = false;
+        }
+    }
+
+    xTaskCreatePinnedToCore(capture_task, "cam_capture", 4096, NULL, 6, &capture_handle, config->capture_core);
+    xTaskCreatePinnedToCore(upload_task, "cam_upload", 6144, NULL, 4, NULL, config->upload_core);
+
+    running = true;
+    ESP_LOGI(TAG, "Pipeline started (%d x %d KB ring in PSRAM)",
+             CAM_PIPELINE_RING_SLOTS, CAM_PIPELINE_SLOT_SIZE / 1024);
+    return ESP_OK;
+}
+
+esp_err_t cam_pipeline_burst_request(void)
+{
+    if (!running || pipeline_config.burst_frames == 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    if (!burst_pending)
+    {
+        burst_trigger_us = esp_timer_get_time();
+        burst_pending = true;
+    }
+    xSemaphoreGive(ring_mutex);
+    xTaskNotifyGive(capture_handle);
+    return ESP_OK;
+}
+
+esp_err_t cam_pipeline_get_stats(cam_pipeline_stats_t *out)
+{
+    if (!out)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Averages too: their sums are updated under ring_mutex along with stats
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    *out = stats;
+    out->queue_depth = ring_depth();
+
+    if (out->uploaded > 0)
+    {
+        out->latency_avg_ms = (uint32_t)(latency_total_ms / out->uploaded);
+    }
+    if (rain_frames > 0)
+    {
+        out->rain_avg_us = (uint32_t)(rain_total_us / rain_frames);
+    }
+    if (out->snapshots > 0)
+    {
+        out->snapshot_skew_avg_ms = (uint32_t)(snapshot_skew_total_ms / out->snapshots);
+    }
+    if (visibility_frames > 0)
+    {
+        out->visibility_avg_us = (uint32_t)(visibility_total_us / visibility_frames);
+    }
+    if (hash_frames > 0)
+    {
+        out->hash_avg_us = (uint32_t)(hash_total_us / hash_frames);
+    }
+    if (gate_sharpness_n[0] > 0)
+    {
+        out->sharpness_kept = (uint32_t)(gate_sharpness_sum[0] / gate_sharpness_n[0]);
+    }
+    if (gate_sharpness_n[1] > 0)
+    {
+        out->sharpness_rejected = (uint32_t)(gate_sharpness_sum[1] / gate_sharpness_n[1]);
+    }
+    if (gate_kept > 0)
+    {
+        out->jpeg_kept_avg = (uint32_t)(gate_bytes_sum[0] / gate_kept);
+    }
+    if (out->vib_rejected > 0)
+    {
+        out->jpeg_rejected_avg = (uint32_t)(gate_bytes_sum[1] / out->vib_rejected);
+    }
+    xSemaphoreGive(ring_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t cam_pipeline_get_rain(rain_result_t *result)
+{
+    if (!result)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!running || !rain_valid)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    *result = rain_result;
+    xSemaphoreGive(ring_mutex);
+    return ESP_OK;
+}
+
+esp_err_t cam_pipeline_get_visibility(visibility_result_t *result)
+{
+    if (!result)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!running || !visibility_valid)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    *result = visibility_result;
+    xSemaphoreGive(ring_mutex);
+    return ESP_OK;
+}
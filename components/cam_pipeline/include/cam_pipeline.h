@@ -0,0 +1,207 @@
+/**
+ * @file cam_pipeline.h
+ * @brief Camera Capture Pipeline (capture task, PSRAM frame ring, upload worker)
+ */
+
+#ifndef CAM_PIPELINE_H
+#define CAM_PIPELINE_H
+
+#include "esp_err.h"
+#include "cam_config.h"
+#include "image_analysis.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Ring of JPEG copies in PSRAM (slots x slot size)
+#define CAM_PIPELINE_RING_SLOTS 12
+#define CAM_PIPELINE_SLOT_SIZE (96 * 1024)
+
+// Longest burst; leaves ring room for frames already queued
+#define CAM_PIPELINE_BURST_MAX 10
+
+/**
+ * @brief Image transport used by the upload worker
+ */
+typedef enum {
+    CAM_TRANSPORT_HTTP = 0,       // Streaming HTTP POST to upload_url
+    CAM_TRANSPORT_MQTT,           // Chunked MQTT publish under mqtt_topic
+} cam_pipeline_transport_t;
+
+/**
+ * @brief Vibration gate thresholds (MPU6050 over the exposure window)
+ */
+typedef struct {
+    float gyro_threshold_dps;     // Reject frames whose exposure saw a faster rotation
+    float accel_threshold_g;      // Reject frames whose exposure saw a larger |accel| deviation from 1 g
+    uint16_t exposure_window_ms;  // Window before the frame timestamp checked against the thresholds
+    uint8_t max_retries;          // Immediate recaptures before deferring to the next period
+    uint16_t retry_delay_ms;      // Pause between recaptures
+} cam_vibration_config_t;
+
+/**
+ * @brief Captures device context for a frame, listed with it in batch manifests
+ *
+ * Called from the capture task right after capture, with the ring locked,
+ * so it must not block. The text is kept with the frame, through the flash
+ * spool as well. Not used when snapshot records are on; they already hold
+ * the readings at capture time.
+ * Writes JSON object members (no braces), e.g. "gps":{...},"sensors":{...}.
+ * @return Characters written (snprintf semantics)
+ */
+typedef int (*cam_pipeline_context_cb_t)(char *buf, size_t size, void *ctx);
+
+#define CAM_PIPELINE_SNAPSHOT_SIZE 512 // Sensor part of a snapshot record
+
+/**
+ * @brief Fills the sensor part of a snapshot record
+ *
+ * Called from the capture task for every queued frame, right after capture
+ * and with the ring locked, so it must not block. Writes JSON object members
+ * (no braces) with the latest sensor readings and reports the largest
+ * distance between capture_us and the sample times of those readings.
+ *
+ * @return Characters written (snprintf semantics), negative if unavailable
+ */
+typedef int (*cam_pipeline_snapshot_cb_t)(char *buf, size_t size, int64_t capture_us,
+                                          uint32_t *skew_ms, void *ctx);
+
+/**
+ * @brief Pipeline configuration
+ */
+typedef struct {
+    cam_pipeline_transport_t transport;
+    const char *upload_url;       // HTTP endpoint for captured images
+    bool resumable_upload;        // HTTP: continue interrupted uploads (server must speak Content-Range;
+                                  // not with snapshot records)
+    const char *mqtt_topic;       // MQTT image topic prefix
+    uint32_t capture_interval_ms; // Capture period
+    int capture_core;             // Core for the capture task
+    int upload_core;              // Core for the upload worker
+    bool change_trigger;          // Keep only frames that pass the cam_config change trigger
+    cam_trigger_config_t trigger; // Change trigger thresholds
+    uint32_t keyframe_interval_ms; // Keep a frame at least this often in trigger mode (0 = never)
+    bool rain_analysis;           // Run rain detection on every captured frame
+    bool visibility_analysis;     // Estimate visibility / fog on every captured frame
+    bool adaptive_quality;        // Adapt frame size / JPEG quality to upload throughput
+    cam_adaptive_config_t adaptive; // Adaptive quality target
+    uint32_t live_view_interval_ms; // Capture period while live-view clients watch (0 = no live view)
+    bool vibration_gate;          // Reject frames exposed during high vibration (needs MPU6050 sampling)
+    cam_vibration_config_t vibration; // Vibration gate thresholds
+    bool dedup;                   // Skip frames perceptually identical to the last kept frame
+    uint8_t dedup_distance;       // dHash Hamming distance (0-64) at or below which a frame is a duplicate
+    bool roi_enabled;             // Routine frames are ROI crops; a full frame follows each event
+    cam_roi_t roi;                // Region of interest (sensor window)
+    const char *roi_upload_url;   // HTTP endpoint for ROI images (NULL = upload_url)
+    const char *roi_mqtt_topic;   // MQTT prefix for ROI images (NULL = mqtt_topic)
+    uint8_t burst_frames;         // Frames per burst (0 = bursts off, max CAM_PIPELINE_BURST_MAX)
+    bool burst_on_rain;           // Start a burst when rain sets in
+    bool spool;                   // Move frames to the flash spool while offline or after failed uploads
+    uint8_t spool_batch;          // HTTP: spooled frames per multipart request (0/1 = one per request)
+    const char *batch_upload_url; // HTTP endpoint for multipart batches (NULL = upload_url)
+    cam_pipeline_context_cb_t manifest_context; // Per-frame device context for batch manifests (may be NULL)
+    void *manifest_ctx;           // Passed to manifest_context
+    cam_pipeline_snapshot_cb_t snapshot; // Attach a sensor record to every frame (NULL = off)
+    void *snapshot_ctx;           // Passed to snapshot
+    const char *snapshot_url;     // HTTP endpoint for frame + record (NULL = batch_upload_url, then upload_url)
+} cam_pipeline_config_t;
+
+/**
+ * @brief Pipeline statistics
+ */
+typedef struct {
+    uint32_t captured;         // Frames copied into the ring
+    uint32_t capture_failed;   // Camera returned no frame
+    uint32_t skipped;          // Frames discarded by the change trigger
+    uint32_t dropped;          // Oldest queued frames overwritten because the ring was full
+    uint32_t oversize;         // Frames larger than a ring slot
+    uint32_t uploaded;         // Frames uploaded successfully
+    uint32_t upload_failed;    // Frames given up after all upload attempts
+    uint8_t queue_depth;       // Frames waiting for upload
+    uint8_t queue_peak;        // Highest queue depth seen
+    uint32_t interval_max_ms;  // Longest gap between two captures
+    uint32_t latency_last_ms;  // Capture-to-upload latency of the last frame
+    uint32_t latency_avg_ms;   // Average capture-to-upload latency
+    uint32_t latency_max_ms;   // Worst capture-to-upload latency
+    uint32_t rain_last_us;     // Rain analysis time of the last frame (including decode)
+    uint32_t rain_avg_us;      // Average rain analysis time per frame
+    uint32_t visibility_last_us; // Visibility estimate time of the last frame (decode shared with rain)
+    uint32_t visibility_avg_us;  // Average visibility estimate time per frame
+    uint32_t visibility_max_us;  // Slowest visibility estimate
+    uint32_t vib_checked;      // Frames checked by the vibration gate
+    uint32_t vib_rejected;     // Frames rejected for vibration (including retries)
+    uint32_t vib_deferred;     // Capture periods that ended without a steady frame
+    uint32_t sharpness_kept;   // Average Laplacian sharpness of gate-accepted frames
+    uint32_t sharpness_rejected; // Average Laplacian sharpness of rejected frames
+    uint32_t jpeg_kept_avg;    // Average JPEG size of gate-accepted frames
+    uint32_t jpeg_rejected_avg; // Average JPEG size of rejected frames
+    uint32_t dedup_skipped;    // Frames skipped as near-duplicates
+    uint64_t dedup_bytes_saved; // JPEG bytes not uploaded thanks to dedup
+    uint8_t dedup_last_distance; // Hash distance of the last hashed frame to the last kept frame
+    uint32_t hash_avg_us;      // Average hash time per frame (including decode)
+    uint32_t event_frames;     // Full frames queued after a change or rain onset in the ROI
+    uint32_t bursts;           // Bursts captured
+    uint32_t burst_frames;     // Frames queued by bursts
+    float burst_fps;           // Frame rate achieved by the last burst
+    uint32_t burst_first_ms;   // Trigger to first frame of the last burst
+    uint32_t burst_first_max_ms; // Worst trigger to first frame
+    uint32_t spooled;          // Frames moved to the flash spool
+    uint32_t spool_uploaded;   // Spooled frames uploaded after the link returned
+    uint32_t snapshots;        // Frames queued with a sensor record
+    uint32_t snapshot_skew_last_ms; // Capture to farthest sensor sample, last record
+    uint32_t snapshot_skew_avg_ms;  // Average of the above
+    uint32_t snapshot_skew_max_ms;  // Worst of the above
+} cam_pipeline_stats_t;
+
+/**
+ * @brief Allocate the frame ring and start the capture and upload tasks
+ * The camera must already be initialized with cam_config_init(). With spool
+ * enabled the image spool is mounted as well and drains into the same
+ * uplink whenever the link is up and the ring is empty.
+ * @param config Pipeline configuration
+ * @return ESP_OK on success
+ */
+esp_err_t cam_pipeline_start(const cam_pipeline_config_t *config);
+
+/**
+ * @brief Request a burst of full frames around an event
+ *
+ * Wakes the capture task, which grabs burst_frames frames back to back and
+ * queues them for upload with a common event id, the trigger time and each
+ * frame's offset from it. Requests arriving while one is pending are merged.
+ * Safe to call from any task (e.g. a sensor callback).
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if bursts are not enabled
+ */
+esp_err_t cam_pipeline_burst_request(void);
+
+/**
+ * @brief Get pipeline statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t cam_pipeline_get_stats(cam_pipeline_stats_t *stats);
+
+/**
+ * @brief Get the rain estimate of the most recent frame
+ * @param result Pointer to result structure
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if no frame was analysed yet
+ */
+esp_err_t cam_pipeline_get_rain(rain_result_t *result);
+
+/**
+ * @brief Get the visibility estimate of the most recent frame
+ * @param result Pointer to result structure
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if no frame was analysed yet
+ */
+esp_err_t cam_pipeline_get_visibility(visibility_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAM_PIPELINE_H
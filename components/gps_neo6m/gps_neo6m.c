@@ -22,19 +22,30 @@ static gps_data_t last_valid_data = {0};
 static bool parse_gprmc(const char *sentence, gps_data_t *data)
 {
     // $GPRMC format: $GPRMC,time,status,lat,N/S,lon,E/W,speed,course,date,mag,E/W,mode*checksum
-    char temp[128];
+    char temp[128] = {0};
     strncpy(temp, sentence, sizeof(temp) - 1);
 
-    char *token = strtok(temp, ",");
+    // Split by hand: strtok would skip empty fields (course is often empty)
+    char *token = temp;
     int field = 0;
     char lat_str[16] = {0}, lon_str[16] = {0};
     char lat_dir = 'N', lon_dir = 'E';
     char status = 'V';
+    char time_str[7] = {0}, date_str[7] = {0};
 
     while (token != NULL && field < 12)
     {
+        char *next = strchr(token, ',');
+        if (next)
+        {
+            *next++ = '\0';
+        }
+
         switch (field)
         {
+        case 1:
+            strncpy(time_str, token, sizeof(time_str) - 1);
+            break; // hhmmss.ss
         case 2:
             status = token[0];
             break; // A=valid, V=invalid
@@ -56,8 +67,11 @@ static bool parse_gprmc(const char *sentence, gps_data_t *data)
         case 8:
             data->course = atof(token);
             break;
+        case 9:
+            strncpy(date_str, token, sizeof(date_str) - 1);
+            break; // ddmmyy
         }
-        token = strtok(NULL, ",");
+        token = next;
         field++;
     }
 
@@ -66,6 +80,19 @@ static bool parse_gprmc(const char *sentence, gps_data_t *data)
         return false; // No GPS fix
     }
 
+    if (strlen(time_str) == 6)
+    {
+        data->hour = (time_str[0] - '0') * 10 + (time_str[1] - '0');
+        data->minute = (time_str[2] - '0') * 10 + (time_str[3] - '0');
+        data->second = (time_str[4] - '0') * 10 + (time_str[5] - '0');
+    }
+    if (strlen(date_str) == 6)
+    {
+        data->day = (date_str[0] - '0') * 10 + (date_str[1] - '0');
+        data->month = (date_str[2] - '0') * 10 + (date_str[3] - '0');
+        data->year = 2000 + (date_str[4] - '0') * 10 + (date_str[5] - '0');
+    }
+
     // Convert DDMM.MMMM to decimal degrees
     if (strlen(lat_str) > 0)
     {
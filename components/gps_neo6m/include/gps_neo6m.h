@@ -28,6 +28,9 @@ typedef struct {
     uint8_t hour;         // UTC time - hours
     uint8_t minute;       // UTC time - minutes
     uint8_t second;       // UTC time - seconds
+    uint8_t day;          // UTC date - day of month
+    uint8_t month;        // UTC date - month (1-12)
+    uint16_t year;        // UTC date - year (0 = no date yet)
 } gps_data_t;
 
 /**
@@ -0,0 +1,87 @@
+/**
+ * @file bench_image_analysis.c
+ * @brief Per-frame timing of the image analysis kernels on the corpus
+ *
+ * Host timings only rank the kernels and catch regressions; the frame budget
+ * on the ESP32-S3 is checked with the pipeline's own per-frame stats.
+ *
+ * Usage: bench_image_analysis <corpus dir> [rounds]
+ */
+
+#include "corpus.h"
+#include "image_analysis.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static volatile uint32_t sink; // Keeps results alive
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <corpus dir> [rounds]\n", argv[0]);
+        return 2;
+    }
+    int rounds = argc > 2 ? atoi(argv[2]) : 1000;
+    if (rounds < 1)
+    {
+        rounds = 1;
+    }
+
+    corpus_image_t images[CORPUS_MAX_IMAGES];
+    int count = corpus_load(argv[1], images, CORPUS_MAX_IMAGES);
+    if (count <= 0)
+    {
+        return 2;
+    }
+
+    printf("%-16s %9s %9s %9s %9s %9s  (us/frame, %d rounds)\n", "image", "rain", "visib", "sharp", "dhash", "total",
+           rounds);
+    for (int i = 0; i < count; i++)
+    {
+        const corpus_image_t *img = &images[i];
+        rain_detector_t det;
+        rain_result_t rain;
+        image_analysis_rain_init(&det, NULL);
+
+        double t0 = now_us();
+        for (int r = 0; r < rounds; r++)
+        {
+            image_analysis_rain_update(&det, img->gray, img->width, img->height, &rain);
+            sink += rain.score;
+        }
+        double t1 = now_us();
+        for (int r = 0; r < rounds; r++)
+        {
+            visibility_result_t vis;
+            image_analysis_visibility(img->gray, img->width, img->height, &vis);
+            sink += vis.index;
+        }
+        double tv = now_us();
+        for (int r = 0; r < rounds; r++)
+        {
+            sink += image_analysis_sharpness(img->gray, img->width, img->height);
+        }
+        double t2 = now_us();
+        for (int r = 0; r < rounds; r++)
+        {
+            sink += (uint32_t)image_analysis_dhash(img->gray, img->width, img->height);
+        }
+        double t3 = now_us();
+
+        printf("%-16s %9.1f %9.1f %9.1f %9.1f %9.1f  (%ux%u)\n", img->name, (t1 - t0) / rounds,
+               (tv - t1) / rounds, (t2 - tv) / rounds, (t3 - t2) / rounds, (t3 - t0) / rounds, img->width,
+               img->height);
+    }
+
+    corpus_free(images, count);
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file corpus.c
+ * @brief PGM (P5) loader for the labelled test corpus
+ */
+
+#include "corpus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t *load_pgm(const char *path, uint16_t *width, uint16_t *height)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return NULL;
+    }
+
+    unsigned int w = 0, h = 0, maxval = 0;
+    uint8_t *gray = NULL;
+    if (fscanf(f, "P5 %u %u %u", &w, &h, &maxval) == 3 && maxval == 255 && w > 0 && h > 0 &&
+        w <= UINT16_MAX && h <= UINT16_MAX && fgetc(f) != EOF)
+    {
+        gray = malloc((size_t)w * h);
+        if (gray && fread(gray, 1, (size_t)w * h, f) != (size_t)w * h)
+        {
+            free(gray);
+            gray = NULL;
+        }
+    }
+    fclose(f);
+
+    if (!gray)
+    {
+        fprintf(stderr, "%s: not an 8-bit binary PGM\n", path);
+        return NULL;
+    }
+    *width = (uint16_t)w;
+    *height = (uint16_t)h;
+    return gray;
+}
+
+int corpus_load(const char *dir, corpus_image_t *images, int max_images)
+{
+    char labels[512], path[512];
+    snprintf(labels, sizeof(labels), "%s/labels.csv", dir);
+    FILE *f = fopen(labels, "r");
+    if (!f)
+    {
+        fprintf(stderr, "%s: cannot open\n", labels);
+        return -1;
+    }
+
+    int count = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        if (count == max_images)
+        {
+            fprintf(stderr, "%s: more than %d images\n", labels, max_images);
+            break;
+        }
+
+        corpus_image_t *img = &images[count];
+        int rain = 0, fog = 0;
+        memset(img, 0, sizeof(*img));
+        if (sscanf(line, "%63[^,],%d,%d", img->name, &rain, &fog) != 3)
+        {
+            fprintf(stderr, "%s: bad line '%s'\n", labels, line);
+            continue;
+        }
+        img->rain = rain != 0;
+        img->fog = fog != 0;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, img->name);
+        img->gray = load_pgm(path, &img->width, &img->height);
+        if (!img->gray)
+        {
+            fclose(f);
+            corpus_free(images, count);
+            return -1;
+        }
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+void corpus_free(corpus_image_t *images, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        free(images[i].gray);
+        images[i].gray = NULL;
+    }
+}
+
+const corpus_image_t *corpus_find(const corpus_image_t *images, int count, const char *name)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(images[i].name, name) == 0)
+        {
+            return &images[i];
+        }
+    }
+    return NULL;
+}
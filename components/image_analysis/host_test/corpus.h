@@ -0,0 +1,36 @@
+/**
+ * @file corpus.h
+ * @brief Labelled grayscale test images (PGM) for the host tests
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CORPUS_MAX_IMAGES 32
+
+typedef struct {
+    char name[64];
+    bool rain;              // Label: rain streaks / droplets present
+    bool fog;               // Label: scene washed out by fog or haze
+    uint16_t width;
+    uint16_t height;
+    uint8_t *gray;
+} corpus_image_t;
+
+/**
+ * @brief Load every image listed in <dir>/labels.csv
+ * @return Number of images loaded, -1 on error
+ */
+int corpus_load(const char *dir, corpus_image_t *images, int max_images);
+
+void corpus_free(corpus_image_t *images, int count);
+
+/**
+ * @brief Find a loaded image by file name
+ */
+const corpus_image_t *corpus_find(const corpus_image_t *images, int count, const char *name);
+
+#endif // CORPUS_H
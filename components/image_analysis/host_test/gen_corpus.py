@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""
+Generate the labelled grayscale corpus for the image_analysis host tests.
+
+Scenes are synthetic 200x150 frames, the size of the 1/8 analysis frame of
+a UXGA capture: a sky gradient over buildings with windows and a track,
+softened like the scaled JPEG decode, plus sensor noise. Rain adds thin bright near-vertical streaks and droplet
+highlights; fog blends the scene towards the airlight, I = J*t + A*(1 - t).
+Output is binary PGM plus labels.csv. Deterministic, so re-running only
+changes files if this script changes.
+
+Usage:
+  python components/image_analysis/host_test/gen_corpus.py
+"""
+
+import os
+import random
+
+WIDTH, HEIGHT = 200, 150
+AIRLIGHT = 215
+HERE = os.path.dirname(os.path.abspath(__file__))
+OUT = os.path.join(HERE, "corpus")
+
+
+def clamp(v):
+    return 0 if v < 0 else 255 if v > 255 else int(v)
+
+
+def scene(seed):
+    rng = random.Random(seed)
+    img = [[0.0] * WIDTH for _ in range(HEIGHT)]
+    horizon = 60 + rng.randint(-8, 8)
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            img[y][x] = 200 - y * 0.4 if y < horizon else 70 + (y - horizon) * 0.3
+    # Buildings with lit and dark windows
+    x = 0
+    while x < WIDTH:
+        w = rng.randint(18, 40)
+        top = horizon - rng.randint(10, 45)
+        shade = rng.randint(40, 140)
+        for yy in range(top, horizon + 10):
+            for xx in range(x, min(x + w, WIDTH)):
+                img[yy][xx] = shade
+        for wy in range(top + 4, horizon + 4, 7):
+            for wx in range(x + 3, min(x + w - 3, WIDTH - 3), 6):
+                level = shade + rng.choice((-1, 1)) * rng.randint(15, 40)
+                for yy in range(wy, wy + 3):
+                    for xx in range(wx, wx + 3):
+                        img[yy][xx] = level
+        x += w + rng.randint(0, 6)
+    # Track: two rails converging to the horizon
+    for y in range(horizon + 10, HEIGHT):
+        spread = (y - horizon) * 0.9
+        for rail in (WIDTH / 2 - spread, WIDTH / 2 + spread):
+            xi = int(rail)
+            if 0 <= xi < WIDTH - 1:
+                img[y][xi] = 150
+                img[y][xi + 1] = 120
+    return soften(img), rng
+
+
+def soften(img):
+    # [1 2 1] / 4 in both directions: the box averaging of the 1/8 decode
+    def blur_row(row):
+        return [(row[max(x - 1, 0)] + 2 * row[x] + row[min(x + 1, WIDTH - 1)]) / 4 for x in range(WIDTH)]
+
+    rows = [blur_row(row) for row in img]
+    return [[(rows[max(y - 1, 0)][x] + 2 * rows[y][x] + rows[min(y + 1, HEIGHT - 1)][x]) / 4
+             for x in range(WIDTH)] for y in range(HEIGHT)]
+
+
+def add_rain(img, rng, streaks, droplets):
+    for _ in range(streaks):
+        x = rng.randint(1, WIDTH - 2)
+        y = rng.randint(0, HEIGHT - 16)
+        length = rng.randint(6, 15)
+        boost = rng.randint(45, 80)
+        for i in range(length):
+            xx = x + (i // 8)  # Slight slant
+            if xx < WIDTH - 1:
+                img[y + i][xx] += boost
+    for _ in range(droplets):
+        x = rng.randint(1, WIDTH - 3)
+        y = rng.randint(1, HEIGHT - 3)
+        boost = rng.randint(60, 100)
+        for yy in (y, y + 1):
+            for xx in (x, x + 1):
+                img[yy][xx] += boost
+
+
+def add_fog(img, transmission):
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            img[y][x] = img[y][x] * transmission + AIRLIGHT * (1 - transmission)
+
+
+def finish(img, rng, noise):
+    return bytes(clamp(v + rng.gauss(0, noise)) for row in img for v in row)
+
+
+def write_pgm(name, data):
+    with open(os.path.join(OUT, name), "wb") as f:
+        f.write(b"P5\n%d %d\n255\n" % (WIDTH, HEIGHT))
+        f.write(data)
+
+
+# name, seed, rain streaks, droplets, fog transmission (1 = none), labels
+CORPUS = [
+    ("clear_1.pgm", 1, 0, 0, 1.0, "clear"),
+    ("clear_2.pgm", 2, 0, 0, 1.0, "clear"),
+    ("rain_light.pgm", 3, 60, 2, 1.0, "rain"),
+    ("rain_heavy.pgm", 4, 300, 15, 1.0, "rain"),
+    ("fog_light.pgm", 5, 0, 0, 0.45, "fog"),
+    ("fog_dense.pgm", 6, 0, 0, 0.15, "fog"),
+]
+
+
+def main():
+    os.makedirs(OUT, exist_ok=True)
+    lines = ["# file,rain,fog"]
+    for name, seed, streaks, droplets, transmission, label in CORPUS:
+        img, rng = scene(seed)
+        add_rain(img, rng, streaks, droplets)
+        if transmission < 1.0:
+            add_fog(img, transmission)
+        write_pgm(name, finish(img, rng, 3))
+        lines.append(f"{name},{int('rain' in label)},{int('fog' in label)}")
+    with open(os.path.join(OUT, "labels.csv"), "w") as f:
+        f.write("\n".join(lines) + "\n")
+    print(f"{len(CORPUS)} images in {OUT}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,152 @@
+/**
+ * @file test_image_analysis.c
+ * @brief Check the image analysis kernels against the labelled corpus
+ *
+ * Usage: test_image_analysis <corpus dir>
+ */
+
+#include "corpus.h"
+#include "image_analysis.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                  \
+    do                                    \
+    {                                     \
+        if (!(cond))                      \
+        {                                 \
+            printf("FAIL: " __VA_ARGS__); \
+            printf("\n");                 \
+            failures++;                   \
+        }                                 \
+    } while (0)
+
+// Every image on its own, as the first frame after boot (no contrast baseline)
+static void test_rain_labels(const corpus_image_t *images, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const corpus_image_t *img = &images[i];
+        rain_detector_t det;
+        rain_result_t result;
+        image_analysis_rain_init(&det, NULL);
+
+        CHECK(image_analysis_rain_update(&det, img->gray, img->width, img->height, &result),
+              "%s: rain update rejected", img->name);
+        printf("%-16s rain=%d score=%3u streaks=%3u droplets=%3u contrast=%lu\n", img->name, img->rain,
+               result.score, result.streak_permille, result.droplet_permille, (unsigned long)result.contrast);
+        CHECK(result.raining == img->rain, "%s: raining=%d, labelled %d", img->name, result.raining, img->rain);
+    }
+}
+
+// The baseline learned from clear frames must not make later clear frames look rainy
+static void test_rain_sequence(const corpus_image_t *images, int count)
+{
+    rain_detector_t det;
+    rain_result_t result;
+    image_analysis_rain_init(&det, NULL);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!images[i].rain)
+        {
+            image_analysis_rain_update(&det, images[i].gray, images[i].width, images[i].height, &result);
+        }
+    }
+    CHECK(det.contrast_baseline > 0, "sequence: no baseline learned from clear frames");
+
+    for (int i = 0; i < count; i++)
+    {
+        const corpus_image_t *img = &images[i];
+        uint32_t baseline = det.contrast_baseline;
+        image_analysis_rain_update(&det, img->gray, img->width, img->height, &result);
+        CHECK(result.raining == img->rain, "sequence %s: raining=%d, labelled %d", img->name, result.raining,
+              img->rain);
+        if (img->rain)
+        {
+            CHECK(det.contrast_baseline == baseline, "sequence %s: baseline moved on a rain frame", img->name);
+        }
+    }
+}
+
+#define VISIBILITY_FOG_INDEX 50 // Index below which a frame counts as foggy
+
+static void test_visibility_labels(const corpus_image_t *images, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const corpus_image_t *img = &images[i];
+        visibility_result_t result;
+
+        CHECK(image_analysis_visibility(img->gray, img->width, img->height, &result),
+              "%s: visibility rejected", img->name);
+        printf("%-16s fog=%d index=%3u contrast=%3u edges=%3u dark=%3u airlight=%3u transmission=%3u\n",
+               img->name, img->fog, result.index, result.contrast_permille, result.edge_permille,
+               result.dark_channel, result.airlight, result.transmission_percent);
+        CHECK((result.index < VISIBILITY_FOG_INDEX) == img->fog, "%s: index %u, labelled fog=%d", img->name,
+              result.index, img->fog);
+    }
+}
+
+// Blending a clear frame towards the airlight must never raise the index
+static void test_visibility_monotonic(const corpus_image_t *img)
+{
+    size_t pixels = (size_t)img->width * img->height;
+    uint8_t *foggy = malloc(pixels);
+    int last = 101;
+
+    for (int t = 100; t >= 0; t -= 10)
+    {
+        for (size_t p = 0; p < pixels; p++)
+        {
+            foggy[p] = (uint8_t)((img->gray[p] * t + 215 * (100 - t)) / 100);
+        }
+        visibility_result_t result;
+        image_analysis_visibility(foggy, img->width, img->height, &result);
+        CHECK(result.index <= last, "%s at %d%% transmission: index %u above %d", img->name, t, result.index,
+              last);
+        last = result.index;
+    }
+    CHECK(last < 10, "%s fully fogged: index %d", img->name, last);
+    free(foggy);
+}
+
+static void test_invalid_args(const corpus_image_t *img)
+{
+    rain_detector_t det;
+    rain_result_t result;
+    image_analysis_rain_init(&det, NULL);
+    CHECK(!image_analysis_rain_update(&det, NULL, img->width, img->height, &result), "NULL frame accepted");
+    CHECK(!image_analysis_rain_update(&det, img->gray, 2, img->height, &result), "2 px wide frame accepted");
+
+    visibility_result_t vis;
+    CHECK(!image_analysis_visibility(img->gray, VISIBILITY_MAX_WIDTH + 1, 3, &vis), "over-wide frame accepted");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <corpus dir>\n", argv[0]);
+        return 2;
+    }
+
+    corpus_image_t images[CORPUS_MAX_IMAGES];
+    int count = corpus_load(argv[1], images, CORPUS_MAX_IMAGES);
+    if (count <= 0)
+    {
+        return 2;
+    }
+
+    test_rain_labels(images, count);
+    test_rain_sequence(images, count);
+    test_visibility_labels(images, count);
+    test_visibility_monotonic(&images[0]);
+    test_invalid_args(&images[0]);
+
+    corpus_free(images, count);
+    printf("%d images, %d failures\n", count, failures);
+    return failures ? 1 : 0;
+}
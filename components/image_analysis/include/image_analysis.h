@@ -0,0 +1,162 @@
+/**
+ * @file image_analysis.h
+ * @brief Image Analysis Kernels on Downscaled Grayscale Frames
+ *
+ * Plain C with integer arithmetic only and no ESP-IDF dependencies, so the
+ * kernels also build on a host compiler.
+ */
+
+#ifndef IMAGE_ANALYSIS_H
+#define IMAGE_ANALYSIS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Rain Detection
+// ============================================================================
+
+/**
+ * @brief Rain detector thresholds
+ */
+typedef struct {
+    uint8_t streak_threshold;   // Horizontal ridge strength of a rain streak pixel
+    uint8_t droplet_threshold;  // Ridge strength (both axes) of a droplet highlight pixel
+    uint8_t rain_score_threshold; // Score (0-100) at which rain is reported
+} rain_detect_config_t;
+
+/**
+ * @brief Rain detector state (contrast baseline learned from clear frames)
+ */
+typedef struct {
+    rain_detect_config_t config;
+    uint32_t contrast_baseline; // Normalised contrast of a clear scene (x256), 0 = not learned
+} rain_detector_t;
+
+/**
+ * @brief Rain estimate for one frame
+ */
+typedef struct {
+    uint8_t score;                  // Rain intensity score 0-100
+    bool raining;                   // score >= rain_score_threshold
+    uint16_t streak_permille;       // Streak pixels per 1000 pixels
+    uint16_t droplet_permille;      // Droplet highlight pixels per 1000 pixels
+    uint32_t contrast;              // Mean gradient / mean intensity (x256)
+    uint8_t contrast_loss_percent;  // Contrast drop against the clear-scene baseline
+} rain_result_t;
+
+/**
+ * @brief Initialize a rain detector
+ * @param det Detector state
+ * @param config Thresholds (NULL = defaults)
+ */
+void image_analysis_rain_init(rain_detector_t *det, const rain_detect_config_t *config);
+
+/**
+ * @brief Estimate rain presence and intensity from a grayscale frame
+ *
+ * One pass over the interior pixels computes gradient contrast, near-vertical
+ * streak pixels (bright, thin, vertically continuous) and droplet highlights
+ * (bright in both axes). The clear-scene contrast baseline is updated while
+ * no rain is detected.
+ *
+ * @param det Detector state
+ * @param gray Grayscale pixels, row-major, width*height bytes
+ * @param width Frame width (>= 3)
+ * @param height Frame height (>= 3)
+ * @param result Receives the estimate
+ * @return true on success, false on invalid arguments
+ */
+bool image_analysis_rain_update(rain_detector_t *det, const uint8_t *gray,
+                                uint16_t width, uint16_t height, rain_result_t *result);
+
+// ============================================================================
+// Visibility / Fog
+// ============================================================================
+
+#define VISIBILITY_BLOCK 8          // Dark-channel patch size (pixels)
+#define VISIBILITY_MAX_WIDTH 2048   // Widest frame accepted
+
+/**
+ * @brief Visibility estimate for one frame
+ */
+typedef struct {
+    uint8_t index;                  // Visibility 0 (white-out) to 100 (clear, detailed scene)
+    uint8_t mean;                   // Mean intensity
+    uint16_t contrast_permille;     // RMS contrast: standard deviation / mean x1000
+    uint16_t edge_permille;         // Pixels with a gradient above the edge threshold per 1000
+    uint8_t dark_channel;           // Mean of the per-patch minima
+    uint8_t airlight;               // Brightest patch mean (haze / sky brightness)
+    uint8_t transmission_percent;   // 100 - dark_channel / airlight (haze-free share of the light)
+} visibility_result_t;
+
+/**
+ * @brief Estimate visibility from contrast, edge density and the dark channel
+ *
+ * One pass computes the intensity moments, the gradient edge count and the
+ * minimum and mean of every VISIBILITY_BLOCK square patch. Fog and heavy rain
+ * lift the darkest patches towards the airlight, flatten the histogram and
+ * wash out edges; the index combines the three. Keeps no state between
+ * frames, so frames can be compared across restarts. Not reentrant: the patch
+ * rows live in static buffers, so call it from one task only.
+ *
+ * @param gray Grayscale pixels, row-major, width*height bytes
+ * @param width Frame width (3 to VISIBILITY_MAX_WIDTH)
+ * @param height Frame height (>= 3)
+ * @param result Receives the estimate
+ * @return true on success, false on invalid arguments
+ */
+bool image_analysis_visibility(const uint8_t *gray, uint16_t width, uint16_t height,
+                               visibility_result_t *result);
+
+// ============================================================================
+// Sharpness
+// ============================================================================
+
+/**
+ * @brief Sharpness proxy: mean absolute 4-neighbour Laplacian
+ *
+ * Motion blur flattens fine detail, so a blurred frame scores lower than a
+ * sharp frame of the same scene. Only comparable between frames of similar
+ * content and scale.
+ *
+ * @param gray Grayscale pixels, row-major, width*height bytes
+ * @param width Frame width (>= 3)
+ * @param height Frame height (>= 3)
+ * @return Mean |Laplacian| x16, 0 on invalid arguments
+ */
+uint32_t image_analysis_sharpness(const uint8_t *gray, uint16_t width, uint16_t height);
+
+// ============================================================================
+// Perceptual Hash
+// ============================================================================
+
+/**
+ * @brief 64-bit difference hash (dHash)
+ *
+ * The frame is box-averaged down to 9x8 cells in one pass; each bit says
+ * whether a cell is darker than its right-hand neighbour. Frames of the same
+ * scene differ in only a few bits despite noise and JPEG artefacts.
+ *
+ * @param gray Grayscale pixels, row-major, width*height bytes
+ * @param width Frame width (>= 9)
+ * @param height Frame height (>= 8)
+ * @return Hash, 0 on invalid arguments
+ */
+uint64_t image_analysis_dhash(const uint8_t *gray, uint16_t width, uint16_t height);
+
+/**
+ * @brief Number of differing bits between two hashes
+ */
+uint8_t image_analysis_hash_distance(uint64_t a, uint64_t b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMAGE_ANALYSIS_H
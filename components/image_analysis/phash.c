@@ -0,0 +1,66 @@
+/**
+ * @file phash.c
+ * @brief Difference Hash (dHash) for Near-Duplicate Detection
+ */
+
+#include "image_analysis.h"
+#include <string.h>
+
+#define DHASH_COLS 9
+#define DHASH_ROWS 8
+
+uint64_t image_analysis_dhash(const uint8_t *gray, uint16_t width, uint16_t height)
+{
+    if (!gray || width < DHASH_COLS || height < DHASH_ROWS)
+    {
+        return 0;
+    }
+
+    // Column boundaries: column c covers x in [col_start[c], col_start[c + 1])
+    uint16_t col_start[DHASH_COLS + 1];
+    uint32_t col_width[DHASH_COLS];
+    for (int c = 0; c <= DHASH_COLS; c++)
+    {
+        col_start[c] = (uint16_t)(((uint32_t)c * width + DHASH_COLS - 1) / DHASH_COLS);
+    }
+    for (int c = 0; c < DHASH_COLS; c++)
+    {
+        col_width[c] = col_start[c + 1] - col_start[c];
+    }
+
+    uint32_t sums[DHASH_ROWS][DHASH_COLS];
+    memset(sums, 0, sizeof(sums));
+
+    for (uint16_t y = 0; y < height; y++)
+    {
+        uint32_t *cells = sums[(uint32_t)y * DHASH_ROWS / height];
+        const uint8_t *row = gray + y * width;
+        for (int c = 0; c < DHASH_COLS; c++)
+        {
+            uint32_t sum = 0;
+            for (uint16_t x = col_start[c]; x < col_start[c + 1]; x++)
+            {
+                sum += row[x];
+            }
+            cells[c] += sum;
+        }
+    }
+
+    // Compare cell means without dividing: cells in a row share their height
+    uint64_t hash = 0;
+    for (int r = 0; r < DHASH_ROWS; r++)
+    {
+        for (int c = 0; c < DHASH_COLS - 1; c++)
+        {
+            uint64_t left = (uint64_t)sums[r][c] * col_width[c + 1];
+            uint64_t right = (uint64_t)sums[r][c + 1] * col_width[c];
+            hash = (hash << 1) | (left < right);
+        }
+    }
+    return hash;
+}
+
+uint8_t image_analysis_hash_distance(uint64_t a, uint64_t b)
+{
+    return (uint8_t)__builtin_popcountll(a ^ b);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file rain_detect.c
+ * @brief Raindrop and Streak Detection Implementation
+ *
+ * Cues, all computed in one integer pass:
+ * - Streaks: falling drops appear as thin near-vertical bright lines, i.e. a
+ *   strong horizontal ridge (2c - l - r) with little vertical change.
+ * - Droplets on the lens: small specular highlights, brighter than their
+ *   neighbours in both directions.
+ * - Contrast loss: water on the lens blurs the scene, lowering the mean
+ *   gradient relative to mean brightness compared with a clear baseline.
+ */
+
+#include "image_analysis.h"
+#include <string.h>
+
+#define DEFAULT_STREAK_THRESHOLD 24
+#define DEFAULT_DROPLET_THRESHOLD 32
+#define DEFAULT_RAIN_SCORE_THRESHOLD 30
+
+// Baseline follows clear frames with a 1/16 exponential moving average
+#define BASELINE_SHIFT 4
+
+// Score weights: points per unit of each cue
+#define SCORE_PER_STREAK_PERMILLE 2
+#define SCORE_PER_DROPLET_PERMILLE 4
+#define SCORE_PER_CONTRAST_LOSS_PERCENT 1
+// Fog and dusk lower the contrast too, so on its own this cue stays below
+// the default rain threshold; it only adds to streak and droplet evidence
+#define SCORE_MAX_CONTRAST_LOSS 20
+
+void image_analysis_rain_init(rain_detector_t *det, const rain_detect_config_t *config)
+{
+    memset(det, 0, sizeof(*det));
+
+    if (config)
+    {
+        det->config = *config;
+    }
+    else
+    {
+        det->config.streak_threshold = DEFAULT_STREAK_THRESHOLD;
+        det->config.droplet_threshold = DEFAULT_DROPLET_THRESHOLD;
+        det->config.rain_score_threshold = DEFAULT_RAIN_SCORE_THRESHOLD;
+    }
+}
+
+bool image_analysis_rain_update(rain_detector_t *det, const uint8_t *gray,
+                                uint16_t width, uint16_t height, rain_result_t *result)
+{
+    if (!det || !gray || !result || width < 3 || height < 3)
+    {
+        return false;
+    }
+
+    const int streak_t = det->config.streak_threshold;
+    const int droplet_t = det->config.droplet_threshold;
+
+    uint32_t intensity_sum = 0;
+    uint32_t gradient_sum = 0;
+    uint32_t streaks = 0;
+    uint32_t droplets = 0;
+
+    for (uint16_t y = 1; y < height - 1; y++)
+    {
+        const uint8_t *up = gray + (y - 1) * width;
+        const uint8_t *row = gray + y * width;
+        const uint8_t *down = gray + (y + 1) * width;
+
+        // Branch-light inner loop over contiguous rows
+        for (uint16_t x = 1; x < width - 1; x++)
+        {
+            int c = row[x];
+            int l = row[x - 1];
+            int r = row[x + 1];
+            int u = up[x];
+            int d = down[x];
+
+            int gx = r - l;
+            int gy = d - u;
+            int ridge_h = 2 * c - l - r;
+            int ridge_v = 2 * c - u - d;
+            int abs_ridge_v = ridge_v < 0 ? -ridge_v : ridge_v;
+
+            intensity_sum += c;
+            gradient_sum += (gx < 0 ? -gx : gx) + (gy < 0 ? -gy : gy);
+            streaks += (ridge_h > streak_t) & (2 * abs_ridge_v < streak_t);
+            droplets += (ridge_h > droplet_t) & (ridge_v > droplet_t);
+        }
+    }
+
+    uint32_t pixels = (uint32_t)(width - 2) * (height - 2);
+
+    memset(result, 0, sizeof(*result));
+    result->streak_permille = (uint16_t)(streaks * 1000 / pixels);
+    result->droplet_permille = (uint16_t)(droplets * 1000 / pixels);
+    result->contrast = (uint32_t)(((uint64_t)gradient_sum << 8) / (intensity_sum + 1));
+
+    if (det->contrast_baseline > 0 && result->contrast < det->contrast_baseline)
+    {
+        result->contrast_loss_percent =
+            (uint8_t)((det->contrast_baseline - result->contrast) * 100 / det->contrast_baseline);
+    }
+
+    uint32_t loss_score = result->contrast_loss_percent * SCORE_PER_CONTRAST_LOSS_PERCENT;
+    uint32_t score = result->streak_permille * SCORE_PER_STREAK_PERMILLE +
+                     result->droplet_permille * SCORE_PER_DROPLET_PERMILLE +
+                     (loss_score > SCORE_MAX_CONTRAST_LOSS ? SCORE_MAX_CONTRAST_LOSS : loss_score);
+    result->score = score > 100 ? 100 : (uint8_t)score;
+    result->raining = result->score >= det->config.rain_score_threshold;
+
+    // Learn the clear-scene contrast only from frames without rain
+    if (!result->raining)
+    {
+        if (det->contrast_baseline == 0)
+        {
+            det->contrast_baseline = result->contrast;
+        }
+        else
+        {
+            int32_t delta = (int32_t)result->contrast - (int32_t)det->contrast_baseline;
+            det->contrast_baseline = (uint32_t)((int32_t)det->contrast_baseline + delta / (1 << BASELINE_SHIFT));
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file sharpness.c
+ * @brief Laplacian Sharpness Estimate
+ */
+
+#include "image_analysis.h"
+
+uint32_t image_analysis_sharpness(const uint8_t *gray, uint16_t width, uint16_t height)
+{
+    if (!gray || width < 3 || height < 3)
+    {
+        return 0;
+    }
+
+    uint32_t sum = 0;
+    for (uint16_t y = 1; y < height - 1; y++)
+    {
+        const uint8_t *up = gray + (y - 1) * width;
+        const uint8_t *row = gray + y * width;
+        const uint8_t *down = gray + (y + 1) * width;
+
+        for (uint16_t x = 1; x < width - 1; x++)
+        {
+            int lap = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+            sum += lap < 0 ? -lap : lap;
+        }
+    }
+
+    uint32_t pixels = (uint32_t)(width - 2) * (height - 2);
+    return (uint32_t)(((uint64_t)sum << 4) / pixels);
+}
@@ -0,0 +1,141 @@
+/**
+ * @file visibility.c
+ * @brief Visibility and Fog Estimate
+ *
+ * Cues, all gathered in one pass over the rows:
+ * - Contrast: fog scatters light into every pixel, compressing the
+ *   histogram, so the standard deviation drops relative to the mean.
+ * - Edge density: distant detail vanishes first, so fewer pixels carry a
+ *   strong gradient.
+ * - Dark channel: in a clear outdoor scene most patches contain some dark
+ *   pixel (shadow, foliage, tarmac); haze adds airlight to all of them,
+ *   lifting the patch minima towards the brightest patch.
+ */
+
+#include "image_analysis.h"
+#include <string.h>
+
+#define EDGE_THRESHOLD 24 // |gx| + |gy| of an edge pixel (central differences)
+
+// Index weights (sum 100) and the cue values that count as fully clear
+#define WEIGHT_TRANSMISSION 40
+#define WEIGHT_CONTRAST 30
+#define WEIGHT_EDGES 30
+#define CLEAR_CONTRAST_PERMILLE 500
+#define CLEAR_EDGE_PERMILLE 200
+
+#define MAX_BLOCKS ((VISIBILITY_MAX_WIDTH + VISIBILITY_BLOCK - 1) / VISIBILITY_BLOCK)
+
+static uint32_t score(uint32_t value, uint32_t clear)
+{
+    return value >= clear ? 100 : value * 100 / clear;
+}
+
+bool image_analysis_visibility(const uint8_t *gray, uint16_t width, uint16_t height,
+                               visibility_result_t *result)
+{
+    if (!gray || !result || width < 3 || height < 3 || width > VISIBILITY_MAX_WIDTH)
+    {
+        return false;
+    }
+
+    // Static (about 1.3 KB) to keep them off the capture task's stack
+    static uint8_t block_min[MAX_BLOCKS];
+    static uint32_t block_sum[MAX_BLOCKS];
+    const uint16_t blocks_x = (width + VISIBILITY_BLOCK - 1) / VISIBILITY_BLOCK;
+
+    uint32_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint32_t edges = 0;
+    uint32_t dark_sum = 0;
+    uint32_t patches = 0;
+    uint8_t airlight = 0;
+
+    for (uint16_t y = 0; y < height; y++)
+    {
+        const uint8_t *row = gray + y * width;
+
+        if (y % VISIBILITY_BLOCK == 0)
+        {
+            memset(block_min, 0xFF, blocks_x);
+            memset(block_sum, 0, blocks_x * sizeof(uint32_t));
+        }
+
+        // Moments and patch statistics, one patch span at a time
+        uint32_t row_sq = 0;
+        for (uint16_t bx = 0, x = 0; bx < blocks_x; bx++)
+        {
+            uint16_t end = x + VISIBILITY_BLOCK < width ? x + VISIBILITY_BLOCK : width;
+            uint8_t lo = block_min[bx];
+            uint32_t bsum = 0;
+            for (; x < end; x++)
+            {
+                uint8_t c = row[x];
+                lo = c < lo ? c : lo;
+                bsum += c;
+                row_sq += (uint32_t)c * c;
+            }
+            block_min[bx] = lo;
+            block_sum[bx] += bsum;
+            sum += bsum;
+        }
+        sum_sq += row_sq;
+
+        // Edges on interior rows
+        if (y > 0 && y < height - 1)
+        {
+            const uint8_t *up = row - width;
+            const uint8_t *down = row + width;
+            for (uint16_t x = 1; x < width - 1; x++)
+            {
+                int gx = row[x + 1] - row[x - 1];
+                int gy = down[x] - up[x];
+                edges += ((gx < 0 ? -gx : gx) + (gy < 0 ? -gy : gy)) > EDGE_THRESHOLD;
+            }
+        }
+
+        // Fold a finished patch row into the dark channel and airlight
+        if (y % VISIBILITY_BLOCK == VISIBILITY_BLOCK - 1 || y == height - 1)
+        {
+            uint32_t rows = y % VISIBILITY_BLOCK + 1;
+            for (uint16_t bx = 0; bx < blocks_x; bx++)
+            {
+                uint32_t cols = (bx + 1) * VISIBILITY_BLOCK <= width ? VISIBILITY_BLOCK
+                                                                    : width - bx * VISIBILITY_BLOCK;
+                uint8_t mean = (uint8_t)(block_sum[bx] / (rows * cols));
+                airlight = mean > airlight ? mean : airlight;
+                dark_sum += block_min[bx];
+            }
+            patches += blocks_x;
+        }
+    }
+
+    uint32_t pixels = (uint32_t)width * height;
+    uint32_t mean = sum / pixels;
+    // Variance = E[x^2] - E[x]^2, in pixel units squared
+    uint64_t mean_sq = ((uint64_t)sum * sum) / pixels;
+    uint32_t variance = (uint32_t)((sum_sq - mean_sq) / pixels);
+    uint32_t stddev = 0;
+    while ((stddev + 1) * (stddev + 1) <= variance)
+    {
+        stddev++;
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->mean = (uint8_t)mean;
+    result->contrast_permille = (uint16_t)(mean > 0 ? stddev * 1000 / mean : 0);
+    result->edge_permille = (uint16_t)(edges * 1000 / ((uint32_t)(width - 2) * (height - 2)));
+    result->dark_channel = (uint8_t)(dark_sum / patches);
+    result->airlight = airlight;
+    result->transmission_percent =
+        airlight > 0 && result->dark_channel < airlight
+            ? (uint8_t)(100 - (uint32_t)result->dark_channel * 100 / airlight)
+            : 0;
+
+    uint32_t index = WEIGHT_TRANSMISSION * result->transmission_percent +
+                     WEIGHT_CONTRAST * score(result->contrast_permille, CLEAR_CONTRAST_PERMILLE) +
+                     WEIGHT_EDGES * score(result->edge_permille, CLEAR_EDGE_PERMILLE);
+    result->index = (uint8_t)(index / 100);
+
+    return true;
+}
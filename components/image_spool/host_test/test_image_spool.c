@@ -0,0 +1,198 @@
+/**
+ * @file test_image_spool.c
+ * @brief Image spool mounted with a smaller image limit than its records were written with
+ *
+ * Time-lapse mode spools up to 200 KB per image, the capture pipeline mounts
+ * the same partition with its 96 KB ring slot size. Every boot runs in a
+ * forked child over the shared RAM partition (build with AddressSanitizer
+ * to catch drain buffer overruns).
+ * Usage: test_image_spool
+ */
+
+#include "host_port.h"
+#include "image_spool.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SECTORS 128 // 512 KB
+#define TIMELAPSE_MAX (200 * 1024)
+#define PIPELINE_MAX (96 * 1024)
+#define FLUSH_MS 5000
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                  \
+    do                                    \
+    {                                     \
+        if (!(cond))                      \
+        {                                 \
+            printf("FAIL: " __VA_ARGS__); \
+            printf("\n");                 \
+            failures++;                   \
+        }                                 \
+    } while (0)
+
+// ============================================================================
+// Spool Callbacks
+// ============================================================================
+
+#define SENT_MAX 8
+
+static pthread_mutex_t sent_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t sent_len[SENT_MAX];
+static int sent_count = 0;
+
+static void fill_image(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        buf[i] = (uint8_t)(i * 7 + len);
+    }
+}
+
+static esp_err_t test_send(const uint8_t *data, size_t len, const image_spool_meta_t *meta, void *ctx)
+{
+    bool intact = true;
+    for (size_t i = 0; i < len && intact; i++)
+    {
+        intact = data[i] == (uint8_t)(i * 7 + len);
+    }
+    CHECK(intact, "image of %u bytes drained with wrong content", (unsigned int)len);
+
+    pthread_mutex_lock(&sent_lock);
+    if (sent_count < SENT_MAX)
+    {
+        sent_len[sent_count++] = len;
+    }
+    pthread_mutex_unlock(&sent_lock);
+    return ESP_OK;
+}
+
+static bool test_ready(void *ctx)
+{
+    return true;
+}
+
+static bool test_offline(void *ctx)
+{
+    return false;
+}
+
+static void start_spool(size_t max_image_size, image_spool_ready_cb_t ready)
+{
+    const image_spool_config_t cfg = {
+        .max_image_size = max_image_size,
+        .send = test_send,
+        .ready = ready,
+    };
+    esp_err_t err = image_spool_start(&cfg);
+    CHECK(err == ESP_OK, "image_spool_start: %d", err);
+}
+
+static image_spool_stats_t spool_stats(void)
+{
+    image_spool_stats_t st;
+    image_spool_get_stats(&st);
+    return st;
+}
+
+// Drain everything and check the image sizes that came out, in order
+static void drain_expect(const size_t *lens, int count)
+{
+    CHECK(image_spool_flush(FLUSH_MS) == ESP_OK, "spool not drained");
+    pthread_mutex_lock(&sent_lock);
+    CHECK(sent_count == count, "%d images drained, expected %d", sent_count, count);
+    for (int i = 0; i < count && i < sent_count; i++)
+    {
+        CHECK(sent_len[i] == lens[i], "image %d: %u bytes, expected %u", i, (unsigned int)sent_len[i],
+              (unsigned int)lens[i]);
+    }
+    pthread_mutex_unlock(&sent_lock);
+}
+
+// ============================================================================
+// Boots
+// ============================================================================
+
+static void boot(const char *name, void (*fn)(void))
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        fn();
+        fflush(stdout);
+        _exit(failures ? 1 : 0);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        printf("FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+// Time-lapse mode leaves a small, a large and another small image behind
+static void timelapse_writes(void)
+{
+    start_spool(TIMELAPSE_MAX, test_offline); // Nothing drains before the power goes
+
+    static uint8_t image[TIMELAPSE_MAX];
+    const size_t lens[] = {10 * 1024, 150 * 1024, 20 * 1024};
+    for (int i = 0; i < 3; i++)
+    {
+        fill_image(image, lens[i]);
+        CHECK(image_spool_write(image, lens[i], NULL, NULL, 0) == ESP_OK, "write %d failed", i);
+    }
+    host_power_loss();
+}
+
+// The pipeline mounts with 96 KB: the 150 KB record must not reach drain_buf
+static void pipeline_mount(void)
+{
+    start_spool(PIPELINE_MAX, test_ready);
+    image_spool_stats_t st = spool_stats();
+    CHECK(st.pending == 2 && st.dropped == 1, "pipeline: %u pending, %u dropped", (unsigned int)st.pending,
+          (unsigned int)st.dropped);
+
+    const size_t lens[] = {10 * 1024, 20 * 1024};
+    drain_expect(lens, 2);
+    CHECK(spool_stats().corrupt == 0, "pipeline: records counted as corrupt");
+    host_power_loss();
+}
+
+// Skipped, not released: time-lapse mode still finds the large image
+static void timelapse_mount(void)
+{
+    start_spool(TIMELAPSE_MAX, test_ready);
+    image_spool_stats_t st = spool_stats();
+    CHECK(st.pending == 1 && st.dropped == 0, "time-lapse: %u pending, %u dropped", (unsigned int)st.pending,
+          (unsigned int)st.dropped);
+
+    const size_t lens[] = {150 * 1024};
+    drain_expect(lens, 1);
+    host_power_loss();
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void)
+{
+    host_flash_init(IMAGE_SPOOL_PARTITION, SECTORS);
+
+    printf("oversized records from another mode\n");
+    boot("time-lapse writes", timelapse_writes);
+    boot("pipeline mount", pipeline_mount);
+    boot("time-lapse mount", timelapse_mount);
+
+    printf("%s (%u flash writes)\n", failures ? "FAILED" : "passed", (unsigned int)host_flash_writes());
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,800 @@
+/**
+ * @file image_spool.c
+ * @brief Offline Image Spool Implementation
+ *
+ * Circular log on the raw partition. Every record starts on a 4 KB sector:
+ *
+ *   [52-byte header][caller context][JPEG data][pad to sector]
+ *
+ * The header carries a format version. Records of another version (or the
+ * unversioned layout before it, which used a different magic) are ignored.
+ *
+ * The writer erases exactly the sectors a record needs, writes the image in
+ * one call and commits the header last. Records are released by clearing
+ * the header's pending byte (a 1->0 bit write, no erase). Because images
+ * are written and drained strictly in order, the region just ahead of the
+ * write position always holds the oldest records, which are evicted when
+ * the log wraps onto them. The RAM index is rebuilt by a header scan at
+ * mount, unless the mount state survived in RTC memory (deep-sleep wake):
+ * then the spool can take writes at once and the index is only rebuilt,
+ * by walking the pending records, when something needs it.
+ *
+ * Time-lapse and pipeline modes share the partition with different image
+ * limits. Records larger than this mount's max_image_size are left on
+ * flash, unindexed, and counted as dropped: they do not fit drain_buf.
+ */
+
+#include "image_spool.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "IMAGE_SPOOL";
+
+#define SPOOL_SECTOR 4096
+#define SPOOL_MAGIC 0x4C4F5053 // "SPOL"
+#define SPOOL_VERSION 1
+#define SPOOL_PENDING 0xFF
+#define SPOOL_RELEASED 0x00
+#define DRAIN_IDLE_MS 1000
+#define DRAIN_RETRY_MS 2000
+#define FLUSH_POLL_MS 100
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint8_t version;                    // SPOOL_VERSION
+    uint8_t reserved;
+    uint16_t context_len;               // Caller context bytes before the image
+    uint32_t seq;
+    uint32_t len;                       // Image bytes
+    uint32_t crc;                       // CRC32 of context and image
+    uint8_t meta[IMAGE_SPOOL_META_SIZE];
+    uint8_t check;                      // Byte sum of the fields above
+    uint8_t pending;                    // SPOOL_PENDING until released
+} spool_header_t;
+
+_Static_assert(sizeof(spool_header_t) == 52, "spool header must be 52 bytes");
+
+typedef struct {
+    uint32_t offset;
+    uint32_t len;
+    uint32_t seq;
+    uint16_t context_len;
+} spool_rec_t;
+
+static const esp_partition_t *partition = NULL;
+static image_spool_config_t spool_config;
+static SemaphoreHandle_t spool_mutex = NULL;
+static TaskHandle_t drain_handle = NULL;
+static uint8_t *drain_buf = NULL;     // Context and image of the record being drained
+static uint8_t *context_buf = NULL;   // Contexts of a batch, IMAGE_SPOOL_CONTEXT_MAX each
+
+// Pending records, oldest first (ring of index_cap entries)
+static spool_rec_t *index_buf = NULL;
+static uint32_t index_cap = 0;
+static uint32_t index_head = 0;
+static uint32_t index_count = 0;
+
+static uint32_t write_pos = 0;
+static uint32_t next_seq = 1;
+static uint32_t head_offset = 0;  // Oldest pending record (valid while index_count > 0)
+static bool index_ready = false;  // index_buf holds the pending records
+
+// Mount state kept across deep sleep; invalid while a flash update is in progress
+#define SPOOL_RTC_MAGIC 0x31505352 // "RSP1"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t partition_size;
+    uint32_t write_pos;
+    uint32_t next_seq;
+    uint32_t head_offset;
+    uint32_t count;
+    uint32_t pending_bytes;
+    uint32_t check;
+} spool_rtc_t;
+
+static RTC_NOINIT_ATTR spool_rtc_t spool_rtc;
+
+static image_spool_stats_t stats = {0};
+static uint64_t write_bytes_total = 0;
+static uint64_t write_us_total = 0;
+static uint64_t drain_bytes_total = 0;
+static uint64_t drain_us_total = 0;
+
+// ============================================================================
+// Record Helpers (call with spool_mutex held)
+// ============================================================================
+
+// Flash footprint of a record with payload (context + image) bytes
+static uint32_t record_size(uint32_t payload)
+{
+    return (sizeof(spool_header_t) + payload + SPOOL_SECTOR - 1) / SPOOL_SECTOR * SPOOL_SECTOR;
+}
+
+static uint32_t rec_size(const spool_rec_t *rec)
+{
+    return record_size(rec->context_len + rec->len);
+}
+
+static uint8_t header_check(const spool_header_t *hdr)
+{
+    const uint8_t *p = (const uint8_t *)hdr;
+    uint8_t sum = 0;
+    for (size_t i = 0; i < offsetof(spool_header_t, check); i++)
+    {
+        sum += p[i];
+    }
+    return sum;
+}
+
+static bool header_valid(const spool_header_t *hdr, uint32_t offset)
+{
+    return hdr->magic == SPOOL_MAGIC && hdr->version == SPOOL_VERSION && hdr->check == header_check(hdr) &&
+           hdr->len > 0 && hdr->context_len <= IMAGE_SPOOL_CONTEXT_MAX &&
+           offset + record_size(hdr->context_len + hdr->len) <= partition->size;
+}
+
+// Whether this mount can load the record into drain_buf
+static bool record_fits(const spool_header_t *hdr)
+{
+    return hdr->len <= spool_config.max_image_size;
+}
+
+static spool_rec_t *index_at(uint32_t i)
+{
+    return &index_buf[(index_head + i) % index_cap];
+}
+
+static void index_push(const spool_rec_t *rec)
+{
+    if (index_count == 0)
+    {
+        head_offset = rec->offset;
+    }
+    *index_at(index_count) = *rec;
+    index_count++;
+    stats.pending_bytes += rec_size(rec);
+}
+
+// Release the oldest record on flash and drop it from the index
+static void index_pop(void)
+{
+    spool_rec_t *rec = index_at(0);
+    uint8_t released = SPOOL_RELEASED;
+    esp_partition_write(partition, rec->offset + offsetof(spool_header_t, pending), &released, 1);
+
+    stats.pending_bytes -= rec_size(rec);
+    index_head = (index_head + 1) % index_cap;
+    index_count--;
+    head_offset = index_count > 0 ? index_at(0)->offset : write_pos;
+}
+
+static bool overlaps(const spool_rec_t *rec, uint32_t start, uint32_t size)
+{
+    uint32_t rec_end = rec->offset + rec_size(rec);
+    return rec->offset < start + size && start < rec_end;
+}
+
+// ============================================================================
+// RTC Mount State (call with spool_mutex held)
+// ============================================================================
+
+static uint32_t rtc_check(const spool_rtc_t *rtc)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)rtc, offsetof(spool_rtc_t, check));
+}
+
+static void rtc_invalidate(void)
+{
+    spool_rtc.magic = 0;
+}
+
+static void rtc_save(void)
+{
+    spool_rtc.partition_size = partition->size;
+    spool_rtc.write_pos = write_pos;
+    spool_rtc.next_seq = next_seq;
+    spool_rtc.head_offset = head_offset;
+    spool_rtc.count = index_count;
+    spool_rtc.pending_bytes = stats.pending_bytes;
+    spool_rtc.magic = SPOOL_RTC_MAGIC;
+    spool_rtc.check = rtc_check(&spool_rtc);
+}
+
+static bool rtc_restore(void)
+{
+    if (spool_rtc.magic != SPOOL_RTC_MAGIC || spool_rtc.check != rtc_check(&spool_rtc) ||
+        spool_rtc.partition_size != partition->size)
+    {
+        return false;
+    }
+
+    write_pos = spool_rtc.write_pos;
+    next_seq = spool_rtc.next_seq;
+    head_offset = spool_rtc.head_offset;
+    index_head = 0;
+    index_count = spool_rtc.count;
+    stats.pending_bytes = spool_rtc.pending_bytes;
+    index_ready = index_count == 0;
+    return true;
+}
+
+// ============================================================================
+// Mount
+// ============================================================================
+
+static int compare_seq(const void *a, const void *b)
+{
+    int32_t d = (int32_t)(((const spool_rec_t *)a)->seq - ((const spool_rec_t *)b)->seq);
+    return (d > 0) - (d < 0);
+}
+
+static void spool_scan(void)
+{
+    spool_header_t hdr;
+    uint32_t newest_seq = 0;
+    uint32_t newest_end = 0;
+    bool found = false;
+
+    index_head = 0;
+    index_count = 0;
+    stats.pending_bytes = 0;
+
+    for (uint32_t offset = 0; offset + SPOOL_SECTOR <= partition->size;)
+    {
+        if (esp_partition_read(partition, offset, &hdr, sizeof(hdr)) != ESP_OK || !header_valid(&hdr, offset))
+        {
+            offset += SPOOL_SECTOR;
+            continue;
+        }
+
+        uint32_t size = record_size(hdr.context_len + hdr.len);
+        if (!found || (int32_t)(hdr.seq - newest_seq) > 0)
+        {
+            newest_seq = hdr.seq;
+            newest_end = offset + size;
+            found = true;
+        }
+        if (hdr.pending == SPOOL_PENDING && !record_fits(&hdr))
+        {
+            ESP_LOGW(TAG, "Record %lu (%lu bytes) exceeds max_image_size, skipped", hdr.seq, hdr.len);
+            stats.dropped++;
+        }
+        else if (hdr.pending == SPOOL_PENDING)
+        {
+            spool_rec_t rec = {.offset = offset, .len = hdr.len, .seq = hdr.seq, .context_len = hdr.context_len};
+            index_push(&rec);
+        }
+        offset += size;
+    }
+
+    // Scan order is flash order; the FIFO wants sequence order
+    qsort(index_buf, index_count, sizeof(spool_rec_t), compare_seq);
+
+    write_pos = (found && newest_end < partition->size) ? newest_end : 0;
+    next_seq = found ? newest_seq + 1 : 1;
+    head_offset = index_count > 0 ? index_at(0)->offset : write_pos;
+    index_ready = true;
+}
+
+// Rebuild the index from the RTC state: pending records follow each other
+// from head_offset with consecutive sequence numbers, wrapping to offset 0
+static bool spool_walk(void)
+{
+    spool_header_t hdr;
+    uint32_t count = index_count;
+    uint32_t seq = next_seq - count;
+    uint32_t offset = head_offset;
+
+    index_head = 0;
+    index_count = 0;
+    stats.pending_bytes = 0;
+
+    while (index_count < count)
+    {
+        bool found = false;
+        for (int attempt = 0; attempt < 2 && !found; attempt++)
+        {
+            found = offset + SPOOL_SECTOR <= partition->size &&
+                    esp_partition_read(partition, offset, &hdr, sizeof(hdr)) == ESP_OK &&
+                    header_valid(&hdr, offset) && hdr.seq == seq && hdr.pending == SPOOL_PENDING &&
+                    record_fits(&hdr); // Otherwise the scan skips it
+            if (!found)
+            {
+                if (offset == 0)
+                {
+                    return false;
+                }
+                offset = 0; // The writer wrapped here
+            }
+        }
+        if (!found)
+        {
+            return false;
+        }
+
+        spool_rec_t rec = {.offset = offset, .len = hdr.len, .seq = hdr.seq, .context_len = hdr.context_len};
+        index_push(&rec);
+        offset += rec_size(&rec);
+        seq++;
+    }
+    index_ready = true;
+    return true;
+}
+
+static void index_ensure(void)
+{
+    if (index_ready)
+    {
+        return;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    uint32_t count = index_count;
+    if (!spool_walk())
+    {
+        ESP_LOGW(TAG, "RTC spool state inconsistent, rescanning");
+        spool_scan();
+    }
+    rtc_save();
+    ESP_LOGI(TAG, "Index rebuilt: %lu/%lu records in %lld ms", index_count, count,
+             (esp_timer_get_time() - start_us) / 1000);
+}
+
+// Whether writing size bytes at write_pos may overwrite pending records
+static bool write_may_evict(uint32_t size)
+{
+    if (index_count == 0)
+    {
+        return false;
+    }
+    if (write_pos + size > partition->size)
+    {
+        return true;
+    }
+    return head_offset >= write_pos && head_offset < write_pos + size;
+}
+
+// ============================================================================
+// Drain Task
+// ============================================================================
+
+// Load a record (context, then image) into drain_buf and check it; a
+// corrupt record at the head is dropped. Returns false if it is unusable.
+static bool record_load(const spool_rec_t *rec, spool_header_t *hdr)
+{
+    uint32_t payload = rec->context_len + rec->len;
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    esp_err_t err = esp_partition_read(partition, rec->offset, hdr, sizeof(*hdr));
+    if (err == ESP_OK && (rec->len > spool_config.max_image_size || rec->context_len > IMAGE_SPOOL_CONTEXT_MAX))
+    {
+        err = ESP_ERR_INVALID_SIZE; // Never read past drain_buf
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_partition_read(partition, rec->offset + sizeof(*hdr), drain_buf, payload);
+    }
+    bool intact = err == ESP_OK && hdr->seq == rec->seq &&
+                  esp_rom_crc32_le(0, drain_buf, payload) == hdr->crc;
+    if (!intact && index_count > 0 && index_at(0)->seq == rec->seq)
+    {
+        ESP_LOGW(TAG, "Record %lu corrupt, dropped", rec->seq);
+        stats.corrupt++;
+        rtc_invalidate();
+        index_pop();
+        rtc_save();
+    }
+    xSemaphoreGive(spool_mutex);
+    return intact;
+}
+
+// Release delivered records that are still at the head
+static void records_done(const spool_rec_t *recs, uint8_t count, int64_t start_us)
+{
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    rtc_invalidate();
+    for (uint8_t i = 0; i < count; i++)
+    {
+        // The writer may have evicted some while they were being sent
+        if (index_count > 0 && index_at(0)->seq == recs[i].seq)
+        {
+            index_pop();
+        }
+        stats.drained++;
+        drain_bytes_total += recs[i].len;
+    }
+    drain_us_total += esp_timer_get_time() - start_us;
+    rtc_save();
+    xSemaphoreGive(spool_mutex);
+}
+
+static esp_err_t drain_one(void)
+{
+    spool_header_t hdr;
+    int64_t start_us = esp_timer_get_time();
+
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    spool_rec_t rec = *index_at(0);
+    xSemaphoreGive(spool_mutex);
+
+    if (!record_load(&rec, &hdr))
+    {
+        return ESP_OK; // Dropped, carry on with the next one
+    }
+
+    image_spool_meta_t meta = {
+        .seq = rec.seq,
+        .context = rec.context_len ? drain_buf : NULL,
+        .context_len = rec.context_len,
+    };
+    memcpy(meta.meta, hdr.meta, sizeof(meta.meta));
+    esp_err_t err = spool_config.send(drain_buf + rec.context_len, rec.len, &meta, spool_config.ctx);
+    if (err == ESP_OK)
+    {
+        records_done(&rec, 1, start_us);
+    }
+    return err;
+}
+
+// Verify the oldest records, then let the callback stream them in one request
+static esp_err_t drain_batch(void)
+{
+    spool_header_t hdr;
+    spool_rec_t recs[IMAGE_SPOOL_BATCH_MAX];
+    image_spool_meta_t meta[IMAGE_SPOOL_BATCH_MAX];
+    size_t lens[IMAGE_SPOOL_BATCH_MAX];
+    int64_t start_us = esp_timer_get_time();
+
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    uint8_t count = index_count < spool_config.batch_max ? index_count : spool_config.batch_max;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        recs[i] = *index_at(i);
+    }
+    xSemaphoreGive(spool_mutex);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (!record_load(&recs[i], &hdr))
+        {
+            if (i == 0)
+            {
+                return ESP_OK; // Head dropped, build the batch again
+            }
+            count = i; // Send what precedes it; it reaches the head next time
+            break;
+        }
+        // drain_buf is reused for the next record: keep the context aside
+        uint8_t *context = context_buf + i * IMAGE_SPOOL_CONTEXT_MAX;
+        memcpy(context, drain_buf, recs[i].context_len);
+        meta[i].seq = recs[i].seq;
+        meta[i].context = recs[i].context_len ? context : NULL;
+        meta[i].context_len = recs[i].context_len;
+        memcpy(meta[i].meta, hdr.meta, sizeof(meta[i].meta));
+        lens[i] = recs[i].len;
+    }
+
+    esp_err_t err = spool_config.send_batch(meta, lens, count, spool_config.ctx);
+    if (err == ESP_OK)
+    {
+        records_done(recs, count, start_us);
+    }
+    return err;
+}
+
+static void drain_task(void *pvParameters)
+{
+    bool batch = spool_config.send_batch && spool_config.batch_max > 1;
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DRAIN_IDLE_MS));
+
+        while (index_count > 0 && spool_config.ready(spool_config.ctx))
+        {
+            xSemaphoreTake(spool_mutex, portMAX_DELAY);
+            index_ensure();
+            xSemaphoreGive(spool_mutex);
+
+            if ((batch ? drain_batch() : drain_one()) != ESP_OK)
+            {
+                vTaskDelay(pdMS_TO_TICKS(DRAIN_RETRY_MS));
+                break;
+            }
+        }
+    }
+}
+
+// Undo a partial image_spool_start()
+static void spool_release(void)
+{
+    heap_caps_free(index_buf);
+    heap_caps_free(drain_buf);
+    heap_caps_free(context_buf);
+    index_buf = NULL;
+    drain_buf = NULL;
+    context_buf = NULL;
+    if (spool_mutex)
+    {
+        vSemaphoreDelete(spool_mutex);
+        spool_mutex = NULL;
+    }
+    partition = NULL;
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t image_spool_start(const image_spool_config_t *config)
+{
+    if (!config || !config->send || !config->ready || config->max_image_size == 0 ||
+        config->batch_max > IMAGE_SPOOL_BATCH_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (partition)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY, IMAGE_SPOOL_PARTITION);
+    if (!part)
+    {
+        ESP_LOGE(TAG, "Partition '%s' not found", IMAGE_SPOOL_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (record_size(IMAGE_SPOOL_CONTEXT_MAX + config->max_image_size) > part->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    spool_config = *config;
+    index_cap = part->size / SPOOL_SECTOR;
+    index_buf = heap_caps_malloc(index_cap * sizeof(spool_rec_t), MALLOC_CAP_SPIRAM);
+    drain_buf = heap_caps_malloc(IMAGE_SPOOL_CONTEXT_MAX + config->max_image_size, MALLOC_CAP_SPIRAM);
+    bool batch = config->send_batch && config->batch_max > 1;
+    if (batch)
+    {
+        context_buf = heap_caps_malloc(config->batch_max * IMAGE_SPOOL_CONTEXT_MAX, MALLOC_CAP_SPIRAM);
+    }
+    spool_mutex = xSemaphoreCreateMutex();
+    if (!index_buf || !drain_buf || (batch && !context_buf) || !spool_mutex)
+    {
+        ESP_LOGE(TAG, "Failed to allocate spool buffers");
+        spool_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    partition = part;
+    stats.capacity_bytes = part->size;
+
+    int64_t scan_start_us = esp_timer_get_time();
+    stats.mount_fast = rtc_restore();
+    if (!stats.mount_fast)
+    {
+        spool_scan();
+        rtc_save();
+    }
+    stats.mount_ms = (uint32_t)((esp_timer_get_time() - scan_start_us) / 1000);
+    ESP_LOGI(TAG, "Mounted %lu KB at 0x%lx: %lu images pending (%lu KB), %s %lu ms",
+             part->size / 1024, part->address, index_count, stats.pending_bytes / 1024,
+             stats.mount_fast ? "RTC state" : "scan", stats.mount_ms);
+
+    if (xTaskCreatePinnedToCore(drain_task, "spool_drain", 4096, NULL, 3, &drain_handle,
+                                config->drain_core) != pdPASS)
+    {
+        spool_release();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t image_spool_write(const uint8_t *data, size_t len, const uint8_t *meta,
+                            const void *context, size_t context_len)
+{
+    if (!data || len == 0 || len > spool_config.max_image_size ||
+        context_len > IMAGE_SPOOL_CONTEXT_MAX || (context_len && !context))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!partition)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    uint32_t size = record_size(context_len + len);
+
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+
+    if (write_may_evict(size))
+    {
+        index_ensure();
+    }
+    rtc_invalidate();
+
+    if (write_pos + size > partition->size)
+    {
+        // Wrap: everything left beyond the write position is from the
+        // previous lap, i.e. the oldest records
+        while (index_count > 0 && index_at(0)->offset >= write_pos)
+        {
+            index_pop();
+            stats.evicted++;
+        }
+        write_pos = 0;
+    }
+
+    // Without the index the head cannot overlap (write_may_evict said so)
+    while (index_ready && index_count > 0 && overlaps(index_at(0), write_pos, size))
+    {
+        index_pop();
+        stats.evicted++;
+    }
+
+    spool_header_t hdr = {
+        .magic = SPOOL_MAGIC,
+        .version = SPOOL_VERSION,
+        .reserved = 0xFF,
+        .context_len = (uint16_t)context_len,
+        .seq = next_seq,
+        .len = len,
+        .crc = esp_rom_crc32_le(esp_rom_crc32_le(0, context, context_len), data, len),
+        .pending = SPOOL_PENDING,
+    };
+    if (meta)
+    {
+        memcpy(hdr.meta, meta, sizeof(hdr.meta));
+    }
+    hdr.check = header_check(&hdr);
+
+    esp_err_t err = esp_partition_erase_range(partition, write_pos, size);
+    if (err == ESP_OK && context_len)
+    {
+        err = esp_partition_write(partition, write_pos + sizeof(hdr), context, context_len);
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_partition_write(partition, write_pos + sizeof(hdr) + context_len, data, len);
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_partition_write(partition, write_pos, &hdr, sizeof(hdr)); // Commit
+    }
+
+    if (err == ESP_OK)
+    {
+        spool_rec_t rec = {.offset = write_pos, .len = len, .seq = next_seq, .context_len = (uint16_t)context_len};
+        index_push(&rec);
+        next_seq++;
+        stats.written++;
+        write_bytes_total += len;
+        write_us_total += esp_timer_get_time() - start_us;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Flash write failed: %s", esp_err_to_name(err));
+    }
+
+    // Skip the damaged area on failure too
+    write_pos += size;
+    if (write_pos >= partition->size)
+    {
+        write_pos = 0;
+    }
+    if (index_count == 0)
+    {
+        head_offset = write_pos;
+    }
+
+    // After a failed write the next mount scans instead of trusting the gap
+    if (err == ESP_OK)
+    {
+        rtc_save();
+    }
+
+    xSemaphoreGive(spool_mutex);
+    return err;
+}
+
+esp_err_t image_spool_read(uint32_t seq, size_t offset, uint8_t *buf, size_t len)
+{
+    if (!buf)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!partition)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    index_ensure();
+    // Callers read records near the head, so this ends after a few steps
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        const spool_rec_t *rec = index_at(i);
+        if (rec->seq == seq)
+        {
+            err = (offset + len <= rec->len)
+                      ? esp_partition_read(partition,
+                                           rec->offset + sizeof(spool_header_t) + rec->context_len + offset, buf, len)
+                      : ESP_ERR_INVALID_SIZE;
+            break;
+        }
+    }
+    xSemaphoreGive(spool_mutex);
+    return err;
+}
+
+void image_spool_kick(void)
+{
+    if (drain_handle)
+    {
+        xTaskNotifyGive(drain_handle);
+    }
+}
+
+esp_err_t image_spool_flush(uint32_t timeout_ms)
+{
+    if (!partition)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (index_count > 0)
+    {
+        if (esp_timer_get_time() >= deadline_us)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+        image_spool_kick();
+        vTaskDelay(pdMS_TO_TICKS(FLUSH_POLL_MS));
+    }
+    return ESP_OK;
+}
+
+esp_err_t image_spool_get_stats(image_spool_stats_t *out)
+{
+    if (!out)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!partition)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    *out = stats;
+    out->pending = index_count;
+    out->fill_percent = (uint8_t)((uint64_t)stats.pending_bytes * 100 / stats.capacity_bytes);
+    if (write_us_total > 0)
+    {
+        out->write_bps = (uint32_t)(write_bytes_total * 1000000 / write_us_total);
+    }
+    if (drain_us_total > 0)
+    {
+        out->drain_bps = (uint32_t)(drain_bytes_total * 1000000 / drain_us_total);
+    }
+    xSemaphoreGive(spool_mutex);
+
+    return ESP_OK;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file image_spool.h
+ * @brief Offline Image Spool on the Raw Flash Storage Partition
+ */
+
+#ifndef IMAGE_SPOOL_H
+#define IMAGE_SPOOL_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMAGE_SPOOL_PARTITION "storage"
+#define IMAGE_SPOOL_META_SIZE 30     // Opaque caller bytes stored with each image
+#define IMAGE_SPOOL_CONTEXT_MAX 512  // Largest caller context stored with an image
+#define IMAGE_SPOOL_BATCH_MAX 8      // Most images handed to one send_batch call
+#define IMAGE_SPOOL_KIND_TIMELAPSE 0xA5 // meta[0] of time-lapse records; pipeline records start with a cam_product_t
+
+/**
+ * @brief Metadata returned with a drained image
+ */
+typedef struct {
+    uint32_t seq;                    // Spool sequence number (FIFO order)
+    uint8_t meta[IMAGE_SPOOL_META_SIZE]; // Caller bytes passed to image_spool_write()
+    const uint8_t *context;          // Caller context passed to image_spool_write() (NULL = none);
+                                     // valid during the callback only
+    uint16_t context_len;
+} image_spool_meta_t;
+
+/**
+ * @brief Drain callback: send one spooled image
+ * @return ESP_OK once delivered; the record is then released
+ */
+typedef esp_err_t (*image_spool_send_cb_t)(const uint8_t *data, size_t len,
+                                           const image_spool_meta_t *meta, void *ctx);
+
+/**
+ * @brief Batch drain callback: send the oldest count images in one go
+ *
+ * Image data is not loaded; the callback streams it with image_spool_read().
+ *
+ * @return ESP_OK once all of them are delivered; the records are then released
+ */
+typedef esp_err_t (*image_spool_batch_cb_t)(const image_spool_meta_t *meta, const size_t *len,
+                                            uint8_t count, void *ctx);
+
+/**
+ * @brief Drain gate: return true while the drain task may send
+ */
+typedef bool (*image_spool_ready_cb_t)(void *ctx);
+
+/**
+ * @brief Spool configuration
+ */
+typedef struct {
+    size_t max_image_size;           // Largest image accepted (drain buffer size)
+    image_spool_send_cb_t send;      // Delivers drained images
+    image_spool_ready_cb_t ready;    // Link up and nothing more urgent to send
+    image_spool_batch_cb_t send_batch; // Optional: used instead of send when batch_max > 1
+    uint8_t batch_max;               // Images per send_batch call (<= IMAGE_SPOOL_BATCH_MAX)
+    void *ctx;                       // Passed to both callbacks
+    int drain_core;                  // Core for the drain task
+} image_spool_config_t;
+
+/**
+ * @brief Spool statistics
+ */
+typedef struct {
+    uint32_t pending;                // Images waiting in flash
+    uint32_t pending_bytes;          // Flash space they occupy (sector-rounded)
+    uint32_t capacity_bytes;         // Partition size
+    uint8_t fill_percent;            // pending_bytes / capacity
+    uint32_t written;                // Images spooled
+    uint32_t evicted;                // Oldest images overwritten because the spool was full
+    uint32_t drained;                // Images delivered from the spool
+    uint32_t corrupt;                // Records dropped on CRC mismatch
+    uint32_t dropped;                // Records over max_image_size (another mode's), skipped at mount
+    uint32_t write_bps;              // Average write throughput including erase (bytes/s)
+    uint32_t drain_bps;              // Average drain rate: read + send (bytes/s)
+    uint32_t mount_ms;               // Time image_spool_start() spent restoring the index
+    bool mount_fast;                 // Mounted from RTC state (deep-sleep wake) without a scan
+} image_spool_stats_t;
+
+/**
+ * @brief Mount the spool and start the drain task
+ *
+ * Scans the partition for records left from before a reset and resumes
+ * with them queued oldest-first. After a deep-sleep wake the mount state
+ * kept in RTC memory is used instead, and the index is rebuilt by walking
+ * the pending records only when the drain or an eviction needs it.
+ *
+ * @param config Spool configuration
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the partition is missing
+ */
+esp_err_t image_spool_start(const image_spool_config_t *config);
+
+/**
+ * @brief Append an image to the spool, evicting the oldest images if full
+ *
+ * Each record starts on a flash sector boundary: the sectors are erased,
+ * the image is written in one large write and the header goes last, so a
+ * record interrupted by a reset is ignored on the next mount.
+ *
+ * @param data JPEG data
+ * @param len JPEG size (<= max_image_size)
+ * @param meta IMAGE_SPOOL_META_SIZE caller bytes, or NULL
+ * @param context Variable-length caller bytes kept with the image, e.g. the
+ *                readings at capture time (NULL if context_len is 0)
+ * @param context_len Context size (<= IMAGE_SPOOL_CONTEXT_MAX)
+ * @return ESP_OK on success
+ */
+esp_err_t image_spool_write(const uint8_t *data, size_t len, const uint8_t *meta,
+                            const void *context, size_t context_len);
+
+/**
+ * @brief Read part of a pending image (for send_batch callbacks)
+ * @param seq Sequence number from image_spool_meta_t
+ * @param offset Byte offset into the image
+ * @param buf Destination
+ * @param len Bytes to read
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the image was evicted meanwhile
+ */
+esp_err_t image_spool_read(uint32_t seq, size_t offset, uint8_t *buf, size_t len);
+
+/**
+ * @brief Wake the drain task (e.g. when the link comes back)
+ */
+void image_spool_kick(void);
+
+/**
+ * @brief Kick the drain task and wait until the spool is empty
+ * @param timeout_ms Maximum wait
+ * @return ESP_OK once nothing is pending, ESP_ERR_TIMEOUT otherwise
+ */
+esp_err_t image_spool_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Get spool statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t image_spool_get_stats(image_spool_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMAGE_SPOOL_H
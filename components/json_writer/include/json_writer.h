@@ -0,0 +1,76 @@
+/**
+ * @file json_writer.h
+ * @brief Streaming JSON Writer
+ *
+ * Appends values to a caller-provided buffer: no heap, no printf. Floats
+ * are written in fixed point with a given number of decimals, which is all
+ * telemetry needs and avoids newlib's float formatting. Every write is
+ * bounds-checked; after an overflow further writes are ignored and
+ * json_writer_finish() returns 0.
+ *
+ * Values take a key inside objects and NULL inside arrays. Members written
+ * without an enclosing object_begin form a brace-less member list, as the
+ * manifest and snapshot callbacks expect.
+ *
+ * Plain C without ESP-IDF dependencies.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_WRITER_MAX_DECIMALS 9
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+    bool first; // Next value opens its object/array (no comma)
+} json_writer_t;
+
+/**
+ * @brief Start writing into buf
+ * @param w Writer
+ * @param buf Destination (always NUL-terminated once size > 0)
+ * @param size Destination size
+ */
+void json_writer_init(json_writer_t *w, char *buf, size_t size);
+
+void json_writer_object_begin(json_writer_t *w, const char *key);
+void json_writer_object_end(json_writer_t *w);
+void json_writer_array_begin(json_writer_t *w, const char *key);
+void json_writer_array_end(json_writer_t *w);
+
+void json_writer_string(json_writer_t *w, const char *key, const char *value);
+void json_writer_int(json_writer_t *w, const char *key, int64_t value);
+void json_writer_bool(json_writer_t *w, const char *key, bool value);
+
+/**
+ * @brief Write a number with a fixed number of decimals, like "%.*f"
+ *
+ * Rounds to nearest, exact ties to even. NaN, infinities and values beyond
+ * ~1e18 after scaling are written as null.
+ *
+ * @param decimals 0 to JSON_WRITER_MAX_DECIMALS
+ */
+void json_writer_fixed(json_writer_t *w, const char *key, double value, uint8_t decimals);
+
+/**
+ * @brief Finish writing
+ * @return Characters written (excluding the terminator), 0 after an overflow
+ */
+size_t json_writer_finish(json_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JSON_WRITER_H
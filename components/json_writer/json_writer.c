@@ -0,0 +1,236 @@
+/**
+ * @file json_writer.c
+ * @brief Streaming JSON Writer
+ */
+
+#include "json_writer.h"
+#include <string.h>
+
+#define FIXED_LIMIT 1e18 // Scaled values must fit a uint64_t with room to round
+
+static const uint64_t pow10_table[JSON_WRITER_MAX_DECIMALS + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+// ============================================================================
+// Output
+// ============================================================================
+
+// Keeps one byte for the terminator
+static void put(json_writer_t *w, const char *data, size_t len)
+{
+    if (w->overflow || w->len + len >= w->size)
+    {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void put_char(json_writer_t *w, char c)
+{
+    put(w, &c, 1);
+}
+
+static void put_escaped(json_writer_t *w, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *run = s;
+
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+        put(w, run, s - run);
+        char esc[6] = {'\\', (char)c};
+        size_t n = 2;
+        if (c < 0x20)
+        {
+            memcpy(esc, "\\u00", 4);
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xF];
+            n = 6;
+        }
+        put(w, esc, n);
+        run = s + 1;
+    }
+    put(w, run, s - run);
+}
+
+// Decimal digits of value, zero-padded to at least min_digits
+static void put_uint(json_writer_t *w, uint64_t value, uint8_t min_digits)
+{
+    char digits[20];
+    int n = 0;
+
+    // 32-bit division where possible: 64-bit division is a library call on Xtensa
+    while (value > 0xFFFFFFFFu)
+    {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    uint32_t v = (uint32_t)value;
+    do
+    {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n < min_digits)
+    {
+        digits[n++] = '0';
+    }
+
+    char out[20];
+    for (int i = 0; i < n; i++)
+    {
+        out[i] = digits[n - 1 - i];
+    }
+    put(w, out, n);
+}
+
+// Comma and key ahead of every value
+static void begin_value(json_writer_t *w, const char *key)
+{
+    if (!w->first)
+    {
+        put_char(w, ',');
+    }
+    w->first = false;
+
+    if (key)
+    {
+        put_char(w, '"');
+        put_escaped(w, key);
+        put(w, "\":", 2);
+    }
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = size == 0;
+    w->first = true;
+    if (size > 0)
+    {
+        buf[0] = '\0';
+    }
+}
+
+void json_writer_object_begin(json_writer_t *w, const char *key)
+{
+    begin_value(w, key);
+    put_char(w, '{');
+    w->first = true;
+}
+
+void json_writer_object_end(json_writer_t *w)
+{
+    put_char(w, '}');
+    w->first = false;
+}
+
+void json_writer_array_begin(json_writer_t *w, const char *key)
+{
+    begin_value(w, key);
+    put_char(w, '[');
+    w->first = true;
+}
+
+void json_writer_array_end(json_writer_t *w)
+{
+    put_char(w, ']');
+    w->first = false;
+}
+
+void json_writer_string(json_writer_t *w, const char *key, const char *value)
+{
+    begin_value(w, key);
+    if (!value)
+    {
+        put(w, "null", 4);
+        return;
+    }
+    put_char(w, '"');
+    put_escaped(w, value);
+    put_char(w, '"');
+}
+
+void json_writer_int(json_writer_t *w, const char *key, int64_t value)
+{
+    begin_value(w, key);
+    if (value < 0)
+    {
+        put_char(w, '-');
+    }
+    put_uint(w, value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value, 1);
+}
+
+void json_writer_bool(json_writer_t *w, const char *key, bool value)
+{
+    begin_value(w, key);
+    put(w, value ? "true" : "false", value ? 4 : 5);
+}
+
+void json_writer_fixed(json_writer_t *w, const char *key, double value, uint8_t decimals)
+{
+    begin_value(w, key);
+    if (decimals > JSON_WRITER_MAX_DECIMALS)
+    {
+        decimals = JSON_WRITER_MAX_DECIMALS;
+    }
+
+    bool negative = value < 0;
+    double scaled = (negative ? -value : value) * pow10_table[decimals];
+    if (!(scaled < FIXED_LIMIT)) // Also catches NaN
+    {
+        put(w, "null", 4);
+        return;
+    }
+
+    uint64_t units = (uint64_t)(scaled + 0.5);
+    if (units & 1 && (double)units - scaled == 0.5)
+    {
+        units--; // Exact ties to even, as printf does
+    }
+    if (negative && units > 0) // No "-0.00"
+    {
+        put_char(w, '-');
+    }
+    uint64_t scale = pow10_table[decimals];
+    uint64_t whole, frac;
+    if (units <= 0xFFFFFFFFu) // Sensor values: stay in 32-bit division
+    {
+        whole = (uint32_t)units / (uint32_t)scale;
+        frac = (uint32_t)units % (uint32_t)scale;
+    }
+    else
+    {
+        whole = units / scale;
+        frac = units % scale;
+    }
+    put_uint(w, whole, 1);
+    if (decimals > 0)
+    {
+        put_char(w, '.');
+        put_uint(w, frac, decimals);
+    }
+}
+
+size_t json_writer_finish(json_writer_t *w)
+{
+    if (w->size > 0)
+    {
+        w->buf[w->overflow ? 0 : w->len] = '\0';
+    }
+    return w->overflow ? 0 : w->len;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file live_view.h
+ * @brief MJPEG Live-View Server (single capture, multi-client fan-out)
+ */
+
+#ifndef LIVE_VIEW_H
+#define LIVE_VIEW_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIVE_VIEW_MAX_CLIENTS 4
+
+/**
+ * @brief Per-client statistics
+ */
+typedef struct {
+    bool active;              // Slot in use
+    uint32_t frames_sent;     // Frames delivered to this client
+    uint32_t frames_skipped;  // Frames replaced before this client was ready for them
+    uint64_t bytes_sent;      // Bytes written to this client (part headers + JPEG)
+    uint32_t throughput_bps;  // bytes_sent per second since the client connected
+    float fps;                // Frames per second since the client connected
+} live_view_client_stats_t;
+
+/**
+ * @brief Live-view statistics
+ */
+typedef struct {
+    uint8_t clients;                 // Connected clients
+    uint32_t frames_published;       // Frames offered by the capture task
+    uint32_t frames_dropped;         // Frames not published: every pool buffer was still being sent
+    uint8_t pool_buffers;            // Frame buffers allocated (reused across frames)
+    uint32_t pool_bytes;             // PSRAM held by them
+    live_view_client_stats_t client[LIVE_VIEW_MAX_CLIENTS];
+} live_view_stats_t;
+
+/**
+ * @brief Start the HTTP server with the MJPEG endpoint at /stream
+ * @param port TCP port
+ * @return ESP_OK on success
+ */
+esp_err_t live_view_start(uint16_t port);
+
+/**
+ * @brief Check whether any client is watching
+ * @return true if at least one client is connected
+ */
+bool live_view_has_clients(void);
+
+/**
+ * @brief Offer a new JPEG frame to all connected clients
+ *
+ * The frame is copied once into a shared, reference-counted PSRAM buffer
+ * from a reused pool that every client streams from. Never blocks on clients: a client still
+ * sending an older frame simply skips to the newest one afterwards.
+ *
+ * @param jpeg JPEG data
+ * @param len JPEG size
+ */
+void live_view_publish(const uint8_t *jpeg, size_t len);
+
+/**
+ * @brief Get live-view statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t live_view_get_stats(live_view_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIVE_VIEW_H
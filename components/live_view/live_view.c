@@ -0,0 +1,363 @@
+/**
+ * @file live_view.c
+ * @brief MJPEG Live-View Server Implementation
+ *
+ * The capture task copies each frame once into a shared, reference-counted
+ * buffer. Each client runs its own small task (via an async httpd request)
+ * that takes a reference to the newest frame, streams it, drops the
+ * reference and waits for the next one. Nothing on the capture side ever
+ * waits for a client.
+ *
+ * Buffers come from a small pool and are reused once no client holds them:
+ * the current frame, one per client still sending an older frame, and the
+ * one being filled. A buffer only grows when a frame no longer fits.
+ */
+
+#include "live_view.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "LIVE_VIEW";
+
+#define CLIENT_TASK_STACK 4096
+#define FRAME_WAIT_MS 2000
+#define FRAME_POOL (LIVE_VIEW_MAX_CLIENTS + 2)
+#define FRAME_GROW 4096 // Capacity granularity; a new buffer also gets 25 % headroom
+
+#define PART_BOUNDARY "rainguardframe"
+static const char *STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
+static const char *STREAM_PART = "\r\n--" PART_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+
+typedef struct {
+    uint32_t refs;      // 0 = free for the next frame
+    uint32_t seq;
+    size_t len;
+    size_t capacity;
+    uint8_t data[];
+} live_frame_t;
+
+typedef struct {
+    bool active;
+    TaskHandle_t task;
+    httpd_req_t *req;
+    uint32_t frames_sent;
+    uint32_t frames_skipped;
+    uint64_t bytes_sent;
+    int64_t start_us;
+} live_client_t;
+
+static httpd_handle_t server = NULL;
+static SemaphoreHandle_t lv_mutex = NULL;
+static live_frame_t *current_frame = NULL;
+static live_frame_t *pool[FRAME_POOL];
+static live_client_t clients[LIVE_VIEW_MAX_CLIENTS];
+static uint8_t client_count = 0;
+static uint32_t frames_published = 0;
+static uint32_t frames_dropped = 0;
+
+// ============================================================================
+// Shared Frame (call with lv_mutex held)
+// ============================================================================
+
+static live_frame_t *frame_acquire(void)
+{
+    if (current_frame)
+    {
+        current_frame->refs++;
+    }
+    return current_frame;
+}
+
+static void frame_release(live_frame_t *frame)
+{
+    if (frame)
+    {
+        frame->refs--; // Back in the pool at 0
+    }
+}
+
+// Reserve a free pool buffer that holds len bytes, growing one if needed
+static live_frame_t *frame_reserve(size_t len)
+{
+    int grow = -1;
+    for (int i = 0; i < FRAME_POOL; i++)
+    {
+        if (pool[i] && pool[i]->refs == 0 && pool[i]->capacity >= len)
+        {
+            pool[i]->refs = 1;
+            return pool[i];
+        }
+        if ((!pool[i] || pool[i]->refs == 0) && grow < 0)
+        {
+            grow = i;
+        }
+    }
+    if (grow < 0)
+    {
+        return NULL; // Every buffer is still being sent
+    }
+
+    size_t capacity = (len + len / 4 + FRAME_GROW - 1) & ~(size_t)(FRAME_GROW - 1);
+    heap_caps_free(pool[grow]);
+    pool[grow] = heap_caps_malloc(sizeof(live_frame_t) + capacity, MALLOC_CAP_SPIRAM);
+    if (pool[grow])
+    {
+        pool[grow]->capacity = capacity;
+        pool[grow]->refs = 1;
+    }
+    return pool[grow];
+}
+
+// ============================================================================
+// Client Task
+// ============================================================================
+
+static void client_task(void *pvParameters)
+{
+    live_client_t *client = (live_client_t *)pvParameters;
+    httpd_req_t *req = client->req;
+    uint32_t last_seq = 0;
+    char part[96];
+
+    ESP_LOGI(TAG, "Client connected (%u watching)", client_count);
+
+    esp_err_t err = httpd_resp_set_type(req, STREAM_CONTENT_TYPE);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    while (err == ESP_OK)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FRAME_WAIT_MS));
+
+        xSemaphoreTake(lv_mutex, portMAX_DELAY);
+        live_frame_t *frame = frame_acquire();
+        xSemaphoreGive(lv_mutex);
+
+        if (!frame || frame->seq == last_seq)
+        {
+            xSemaphoreTake(lv_mutex, portMAX_DELAY);
+            frame_release(frame);
+            xSemaphoreGive(lv_mutex);
+            continue;
+        }
+
+        if (last_seq != 0 && frame->seq > last_seq + 1)
+        {
+            client->frames_skipped += frame->seq - last_seq - 1;
+        }
+        last_seq = frame->seq;
+
+        int n = snprintf(part, sizeof(part), STREAM_PART, (unsigned int)frame->len);
+        err = httpd_resp_send_chunk(req, part, n);
+        if (err == ESP_OK)
+        {
+            err = httpd_resp_send_chunk(req, (const char *)frame->data, frame->len);
+        }
+        if (err == ESP_OK)
+        {
+            client->frames_sent++;
+            client->bytes_sent += n + frame->len;
+        }
+
+        xSemaphoreTake(lv_mutex, portMAX_DELAY);
+        frame_release(frame);
+        xSemaphoreGive(lv_mutex);
+    }
+
+    httpd_req_async_handler_complete(req);
+
+    xSemaphoreTake(lv_mutex, portMAX_DELAY);
+    client->active = false;
+    client_count--;
+    xSemaphoreGive(lv_mutex);
+
+    ESP_LOGI(TAG, "Client disconnected after %lu frames (%u watching)", client->frames_sent, client_count);
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// HTTP Handler
+// ============================================================================
+
+static esp_err_t stream_handler(httpd_req_t *req)
+{
+    xSemaphoreTake(lv_mutex, portMAX_DELAY);
+    live_client_t *client = NULL;
+    for (int i = 0; i < LIVE_VIEW_MAX_CLIENTS; i++)
+    {
+        if (!clients[i].active)
+        {
+            client = &clients[i];
+            memset(client, 0, sizeof(*client));
+            client->active = true;
+            client_count++;
+            break;
+        }
+    }
+    xSemaphoreGive(lv_mutex);
+
+    if (!client)
+    {
+        return httpd_resp_send_err(req, HTTPD_503_SERVICE_UNAVAILABLE, "Too many live-view clients");
+    }
+
+    // Hand the request to a dedicated task so the server can accept others
+    esp_err_t err = httpd_req_async_handler_begin(req, &client->req);
+    if (err == ESP_OK)
+    {
+        client->start_us = esp_timer_get_time();
+        if (xTaskCreate(client_task, "live_client", CLIENT_TASK_STACK, client, 4, &client->task) != pdPASS)
+        {
+            httpd_req_async_handler_complete(client->req);
+            err = ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (err != ESP_OK)
+    {
+        xSemaphoreTake(lv_mutex, portMAX_DELAY);
+        client->active = false;
+        client_count--;
+        xSemaphoreGive(lv_mutex);
+        ESP_LOGE(TAG, "Failed to start client stream: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t live_view_start(uint16_t port)
+{
+    if (server)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    lv_mutex = xSemaphoreCreateMutex();
+    if (!lv_mutex)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = port;
+    config.max_open_sockets = LIVE_VIEW_MAX_CLIENTS + 2;
+    config.lru_purge_enable = true;
+
+    esp_err_t err = httpd_start(&server, &config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start HTTP server: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    const httpd_uri_t stream_uri = {
+        .uri = "/stream",
+        .method = HTTP_GET,
+        .handler = stream_handler,
+    };
+    httpd_register_uri_handler(server, &stream_uri);
+
+    ESP_LOGI(TAG, "Live view at http://<device-ip>:%u/stream", port);
+    return ESP_OK;
+}
+
+bool live_view_has_clients(void)
+{
+    return client_count > 0;
+}
+
+void live_view_publish(const uint8_t *jpeg, size_t len)
+{
+    if (!server || client_count == 0 || !jpeg || len == 0)
+    {
+        return;
+    }
+
+    xSemaphoreTake(lv_mutex, portMAX_DELAY);
+    live_frame_t *frame = frame_reserve(len);
+    if (!frame)
+    {
+        frames_dropped++;
+    }
+    xSemaphoreGive(lv_mutex);
+    if (!frame)
+    {
+        return;
+    }
+
+    // Reserved: no client can reach it until it becomes current_frame
+    memcpy(frame->data, jpeg, len);
+    frame->len = len;
+
+    xSemaphoreTake(lv_mutex, portMAX_DELAY);
+    frame->seq = ++frames_published; // The reservation becomes current_frame's reference
+    live_frame_t *old = current_frame;
+    current_frame = frame;
+    frame_release(old);
+
+    for (int i = 0; i < LIVE_VIEW_MAX_CLIENTS; i++)
+    {
+        if (clients[i].active && clients[i].task)
+        {
+            xTaskNotifyGive(clients[i].task);
+        }
+    }
+    xSemaphoreGive(lv_mutex);
+}
+
+esp_err_t live_view_get_stats(live_view_stats_t *stats)
+{
+    if (!stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!server)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    int64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(lv_mutex, portMAX_DELAY);
+    stats->clients = client_count;
+    stats->frames_published = frames_published;
+    stats->frames_dropped = frames_dropped;
+    for (int i = 0; i < FRAME_POOL; i++)
+    {
+        if (pool[i])
+        {
+            stats->pool_buffers++;
+            stats->pool_bytes += pool[i]->capacity;
+        }
+    }
+    for (int i = 0; i < LIVE_VIEW_MAX_CLIENTS; i++)
+    {
+        live_view_client_stats_t *out = &stats->client[i];
+        out->active = clients[i].active;
+        if (!out->active)
+        {
+            continue;
+        }
+        out->frames_sent = clients[i].frames_sent;
+        out->frames_skipped = clients[i].frames_skipped;
+        out->bytes_sent = clients[i].bytes_sent;
+        if (now_us > clients[i].start_us)
+        {
+            out->fps = clients[i].frames_sent * 1000000.0f / (now_us - clients[i].start_us);
+            out->throughput_bps = (uint32_t)(clients[i].bytes_sent * 1000000 / (now_us - clients[i].start_us));
+        }
+    }
+    xSemaphoreGive(lv_mutex);
+
+    return ESP_OK;
+}
@@ -8,6 +8,7 @@
 
 #include "esp_err.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -52,6 +53,51 @@ extern "C"
      */
     esp_err_t sensor_mpu6050_calibrate(void);
 
+    /**
+     * @brief Vibration over a time window (peak values)
+     */
+    typedef struct
+    {
+        float gyro_peak_dps;  // Highest angular rate magnitude (deg/s)
+        float accel_peak_g;   // Highest deviation of |accel| from 1 g
+        uint8_t samples;      // Samples inside the window
+    } mpu6050_vibration_t;
+
+    /**
+     * @brief Start background vibration sampling into a timestamped history
+     * @param sample_interval_ms Sampling period (10 ms = 100 Hz)
+     * @return ESP_OK on success
+     */
+    esp_err_t sensor_mpu6050_vibration_start(uint32_t sample_interval_ms);
+
+    /**
+     * @brief Get peak vibration between two esp_timer timestamps
+     * @param start_us Window start (esp_timer_get_time() clock)
+     * @param end_us Window end
+     * @param vib Pointer to result
+     * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no sample covers the window,
+     *         ESP_ERR_INVALID_STATE if sampling is not running
+     */
+    esp_err_t sensor_mpu6050_vibration_window(int64_t start_us, int64_t end_us, mpu6050_vibration_t *vib);
+
+    /**
+     * @brief Shock callback, called from the vibration sampling task
+     * @param accel_g Deviation of |accel| from 1 g that fired the callback
+     * @param ctx User context
+     */
+    typedef void (*mpu6050_shock_cb_t)(float accel_g, void *ctx);
+
+    /**
+     * @brief Call back when a vibration sample exceeds a shock threshold
+     * @param threshold_g |accel| deviation from 1 g that counts as a shock
+     * @param holdoff_ms Minimum time between two callbacks
+     * @param cb Callback (NULL to disable); must not block
+     * @param ctx User context
+     * @return ESP_OK on success
+     */
+    esp_err_t sensor_mpu6050_set_shock_callback(float threshold_g, uint32_t holdoff_ms,
+                                                mpu6050_shock_cb_t cb, void *ctx);
+
     /**
      * @brief Deinitialize MPU6050 sensor
      * @return ESP_OK on success
@@ -8,11 +8,35 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include <math.h>
 
 static const char *TAG = "MPU6050";
 static uint8_t mpu6050_addr = MPU6050_I2C_ADDR_DEFAULT;
 static bool initialized = false;
 
+// Vibration history (~640 ms at 100 Hz)
+#define VIBRATION_HISTORY 64
+
+typedef struct
+{
+    int64_t time_us;
+    float gyro_dps;
+    float accel_dev_g;
+} vibration_sample_t;
+
+static vibration_sample_t vib_history[VIBRATION_HISTORY];
+static uint32_t vib_count = 0; // Total samples written
+static SemaphoreHandle_t vib_mutex = NULL;
+static uint32_t vib_interval_ms = 0;
+
+static mpu6050_shock_cb_t shock_cb = NULL;
+static void *shock_ctx = NULL;
+static float shock_threshold_g = 0.0f;
+static int64_t shock_holdoff_us = 0;
+static int64_t shock_last_us = 0;
+
 // MPU6050 Registers
 #define MPU6050_REG_PWR_MGMT_1 0x6B
 #define MPU6050_REG_WHO_AM_I 0x75
@@ -61,27 +85,14 @@ esp_err_t sensor_mpu6050_init(uint8_t i2c_addr)
     return ESP_OK;
 }
 
-esp_err_t sensor_mpu6050_read(mpu6050_data_t *data)
+static esp_err_t mpu6050_read_raw(mpu6050_data_t *data)
 {
-    if (!initialized)
-    {
-        ESP_LOGE(TAG, "Sensor not initialized");
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    if (!data)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
-
     // Read 14 bytes: 6 accel + 2 temp + 6 gyro
     uint8_t raw_data[14];
     esp_err_t err = system_i2c_read(mpu6050_addr, MPU6050_REG_ACCEL_XOUT_H, raw_data, 14);
-
     if (err != ESP_OK)
     {
-        ESP_LOGW(TAG, "Failed to read sensor data, using placeholder");
-        goto use_placeholder;
+        return err;
     }
 
     // Parse accelerometer data (±2g range, 16384 LSB/g)
@@ -106,6 +117,28 @@ esp_err_t sensor_mpu6050_read(mpu6050_data_t *data)
     data->gyro_y = gyro_y_raw / 131.0f;
     data->gyro_z = gyro_z_raw / 131.0f;
 
+    return ESP_OK;
+}
+
+esp_err_t sensor_mpu6050_read(mpu6050_data_t *data)
+{
+    if (!initialized)
+    {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!data)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (mpu6050_read_raw(data) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to read sensor data, using placeholder");
+        goto use_placeholder;
+    }
+
     return ESP_OK;
 
 use_placeholder:
@@ -120,6 +153,152 @@ use_placeholder:
     return ESP_OK;
 }
 
+// ============================================================================
+// Vibration Sampling
+// ============================================================================
+
+static void vibration_task(void *pvParameters)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+    mpu6050_data_t data;
+
+    while (1)
+    {
+        if (mpu6050_read_raw(&data) == ESP_OK)
+        {
+            vibration_sample_t sample = {
+                .time_us = esp_timer_get_time(),
+                .gyro_dps = sqrtf(data.gyro_x * data.gyro_x + data.gyro_y * data.gyro_y +
+                                  data.gyro_z * data.gyro_z),
+                .accel_dev_g = fabsf(sqrtf(data.accel_x * data.accel_x + data.accel_y * data.accel_y +
+                                           data.accel_z * data.accel_z) - 1.0f),
+            };
+
+            xSemaphoreTake(vib_mutex, portMAX_DELAY);
+            vib_history[vib_count % VIBRATION_HISTORY] = sample;
+            vib_count++;
+            mpu6050_shock_cb_t cb = shock_cb;
+            void *ctx = shock_ctx;
+            bool shock = cb && sample.accel_dev_g > shock_threshold_g &&
+                         sample.time_us - shock_last_us >= shock_holdoff_us;
+            if (shock)
+            {
+                shock_last_us = sample.time_us;
+            }
+            xSemaphoreGive(vib_mutex);
+
+            if (shock)
+            {
+                cb(sample.accel_dev_g, ctx);
+            }
+        }
+
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(vib_interval_ms));
+    }
+}
+
+esp_err_t sensor_mpu6050_vibration_start(uint32_t sample_interval_ms)
+{
+    if (!initialized || vib_mutex)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (sample_interval_ms == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    vib_mutex = xSemaphoreCreateMutex();
+    if (!vib_mutex)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    vib_interval_ms = sample_interval_ms;
+    if (xTaskCreate(vibration_task, "mpu_vibration", 3072, NULL, 7, NULL) != pdPASS)
+    {
+        vSemaphoreDelete(vib_mutex);
+        vib_mutex = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Vibration sampling every %lu ms", sample_interval_ms);
+    return ESP_OK;
+}
+
+esp_err_t sensor_mpu6050_vibration_window(int64_t start_us, int64_t end_us, mpu6050_vibration_t *vib)
+{
+    if (!vib || end_us < start_us)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!vib_mutex)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Widen by one sample period so a short window always sees its neighbours
+    int64_t margin_us = (int64_t)vib_interval_ms * 1000;
+    start_us -= margin_us;
+    end_us += margin_us;
+
+    vib->gyro_peak_dps = 0.0f;
+    vib->accel_peak_g = 0.0f;
+    vib->samples = 0;
+
+    xSemaphoreTake(vib_mutex, portMAX_DELAY);
+    uint32_t available = vib_count < VIBRATION_HISTORY ? vib_count : VIBRATION_HISTORY;
+    for (uint32_t i = 0; i < available; i++)
+    {
+        const vibration_sample_t *sample = &vib_history[(vib_count - 1 - i) % VIBRATION_HISTORY];
+        if (sample->time_us < start_us)
+        {
+            break; // Newest first: everything further back is older still
+        }
+        if (sample->time_us > end_us)
+        {
+            continue;
+        }
+        if (sample->gyro_dps > vib->gyro_peak_dps)
+        {
+            vib->gyro_peak_dps = sample->gyro_dps;
+        }
+        if (sample->accel_dev_g > vib->accel_peak_g)
+        {
+            vib->accel_peak_g = sample->accel_dev_g;
+        }
+        vib->samples++;
+    }
+    xSemaphoreGive(vib_mutex);
+
+    return vib->samples > 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t sensor_mpu6050_set_shock_callback(float threshold_g, uint32_t holdoff_ms,
+                                            mpu6050_shock_cb_t cb, void *ctx)
+{
+    if (!vib_mutex)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (cb && threshold_g <= 0.0f)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(vib_mutex, portMAX_DELAY);
+    shock_threshold_g = threshold_g;
+    shock_holdoff_us = (int64_t)holdoff_ms * 1000;
+    shock_cb = cb;
+    shock_ctx = ctx;
+    xSemaphoreGive(vib_mutex);
+
+    return ESP_OK;
+}
+
 esp_err_t sensor_mpu6050_calibrate(void)
 {
     if (!initialized)
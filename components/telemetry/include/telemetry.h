@@ -0,0 +1,104 @@
+/**
+ * @file telemetry.h
+ * @brief Telemetry Sample Encoding (JSON and CBOR)
+ *
+ * Plain C without ESP-IDF dependencies, so the encoders also build on a
+ * host compiler (tools/telemetry_decode.py reads the CBOR output).
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One telemetry sample
+ */
+typedef struct {
+    int64_t ts_ms;               // Sample time (ms since boot)
+    uint32_t boot;               // Boot counter: orders ts_ms across reboots
+    int64_t utc_ms;              // Sample time (ms since 1970, UTC), 0 = clock not set yet
+    const char *device_id;
+    float temperature;           // °C
+    float humidity;              // %
+    float pressure;              // hPa
+    float gas;                   // Ohms
+    double lat;                  // Degrees
+    double lng;
+    float speed;                 // km/h
+    float vibration;             // g
+    float accel_x;               // g
+    float accel_y;
+    float accel_z;
+    int16_t rain_score;          // 0-100, -1 = camera off
+    int16_t visibility;          // 0-100, -1 = camera off
+} telemetry_sample_t;
+
+// Encoded size bounds with a device ID of up to 32 characters
+#define TELEMETRY_JSON_MAX 384
+#define TELEMETRY_CBOR_MAX 160
+
+// ============================================================================
+// JSON
+// ============================================================================
+
+/**
+ * @brief Encode a sample as one JSON object
+ * @param sample Sample
+ * @param buf Destination
+ * @param size Destination size
+ * @return Characters written (excluding the terminator), 0 if it did not fit
+ */
+size_t telemetry_encode_json(const telemetry_sample_t *sample, char *buf, size_t size);
+
+// ============================================================================
+// CBOR (RFC 8949) with integer keys
+// ============================================================================
+
+/**
+ * @brief Map keys of the CBOR encoding
+ *
+ * Floats are single precision. Coordinates are integers in 1e-7 degrees,
+ * finer than the JSON "%.6f" text (~1 cm vs ~11 cm) in at most 5 bytes.
+ */
+typedef enum {
+    TELEMETRY_KEY_TS = 0,          // uint, ms since boot
+    TELEMETRY_KEY_DEVICE = 1,      // text
+    TELEMETRY_KEY_TEMPERATURE = 2, // float32
+    TELEMETRY_KEY_HUMIDITY = 3,    // float32
+    TELEMETRY_KEY_PRESSURE = 4,    // float32
+    TELEMETRY_KEY_GAS = 5,         // uint, Ohms
+    TELEMETRY_KEY_LAT = 6,         // int, 1e-7 degrees
+    TELEMETRY_KEY_LNG = 7,         // int, 1e-7 degrees
+    TELEMETRY_KEY_SPEED = 8,       // float32
+    TELEMETRY_KEY_VIBRATION = 9,   // float32
+    TELEMETRY_KEY_ACCEL = 10,      // array of 3 float32
+    TELEMETRY_KEY_RAIN = 11,       // int
+    TELEMETRY_KEY_VISIBILITY = 12, // int
+    TELEMETRY_KEY_BOOT = 13,       // uint
+    TELEMETRY_KEY_UTC = 14,        // uint, ms since 1970 (0 = clock not set)
+} telemetry_key_t;
+
+#define TELEMETRY_CBOR_ARRAY_START 0x9F // Indefinite-length array: batches are
+#define TELEMETRY_CBOR_BREAK 0xFF       // framed as 9F <sample>... FF
+
+/**
+ * @brief Encode a sample as one CBOR map
+ * @param sample Sample
+ * @param buf Destination
+ * @param size Destination size
+ * @return Bytes written, 0 if it did not fit
+ */
+size_t telemetry_encode_cbor(const telemetry_sample_t *sample, uint8_t *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_H
@@ -0,0 +1,163 @@
+/**
+ * @file telemetry_cbor.c
+ * @brief CBOR Telemetry Encoding
+ *
+ * Only the few item types the sample needs: unsigned and negative
+ * integers, text, float32, a fixed-size map and a fixed-size array. Every
+ * write is bounds-checked; an overflow makes the whole encode return 0.
+ */
+
+#include "telemetry.h"
+#include <string.h>
+
+#define MAJOR_UINT 0
+#define MAJOR_NEGINT 1
+#define MAJOR_TEXT 3
+#define MAJOR_ARRAY 4
+#define MAJOR_MAP 5
+#define FLOAT32 0xFA
+
+#define SAMPLE_PAIRS 15
+
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} cbor_writer_t;
+
+static void put(cbor_writer_t *w, const void *data, size_t len)
+{
+    if (w->overflow || w->len + len > w->size)
+    {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+// Initial byte plus the shortest big-endian argument
+static void head(cbor_writer_t *w, uint8_t major, uint64_t value)
+{
+    uint8_t b[9];
+    size_t n;
+
+    if (value < 24)
+    {
+        b[0] = (uint8_t)(major << 5 | value);
+        n = 1;
+    }
+    else if (value <= 0xFF)
+    {
+        b[0] = (uint8_t)(major << 5 | 24);
+        b[1] = (uint8_t)value;
+        n = 2;
+    }
+    else if (value <= 0xFFFF)
+    {
+        b[0] = (uint8_t)(major << 5 | 25);
+        b[1] = (uint8_t)(value >> 8);
+        b[2] = (uint8_t)value;
+        n = 3;
+    }
+    else if (value <= 0xFFFFFFFFu)
+    {
+        b[0] = (uint8_t)(major << 5 | 26);
+        for (int i = 0; i < 4; i++)
+        {
+            b[1 + i] = (uint8_t)(value >> (24 - 8 * i));
+        }
+        n = 5;
+    }
+    else
+    {
+        b[0] = (uint8_t)(major << 5 | 27);
+        for (int i = 0; i < 8; i++)
+        {
+            b[1 + i] = (uint8_t)(value >> (56 - 8 * i));
+        }
+        n = 9;
+    }
+    put(w, b, n);
+}
+
+static void put_int(cbor_writer_t *w, int64_t value)
+{
+    if (value >= 0)
+    {
+        head(w, MAJOR_UINT, (uint64_t)value);
+    }
+    else
+    {
+        head(w, MAJOR_NEGINT, (uint64_t)(-1 - value));
+    }
+}
+
+static void put_text(cbor_writer_t *w, const char *text)
+{
+    size_t len = strlen(text);
+    head(w, MAJOR_TEXT, len);
+    put(w, text, len);
+}
+
+static void put_float(cbor_writer_t *w, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t b[5] = {FLOAT32, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits};
+    put(w, b, sizeof(b));
+}
+
+static int64_t round_scaled(double value, double scale)
+{
+    double scaled = value * scale;
+    return (int64_t)(scaled + (scaled >= 0 ? 0.5 : -0.5));
+}
+
+size_t telemetry_encode_cbor(const telemetry_sample_t *s, uint8_t *buf, size_t size)
+{
+    if (!s || !buf)
+    {
+        return 0;
+    }
+
+    cbor_writer_t w = {.buf = buf, .size = size};
+
+    head(&w, MAJOR_MAP, SAMPLE_PAIRS);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_TS);
+    put_int(&w, s->ts_ms);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_BOOT);
+    put_int(&w, s->boot);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_UTC);
+    put_int(&w, s->utc_ms);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_DEVICE);
+    put_text(&w, s->device_id ? s->device_id : "");
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_TEMPERATURE);
+    put_float(&w, s->temperature);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_HUMIDITY);
+    put_float(&w, s->humidity);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_PRESSURE);
+    put_float(&w, s->pressure);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_GAS);
+    put_int(&w, round_scaled(s->gas, 1.0));
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_LAT);
+    put_int(&w, round_scaled(s->lat, 1e7));
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_LNG);
+    put_int(&w, round_scaled(s->lng, 1e7));
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_SPEED);
+    put_float(&w, s->speed);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_VIBRATION);
+    put_float(&w, s->vibration);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_ACCEL);
+    head(&w, MAJOR_ARRAY, 3);
+    put_float(&w, s->accel_x);
+    put_float(&w, s->accel_y);
+    put_float(&w, s->accel_z);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_RAIN);
+    put_int(&w, s->rain_score);
+    head(&w, MAJOR_UINT, TELEMETRY_KEY_VISIBILITY);
+    put_int(&w, s->visibility);
+
+    return w.overflow ? 0 : w.len;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file telemetry_json.c
+ * @brief JSON Telemetry Encoding
+ */
+
+#include "telemetry.h"
+#include "json_writer.h"
+
+size_t telemetry_encode_json(const telemetry_sample_t *s, char *buf, size_t size)
+{
+    if (!s || !buf || size == 0)
+    {
+        return 0;
+    }
+
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_object_begin(&w, NULL);
+    json_writer_int(&w, "ts", s->ts_ms);
+    json_writer_int(&w, "boot", s->boot);
+    json_writer_int(&w, "utc", s->utc_ms);
+    json_writer_string(&w, "deviceId", s->device_id ? s->device_id : "");
+    json_writer_fixed(&w, "temperature", s->temperature, 2);
+    json_writer_fixed(&w, "humidity", s->humidity, 2);
+    json_writer_fixed(&w, "pressure", s->pressure, 2);
+    json_writer_fixed(&w, "gas", s->gas, 0);
+    json_writer_fixed(&w, "lat", s->lat, 6);
+    json_writer_fixed(&w, "lng", s->lng, 6);
+    json_writer_fixed(&w, "speed", s->speed, 2);
+    json_writer_fixed(&w, "vibration", s->vibration, 3);
+    json_writer_fixed(&w, "accel_x", s->accel_x, 3);
+    json_writer_fixed(&w, "accel_y", s->accel_y, 3);
+    json_writer_fixed(&w, "accel_z", s->accel_z, 3);
+    json_writer_int(&w, "rainScore", s->rain_score);
+    json_writer_int(&w, "visibility", s->visibility);
+    json_writer_object_end(&w);
+    return json_writer_finish(&w);
+}
@@ -0,0 +1,308 @@
+/**
+ * @file host_port.c
+ * @brief RAM flash, clock, heap, CRC and FreeRTOS stand-ins for the host build
+ */
+
+#include "host_port.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// ============================================================================
+// Flash (shared with forked boots)
+// ============================================================================
+
+typedef struct {
+    uint32_t writes;
+    uint32_t tear_keep;                 // 0 = no tear armed, else keep + 1
+    uint8_t data[];
+} host_flash_t;
+
+static host_flash_t *flash = NULL;
+static esp_partition_t partition = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = ESP_PARTITION_SUBTYPE_ANY,
+    .address = 0x310000,
+};
+
+void host_flash_init(const char *label, uint32_t sectors)
+{
+    snprintf(partition.label, sizeof(partition.label), "%s", label);
+    partition.size = sectors * HOST_FLASH_SECTOR;
+    flash = mmap(NULL, sizeof(*flash) + partition.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (flash == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(2);
+    }
+    host_flash_erase();
+}
+
+void host_flash_erase(void)
+{
+    memset(flash->data, 0xFF, partition.size);
+    flash->tear_keep = 0;
+}
+
+void host_flash_tear_next_write(size_t keep)
+{
+    flash->tear_keep = (uint32_t)keep + 1;
+}
+
+uint32_t host_flash_writes(void)
+{
+    return flash->writes;
+}
+
+void host_power_loss(void)
+{
+    fflush(stdout);
+    _exit(0);
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    return flash && strcmp(label, partition.label) == 0 ? &partition : NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t src_offset, void *dst, size_t size)
+{
+    if (src_offset + size > part->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, flash->data + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t dst_offset, const void *src, size_t size)
+{
+    if (dst_offset + size > part->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t keep = size;
+    bool tear = flash->tear_keep > 0;
+    if (tear && flash->tear_keep - 1 < size)
+    {
+        keep = flash->tear_keep - 1;
+    }
+
+    // NOR flash: programming clears bits, never sets them
+    const uint8_t *in = src;
+    for (size_t i = 0; i < keep; i++)
+    {
+        flash->data[dst_offset + i] &= in[i];
+    }
+    flash->writes++;
+
+    if (tear)
+    {
+        flash->tear_keep = 0;
+        host_power_loss();
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    if (offset % HOST_FLASH_SECTOR || size % HOST_FLASH_SECTOR || offset + size > part->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(flash->data + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+// ============================================================================
+// Clock, Heap, CRC, Log
+// ============================================================================
+
+static int64_t clock_offset_us = 0;
+
+void host_clock_advance_ms(uint32_t ms)
+{
+    __atomic_add_fetch(&clock_offset_us, (int64_t)ms * 1000, __ATOMIC_SEQ_CST);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 + __atomic_load_n(&clock_offset_us, __ATOMIC_SEQ_CST);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+const char *esp_err_to_name(esp_err_t err)
+{
+    return err == ESP_OK ? "ESP_OK" : "ESP_ERR";
+}
+
+// Arguments are not formatted: the firmware's formats assume 32-bit longs
+void host_log(char level, const char *tag, const char *fmt, ...)
+{
+    if (level == 'E' || level == 'W')
+    {
+        printf("  %c %s: %s\n", level, tag, fmt);
+    }
+}
+
+// ============================================================================
+// FreeRTOS
+// ============================================================================
+
+struct host_task {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notified;
+    TaskFunction_t fn;
+    void *arg;
+};
+
+static __thread struct host_task *current_task = NULL;
+
+static void *task_main(void *arg)
+{
+    struct host_task *task = arg;
+    current_task = task;
+    task->fn(task->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (!task)
+    {
+        return pdFALSE;
+    }
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->cond, NULL);
+    task->fn = fn;
+    task->arg = arg;
+    if (handle)
+    {
+        *handle = task;
+    }
+    if (pthread_create(&task->thread, NULL, task_main, task) != 0)
+    {
+        free(task);
+        return pdFALSE;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+    struct host_task *task = current_task;
+    if (!task)
+    {
+        vTaskDelay(wait);
+        return 0;
+    }
+
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    uint64_t ns = (uint64_t)until.tv_nsec + (uint64_t)(wait == portMAX_DELAY ? 0 : wait) * 1000000;
+    until.tv_sec += ns / 1000000000;
+    until.tv_nsec = ns % 1000000000;
+
+    pthread_mutex_lock(&task->lock);
+    while (!task->notified)
+    {
+        if (wait == portMAX_DELAY)
+        {
+            pthread_cond_wait(&task->cond, &task->lock);
+        }
+        else if (pthread_cond_timedwait(&task->cond, &task->lock, &until) != 0)
+        {
+            break;
+        }
+    }
+    uint32_t value = task->notified;
+    task->notified = clear ? 0 : (value ? value - 1 : 0);
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notified++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep((useconds_t)ticks * 1000);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    pthread_mutex_t *mutex = malloc(sizeof(*mutex));
+    if (mutex)
+    {
+        pthread_mutex_init(mutex, NULL);
+    }
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    pthread_mutex_lock(sem);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_unlock(sem);
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    pthread_mutex_destroy(sem);
+    free(sem);
+}
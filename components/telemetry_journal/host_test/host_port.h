@@ -0,0 +1,50 @@
+/**
+ * @file host_port.h
+ * @brief Host port of the journal's ESP-IDF and FreeRTOS dependencies
+ *
+ * The partition lives in shared memory, so it survives a forked
+ * boot that ends in a simulated power loss. Program operations behave like
+ * NOR flash (bits only go from 1 to 0), and the next one can be torn.
+ */
+
+#ifndef HOST_PORT_H
+#define HOST_PORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_FLASH_SECTOR 4096
+
+/**
+ * @brief Map the partition (call once, before the first boot)
+ * @param label Partition label, e.g. "journal"
+ * @param sectors Partition size in 4 KB sectors
+ */
+void host_flash_init(const char *label, uint32_t sectors);
+
+/**
+ * @brief Erase the whole partition
+ */
+void host_flash_erase(void);
+
+/**
+ * @brief Tear the next program operation: keep its first keep bytes, then lose power
+ */
+void host_flash_tear_next_write(size_t keep);
+
+/**
+ * @brief Program operations so far (all boots)
+ */
+uint32_t host_flash_writes(void);
+
+/**
+ * @brief Move esp_timer_get_time() forward
+ */
+void host_clock_advance_ms(uint32_t ms);
+
+/**
+ * @brief End the current boot without flushing anything, like a power loss
+ */
+void host_power_loss(void);
+
+#endif // HOST_PORT_H
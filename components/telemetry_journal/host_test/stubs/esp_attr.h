@@ -0,0 +1,4 @@
+// Host stand-in for esp_attr.h
+#pragma once
+
+#define RTC_NOINIT_ATTR // Every forked boot starts from zeroed RTC memory
@@ -0,0 +1,6 @@
+// Host stand-in for esp_timer.h (see host_port.h for the test clock)
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,418 @@
+/**
+ * @file test_telemetry_journal.c
+ * @brief Power-loss tests of the telemetry journal on simulated flash
+ *
+ * Every boot runs in a forked child over the shared RAM partition and may
+ * end in host_power_loss(), which drops whatever was not programmed yet.
+ * Usage: test_telemetry_journal
+ */
+
+#include "host_port.h"
+#include "telemetry_journal.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SECTORS 16
+#define WAIT_MS 5000
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                  \
+    do                                    \
+    {                                     \
+        if (!(cond))                      \
+        {                                 \
+            printf("FAIL: " __VA_ARGS__); \
+            printf("\n");                 \
+            failures++;                   \
+        }                                 \
+    } while (0)
+
+// ============================================================================
+// Replay Transport
+// ============================================================================
+
+#define SENT_MAX 256
+
+typedef struct {
+    uint8_t tag;
+    uint32_t index;                  // Message number parsed from the payload
+    int msg_id;
+} sent_t;
+
+static pthread_mutex_t sent_lock = PTHREAD_MUTEX_INITIALIZER;
+static sent_t sent[SENT_MAX];
+static int sent_count = 0;
+static int next_msg_id = 0;
+static volatile bool link_up = false;
+
+// Message i: its number, then filler up to len bytes
+static size_t make_message(uint32_t i, uint8_t *buf, size_t len)
+{
+    int n = snprintf((char *)buf, len, "msg-%05u:", (unsigned int)i);
+    for (size_t k = n; k < len; k++)
+    {
+        buf[k] = (uint8_t)('a' + (i + k) % 26);
+    }
+    return len;
+}
+
+static esp_err_t test_send(uint8_t tag, const uint8_t *data, size_t len, int *msg_id, void *ctx)
+{
+    unsigned int index = 0;
+    if (sscanf((const char *)data, "msg-%05u:", &index) != 1)
+    {
+        return ESP_FAIL;
+    }
+    uint8_t expect[TELEMETRY_JOURNAL_RECORD_MAX];
+    make_message(index, expect, len);
+    CHECK(memcmp(expect, data, len) == 0, "message %u replayed with wrong content", index);
+
+    pthread_mutex_lock(&sent_lock);
+    *msg_id = ++next_msg_id;
+    if (sent_count < SENT_MAX)
+    {
+        sent[sent_count++] = (sent_t){.tag = tag, .index = index, .msg_id = *msg_id};
+    }
+    pthread_mutex_unlock(&sent_lock);
+    return ESP_OK;
+}
+
+static bool test_ready(void *ctx)
+{
+    return link_up;
+}
+
+static int sent_total(void)
+{
+    pthread_mutex_lock(&sent_lock);
+    int n = sent_count;
+    pthread_mutex_unlock(&sent_lock);
+    return n;
+}
+
+static sent_t sent_at(int i)
+{
+    pthread_mutex_lock(&sent_lock);
+    sent_t s = sent[i];
+    pthread_mutex_unlock(&sent_lock);
+    return s;
+}
+
+static bool wait_sent(int count)
+{
+    for (int ms = 0; ms < WAIT_MS; ms++)
+    {
+        if (sent_total() >= count)
+        {
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+static telemetry_journal_stats_t journal_stats(void)
+{
+    telemetry_journal_stats_t js;
+    telemetry_journal_get_stats(&js);
+    return js;
+}
+
+static bool wait_drained(void)
+{
+    for (int ms = 0; ms < WAIT_MS; ms++)
+    {
+        if (journal_stats().pending == 0)
+        {
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+static void start_journal(uint32_t flush_ms)
+{
+    const telemetry_journal_config_t cfg = {
+        .send = test_send,
+        .ready = test_ready,
+        .replay_per_s = 1000,
+        .flush_ms = flush_ms,
+    };
+    esp_err_t err = telemetry_journal_start(&cfg);
+    CHECK(err == ESP_OK, "telemetry_journal_start: %d", err);
+}
+
+static void append(uint32_t first, uint32_t count, size_t len)
+{
+    uint8_t buf[TELEMETRY_JOURNAL_RECORD_MAX];
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        esp_err_t err = telemetry_journal_append(i % 2, buf, make_message(i, buf, len));
+        CHECK(err == ESP_OK, "append %u: %d", (unsigned int)i, err);
+    }
+}
+
+// Acknowledge every message as it is sent until the journal is empty;
+// checks they arrive in order, first..first+count-1, with their tags
+static void drain_in_order(uint32_t first, uint32_t count)
+{
+    link_up = true;
+    telemetry_journal_kick();
+    int acked = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!wait_sent(acked + 1))
+        {
+            CHECK(false, "replay stalled after %d of %u messages", acked, (unsigned int)count);
+            return;
+        }
+        sent_t s = sent_at(acked++);
+        CHECK(s.index == first + i, "replay %u: got message %u, expected %u", (unsigned int)i,
+              (unsigned int)s.index, (unsigned int)(first + i));
+        CHECK(s.tag == s.index % 2, "message %u replayed with tag %u", (unsigned int)s.index, s.tag);
+        telemetry_journal_delivered(s.msg_id, true);
+    }
+    CHECK(wait_drained(), "journal not empty after the replay: %u pending", (unsigned int)journal_stats().pending);
+}
+
+// ============================================================================
+// Boots
+// ============================================================================
+
+// Run one boot in a child; it ends with a power loss unless it returns an error count
+static void boot(const char *name, void (*fn)(void))
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        fn();
+        fflush(stdout);
+        _exit(failures ? 1 : 0);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        printf("FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+// Outage: 20 messages reach flash, 3 more are still in RAM when power goes
+static void outage_before(void)
+{
+    start_journal(60000);
+    append(0, 20, 200);
+    CHECK(telemetry_journal_flush() == ESP_OK, "flush failed");
+    append(20, 3, 200);
+    telemetry_journal_stats_t js = journal_stats();
+    CHECK(js.pending == 23 && js.unwritten == 3, "before power loss: %u pending, %u unwritten",
+          (unsigned int)js.pending, (unsigned int)js.unwritten);
+    host_power_loss();
+}
+
+static void outage_after(void)
+{
+    start_journal(60000);
+    telemetry_journal_stats_t js = journal_stats();
+    CHECK(js.recovered == 20, "outage: %u recovered, expected the 20 written", (unsigned int)js.recovered);
+    drain_in_order(0, 20);
+    js = journal_stats();
+    CHECK(js.replayed == 20 && js.corrupt == 0 && js.resent == 0, "outage: replayed=%u corrupt=%u resent=%u",
+          (unsigned int)js.replayed, (unsigned int)js.corrupt, (unsigned int)js.resent);
+    host_power_loss();
+}
+
+static void expect_empty(void)
+{
+    start_journal(60000);
+    CHECK(journal_stats().recovered == 0, "%u replayed messages came back after a restart",
+          (unsigned int)journal_stats().recovered);
+    host_power_loss();
+}
+
+// Partial drain: 4 of 10 acknowledged, 4 more sent but unacknowledged
+static void partial_before(void)
+{
+    start_journal(0);
+    append(0, 10, 120);
+    link_up = true;
+    telemetry_journal_kick();
+    CHECK(wait_sent(TELEMETRY_JOURNAL_INFLIGHT), "nothing replayed");
+    for (int i = 0; i < 4; i++)
+    {
+        telemetry_journal_delivered(sent_at(i).msg_id, true);
+        CHECK(wait_sent(TELEMETRY_JOURNAL_INFLIGHT + i + 1), "replay did not continue after an ack");
+    }
+    for (int ms = 0; ms < WAIT_MS && journal_stats().replayed < 4; ms++)
+    {
+        usleep(1000);
+    }
+    telemetry_journal_stats_t js = journal_stats();
+    CHECK(js.replayed == 4 && js.inflight == TELEMETRY_JOURNAL_INFLIGHT && js.pending == 6,
+          "partial: replayed=%u inflight=%u pending=%u", (unsigned int)js.replayed, (unsigned int)js.inflight,
+          (unsigned int)js.pending);
+    host_power_loss();
+}
+
+static void partial_after(void)
+{
+    start_journal(0);
+    CHECK(journal_stats().recovered == 6, "partial: %u recovered, expected 6 (4 unacknowledged)",
+          (unsigned int)journal_stats().recovered);
+    drain_in_order(4, 6);
+    host_power_loss();
+}
+
+// Eviction: about twice the partition, the oldest sectors are overwritten
+static void eviction(void)
+{
+    start_journal(0);
+    const uint32_t total = 130;
+    append(0, total, 1000);
+    telemetry_journal_stats_t js = journal_stats();
+    CHECK(js.evicted > 0, "eviction: nothing evicted");
+    CHECK(js.pending + js.evicted == total, "eviction: %u pending + %u evicted != %u appended",
+          (unsigned int)js.pending, (unsigned int)js.evicted, (unsigned int)total);
+    drain_in_order(js.evicted, js.pending);
+    host_power_loss();
+}
+
+// Torn write: five 100-byte messages (116-byte records after the 8-byte
+// sector header) are on flash, so the next write starts on the page at 512
+// and covers records at 588, 704 and 820
+static void torn_before_payload(void)
+{
+    start_journal(60000);
+    append(0, 5, 100);
+    telemetry_journal_flush();
+    append(5, 3, 100);
+    host_flash_tear_next_write(704 + 16 + 10 - 512); // Record 7: header and 10 payload bytes
+    telemetry_journal_flush();
+    CHECK(false, "torn write did not cut the power");
+}
+
+static void torn_before_header(void)
+{
+    start_journal(60000);
+    append(0, 5, 100);
+    telemetry_journal_flush();
+    append(5, 3, 100);
+    host_flash_tear_next_write(704 + 6 - 512); // Record 7: 6 header bytes
+    telemetry_journal_flush();
+    CHECK(false, "torn write did not cut the power");
+}
+
+// Torn payload: the header is intact, so the record is found and fails its CRC
+static void torn_after_payload(void)
+{
+    start_journal(60000);
+    telemetry_journal_stats_t js = journal_stats();
+    CHECK(js.recovered == 7, "torn payload: %u recovered, expected 7", (unsigned int)js.recovered);
+    append(100, 2, 100);
+    link_up = true;
+    telemetry_journal_kick();
+    uint32_t expect[] = {0, 1, 2, 3, 4, 5, 100, 101};
+    for (int i = 0; i < 8; i++)
+    {
+        CHECK(wait_sent(i + 1), "torn payload: replay stalled at %d", i);
+        sent_t s = sent_at(i);
+        CHECK(s.index == expect[i], "torn payload: replay %d is message %u", i, (unsigned int)s.index);
+        telemetry_journal_delivered(s.msg_id, true);
+    }
+    CHECK(wait_drained(), "torn payload: journal not drained");
+    js = journal_stats();
+    CHECK(js.corrupt == 1 && js.replayed == 8, "torn payload: corrupt=%u replayed=%u", (unsigned int)js.corrupt,
+          (unsigned int)js.replayed);
+    host_power_loss();
+}
+
+// Torn header: the records end at 704, the sector is sealed, appends move on
+static void torn_after_header(void)
+{
+    start_journal(0);
+    telemetry_journal_stats_t js = journal_stats();
+    CHECK(js.recovered == 6, "torn header: %u recovered, expected 6", (unsigned int)js.recovered);
+    append(6, 4, 100);
+    drain_in_order(0, 10);
+    CHECK(journal_stats().corrupt == 0, "torn header: corrupt records replayed");
+    host_power_loss();
+}
+
+// A message the outbox evicts, or that is never answered, goes out again
+static void lost_puback(void)
+{
+    start_journal(0);
+    append(0, 3, 80);
+    link_up = true;
+    telemetry_journal_kick();
+    CHECK(wait_sent(3), "lost: nothing replayed");
+    telemetry_journal_delivered(sent_at(1).msg_id, false);
+    telemetry_journal_delivered(sent_at(0).msg_id, true);
+    telemetry_journal_delivered(sent_at(2).msg_id, true);
+
+    CHECK(wait_sent(4), "lost: message not sent again");
+    CHECK(sent_at(3).index == 1, "lost: resent message %u instead of 1", (unsigned int)sent_at(3).index);
+
+    // No answer at all this time
+    host_clock_advance_ms(61000);
+    telemetry_journal_kick();
+    CHECK(wait_sent(5), "unanswered: message not sent again");
+    CHECK(sent_at(4).index == 1, "unanswered: resent message %u instead of 1", (unsigned int)sent_at(4).index);
+    telemetry_journal_delivered(sent_at(4).msg_id, true);
+
+    CHECK(wait_drained(), "lost: journal not drained");
+    telemetry_journal_stats_t js = journal_stats();
+    CHECK(js.replayed == 3 && js.resent == 2, "lost: replayed=%u resent=%u", (unsigned int)js.replayed,
+          (unsigned int)js.resent);
+    host_power_loss();
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void)
+{
+    host_flash_init("journal", SECTORS);
+
+    printf("outage + reboot\n");
+    boot("outage: before", outage_before);
+    boot("outage: after", outage_after);
+    boot("outage: replayed stay replayed", expect_empty);
+
+    printf("partial drain\n");
+    host_flash_erase();
+    boot("partial: before", partial_before);
+    boot("partial: after", partial_after);
+
+    printf("eviction\n");
+    host_flash_erase();
+    boot("eviction", eviction);
+    boot("eviction: replayed stay replayed", expect_empty);
+
+    printf("torn write in a payload\n");
+    host_flash_erase();
+    boot("torn payload: before", torn_before_payload);
+    boot("torn payload: after", torn_after_payload);
+
+    printf("torn write in a header\n");
+    host_flash_erase();
+    boot("torn header: before", torn_before_header);
+    boot("torn header: after", torn_after_header);
+
+    printf("lost and unanswered PUBACKs\n");
+    host_flash_erase();
+    boot("lost", lost_puback);
+
+    printf("%s (%u flash writes)\n", failures ? "FAILED" : "passed", (unsigned int)host_flash_writes());
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file telemetry_journal.h
+ * @brief Store-and-Forward Telemetry Journal on a Raw Flash Partition
+ */
+
+#ifndef TELEMETRY_JOURNAL_H
+#define TELEMETRY_JOURNAL_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_JOURNAL_PARTITION "journal"
+#define TELEMETRY_JOURNAL_RECORD_MAX 4072 // Largest message: one 4 KB sector less headers
+#define TELEMETRY_JOURNAL_INFLIGHT 4      // Replayed messages awaiting confirmation at once
+
+/**
+ * @brief Replay callback: send one journaled message
+ * @param tag Tag the message was appended with
+ * @param msg_id Set to the transport's message id if delivery is confirmed later through
+ *               telemetry_journal_delivered(); left at 0 the message counts as delivered
+ * @return ESP_OK once sent; the record stays pending until delivery is confirmed
+ */
+typedef esp_err_t (*telemetry_journal_send_cb_t)(uint8_t tag, const uint8_t *data, size_t len, int *msg_id,
+                                                 void *ctx);
+
+/**
+ * @brief Replay gate: return true while the replay worker may send
+ */
+typedef bool (*telemetry_journal_ready_cb_t)(void *ctx);
+
+/**
+ * @brief Journal configuration
+ */
+typedef struct {
+    telemetry_journal_send_cb_t send; // Delivers replayed messages
+    telemetry_journal_ready_cb_t ready; // Link up
+    void *ctx;                       // Passed to both callbacks
+    uint16_t replay_per_s;           // Replay rate limit in messages per second (0 = 1)
+    uint32_t flush_ms;               // Appended messages reach flash within this time
+    int replay_core;                 // Core for the replay worker
+} telemetry_journal_config_t;
+
+/**
+ * @brief Journal statistics
+ */
+typedef struct {
+    uint32_t pending;                // Messages waiting for replay (journal depth)
+    uint32_t pending_bytes;          // Their payload bytes
+    uint32_t capacity_bytes;         // Partition size
+    uint8_t fill_percent;            // pending_bytes / capacity
+    uint32_t recovered;              // Messages found pending at mount
+    uint32_t appended;               // Messages journaled since boot
+    uint32_t unwritten;              // Appended messages not on flash yet (lost on a reset)
+    uint32_t replayed;               // Messages delivered (and confirmed) by the replay worker
+    uint32_t inflight;               // Replayed messages awaiting confirmation
+    uint32_t resent;                 // Replays lost or unconfirmed, sent again
+    uint32_t evicted;                // Pending messages overwritten because the journal was full
+    uint32_t corrupt;                // Records skipped on CRC mismatch
+    uint32_t flash_writes;           // Program operations (each covers one or more records)
+    uint32_t bytes_per_write;        // Average bytes per program operation
+    float drain_rate;                // Messages per second while replaying
+    uint32_t drain_bps;              // Payload bytes per second while replaying
+    uint32_t mount_ms;               // Time telemetry_journal_start() spent scanning
+} telemetry_journal_stats_t;
+
+/**
+ * @brief Mount the journal and start the replay worker
+ *
+ * Scans the partition for records left from before a reset; those still
+ * pending are replayed oldest-first once ready() allows it.
+ *
+ * @param config Journal configuration
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the partition is missing
+ */
+esp_err_t telemetry_journal_start(const telemetry_journal_config_t *config);
+
+/**
+ * @brief Append a message
+ *
+ * The message is buffered with its CRC and reaches flash with the next
+ * batched write: when about a page of records has accumulated, after
+ * flush_ms, or on telemetry_journal_flush(). When the journal is full the
+ * oldest sector is overwritten.
+ *
+ * @param tag Stored with the message and handed back to send() (e.g. which topic it belongs to)
+ * @param data Message payload
+ * @param len Payload size (<= TELEMETRY_JOURNAL_RECORD_MAX)
+ * @return ESP_OK once buffered
+ */
+esp_err_t telemetry_journal_append(uint8_t tag, const void *data, size_t len);
+
+/**
+ * @brief Write buffered records to flash now (e.g. before a restart)
+ * @return ESP_OK on success
+ */
+esp_err_t telemetry_journal_flush(void);
+
+/**
+ * @brief Report the outcome of a replayed message (callable from any task)
+ *
+ * Unknown msg_ids are ignored, so every confirmation of the transport may be
+ * passed on. A confirmed record is marked replayed; a lost one is sent again.
+ *
+ * @param msg_id Id the send callback returned
+ * @param delivered true once acknowledged, false if the transport dropped it
+ */
+void telemetry_journal_delivered(int msg_id, bool delivered);
+
+/**
+ * @brief Wake the replay worker (e.g. when the link comes back)
+ */
+void telemetry_journal_kick(void);
+
+/**
+ * @brief Get journal statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t telemetry_journal_get_stats(telemetry_journal_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_JOURNAL_H
@@ -0,0 +1,883 @@
+/**
+ * @file telemetry_journal.c
+ * @brief Telemetry Journal Implementation
+ *
+ * Append-only log over the partition's 4 KB sectors, used as a ring:
+ *
+ *   sector: [8-byte sector header][record][record]...[erased]
+ *   record: [16-byte header][payload][pad to 4 bytes]
+ *
+ * Records are assembled in a RAM image of the current sector and
+ * programmed in batches: each write starts on the page boundary at or
+ * before the first unwritten byte and covers every record added since the
+ * previous write. A record is marked replayed by clearing its pending byte
+ * (a 1->0 bit write, no erase). Moving on to the next sector erases it,
+ * evicting whatever it still held. Sector headers carry an increasing
+ * sequence number, so the mount scan finds the newest sector and walks the
+ * others oldest-first to rebuild the pending counts and the replay cursor.
+ *
+ * A replayed record stays pending until the transport confirms delivery
+ * (telemetry_journal_delivered()), so a reset in between replays it again.
+ * Records awaiting confirmation are skipped by the cursor; one that is
+ * reported lost, or never answered, rewinds the cursor and goes out again.
+ */
+
+#include "telemetry_journal.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "TELEMETRY_JOURNAL";
+
+#define JOURNAL_SECTOR 4096
+#define JOURNAL_PAGE 256         // Flash program page; writes start on one
+#define JOURNAL_WRITE_BATCH 1024 // Unwritten bytes that trigger a write
+#define SECTOR_MAGIC 0x4C4E524A  // "JRNL"
+#define RECORD_MAGIC 0x4A53      // "SJ"; records before the tag byte used "RJ"
+#define RECORD_PENDING 0xFF
+#define RECORD_REPLAYED 0x00
+#define REPLAY_IDLE_MS 1000
+#define REPLAY_RETRY_MS 2000
+#define REPLAY_ACK_TIMEOUT_MS 60000 // Longer than the MQTT outbox expiry: no answer means lost
+#define UNMATCHED_MAX 4          // Confirmations that arrived before their msg_id was recorded
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;                       // Increases with every sector started
+} sector_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint16_t len;
+    uint32_t seq;
+    uint32_t crc;                       // CRC32 of the payload
+    uint8_t tag;                        // Caller's tag, handed back on replay
+    uint8_t check;                      // Byte sum of the fields above
+    uint8_t pending;                    // RECORD_PENDING until replayed
+    uint8_t reserved;
+} record_header_t;
+
+typedef enum {
+    INFLIGHT_FREE = 0,
+    INFLIGHT_SENT,                      // Waiting for the transport
+    INFLIGHT_DELIVERED,                 // Confirmed: release the record
+    INFLIGHT_LOST,                      // Given up: send the record again
+} inflight_state_t;
+
+// A replayed record awaiting confirmation
+typedef struct {
+    int msg_id;
+    uint8_t state;
+    uint16_t len;
+    uint32_t sector;
+    uint32_t offset;
+    uint32_t seq;
+    int64_t sent_us;
+} inflight_t;
+
+_Static_assert(sizeof(record_header_t) == 16, "journal record header must be 16 bytes");
+_Static_assert(TELEMETRY_JOURNAL_RECORD_MAX ==
+                   JOURNAL_SECTOR - sizeof(sector_header_t) - sizeof(record_header_t),
+               "TELEMETRY_JOURNAL_RECORD_MAX out of step with the sector layout");
+
+static const esp_partition_t *partition = NULL;
+static telemetry_journal_config_t journal_config;
+static SemaphoreHandle_t journal_mutex = NULL;
+static TaskHandle_t replay_handle = NULL;
+static uint32_t sectors = 0;
+static uint8_t *replay_buf = NULL;     // One sector: replayed payloads and mount scans
+
+// Current sector: RAM image, bytes used and bytes already programmed
+static uint8_t *sector_buf = NULL;
+static uint32_t cur_sector = 0;
+static uint32_t cur_sector_seq = 0;
+static uint32_t cur_fill = 0;
+static uint32_t cur_written = 0;
+static int64_t unwritten_since_us = 0; // 0 = nothing waiting for a write
+static uint32_t next_seq = 1;
+
+// Pending records per sector, and the oldest one
+static uint16_t *sector_pending = NULL;
+static uint16_t *sector_pending_bytes = NULL;
+static uint32_t rd_sector = 0;
+static uint32_t rd_offset = 0;
+
+// Confirmations come from the transport's task: state changes under a spinlock,
+// the replay worker does the flash work
+static portMUX_TYPE inflight_lock = portMUX_INITIALIZER_UNLOCKED;
+static inflight_t inflight[TELEMETRY_JOURNAL_INFLIGHT];
+static int unmatched[UNMATCHED_MAX];
+static uint8_t unmatched_next = 0;
+
+static telemetry_journal_stats_t stats = {0};
+static uint64_t write_bytes_total = 0;
+static uint64_t replay_bytes_total = 0;
+static uint64_t replay_us_total = 0;
+
+// ============================================================================
+// Record Helpers (call with journal_mutex held)
+// ============================================================================
+
+static uint32_t record_size(uint32_t len)
+{
+    return (sizeof(record_header_t) + len + 3) & ~3u;
+}
+
+static uint8_t header_check(const record_header_t *hdr)
+{
+    const uint8_t *p = (const uint8_t *)hdr;
+    uint8_t sum = 0;
+    for (size_t i = 0; i < offsetof(record_header_t, check); i++)
+    {
+        sum += p[i];
+    }
+    return sum;
+}
+
+// A torn or erased header ends the sector's records
+static bool header_valid(const record_header_t *hdr, uint32_t offset)
+{
+    return hdr->magic == RECORD_MAGIC && hdr->check == header_check(hdr) &&
+           offset + record_size(hdr->len) <= JOURNAL_SECTOR;
+}
+
+static uint32_t sector_addr(uint32_t sector)
+{
+    return sector * JOURNAL_SECTOR;
+}
+
+// The current sector is read from its RAM image, which may be ahead of flash
+static esp_err_t read_bytes(uint32_t sector, uint32_t offset, void *dst, size_t len)
+{
+    if (sector == cur_sector)
+    {
+        memcpy(dst, sector_buf + offset, len);
+        return ESP_OK;
+    }
+    return esp_partition_read(partition, sector_addr(sector) + offset, dst, len);
+}
+
+// Program everything appended since the last write
+static esp_err_t write_locked(void)
+{
+    if (cur_written >= cur_fill)
+    {
+        unwritten_since_us = 0;
+        return ESP_OK;
+    }
+
+    // Bytes between the page start and cur_written are rewritten unchanged
+    uint32_t start = cur_written / JOURNAL_PAGE * JOURNAL_PAGE;
+    esp_err_t err = esp_partition_write(partition, sector_addr(cur_sector) + start, sector_buf + start,
+                                        cur_fill - start);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Write at 0x%lx failed: %s", sector_addr(cur_sector) + start, esp_err_to_name(err));
+        return err;
+    }
+
+    stats.flash_writes++;
+    stats.unwritten = 0;
+    write_bytes_total += cur_fill - cur_written;
+    cur_written = cur_fill;
+    unwritten_since_us = 0;
+    return ESP_OK;
+}
+
+static bool write_due(void)
+{
+    return unwritten_since_us &&
+           esp_timer_get_time() - unwritten_since_us >= (int64_t)journal_config.flush_ms * 1000;
+}
+
+static void drop_pending(uint32_t sector)
+{
+    stats.pending -= sector_pending[sector];
+    stats.pending_bytes -= sector_pending_bytes[sector];
+    sector_pending[sector] = 0;
+    sector_pending_bytes[sector] = 0;
+}
+
+// Finish the current sector and erase the next one, evicting what it holds
+static esp_err_t next_sector_locked(void)
+{
+    esp_err_t err = write_locked();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    uint32_t next = (cur_sector + 1) % sectors;
+    if (sector_pending[next] > 0)
+    {
+        ESP_LOGW(TAG, "Journal full, %u oldest messages overwritten", sector_pending[next]);
+        stats.evicted += sector_pending[next];
+        drop_pending(next);
+        portENTER_CRITICAL(&inflight_lock);
+        for (int i = 0; i < TELEMETRY_JOURNAL_INFLIGHT; i++)
+        {
+            if (inflight[i].state != INFLIGHT_FREE && inflight[i].sector == next)
+            {
+                inflight[i].state = INFLIGHT_FREE;
+            }
+        }
+        portEXIT_CRITICAL(&inflight_lock);
+        if (rd_sector == next)
+        {
+            rd_sector = (next + 1) % sectors;
+            rd_offset = sizeof(sector_header_t);
+        }
+    }
+
+    err = esp_partition_erase_range(partition, sector_addr(next), JOURNAL_SECTOR);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Erase of sector %lu failed: %s", next, esp_err_to_name(err));
+        return err;
+    }
+
+    const sector_header_t hdr = {.magic = SECTOR_MAGIC, .seq = ++cur_sector_seq};
+    cur_sector = next;
+    memset(sector_buf, 0xFF, JOURNAL_SECTOR);
+    memcpy(sector_buf, &hdr, sizeof(hdr));
+    cur_fill = sizeof(hdr);
+    cur_written = 0;
+    return ESP_OK;
+}
+
+static uint32_t inflight_used(void)
+{
+    uint32_t used = 0;
+    portENTER_CRITICAL(&inflight_lock);
+    for (int i = 0; i < TELEMETRY_JOURNAL_INFLIGHT; i++)
+    {
+        used += inflight[i].state != INFLIGHT_FREE;
+    }
+    portEXIT_CRITICAL(&inflight_lock);
+    return used;
+}
+
+static bool inflight_at(uint32_t sector, uint32_t offset)
+{
+    bool found = false;
+    portENTER_CRITICAL(&inflight_lock);
+    for (int i = 0; i < TELEMETRY_JOURNAL_INFLIGHT && !found; i++)
+    {
+        found = inflight[i].state != INFLIGHT_FREE && inflight[i].sector == sector &&
+                inflight[i].offset == offset;
+    }
+    portEXIT_CRITICAL(&inflight_lock);
+    return found;
+}
+
+// Move the replay cursor onto the oldest pending record not awaiting confirmation
+static esp_err_t find_pending_locked(record_header_t *hdr)
+{
+    uint32_t awaiting = inflight_used();
+    if (stats.pending <= awaiting)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Sectors without pending records are skipped whole; a full lap means
+    // the counters are out of step with the log
+    uint32_t laps = 0;
+    while (laps <= sectors)
+    {
+        bool end = sector_pending[rd_sector] == 0 ||
+                   rd_offset + sizeof(*hdr) > JOURNAL_SECTOR ||
+                   read_bytes(rd_sector, rd_offset, hdr, sizeof(*hdr)) != ESP_OK ||
+                   !header_valid(hdr, rd_offset);
+        if (end)
+        {
+            rd_sector = (rd_sector + 1) % sectors;
+            rd_offset = sizeof(sector_header_t);
+            laps++;
+            continue;
+        }
+        if (hdr->pending == RECORD_PENDING && (awaiting == 0 || !inflight_at(rd_sector, rd_offset)))
+        {
+            return ESP_OK;
+        }
+        rd_offset += record_size(hdr->len);
+    }
+
+    ESP_LOGE(TAG, "%lu pending messages not found, resetting the count", stats.pending);
+    for (uint32_t i = 0; i < sectors; i++)
+    {
+        drop_pending(i);
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+static void release_locked(uint32_t sector, uint32_t offset, const record_header_t *hdr)
+{
+    const uint8_t replayed = RECORD_REPLAYED;
+    uint32_t at = offset + offsetof(record_header_t, pending);
+    if (sector == cur_sector)
+    {
+        sector_buf[at] = RECORD_REPLAYED;
+    }
+    if (sector != cur_sector || at < cur_written)
+    {
+        esp_partition_write(partition, sector_addr(sector) + at, &replayed, 1);
+    }
+
+    sector_pending[sector]--;
+    sector_pending_bytes[sector] -= hdr->len;
+    stats.pending--;
+    stats.pending_bytes -= hdr->len;
+    if (sector == rd_sector && offset == rd_offset)
+    {
+        rd_offset += record_size(hdr->len);
+    }
+}
+
+// False if the record's sector was overwritten since it was read
+static bool record_unchanged(uint32_t sector, uint32_t offset, uint32_t seq)
+{
+    record_header_t now;
+    return read_bytes(sector, offset, &now, sizeof(now)) == ESP_OK && now.magic == RECORD_MAGIC &&
+           now.seq == seq && now.pending == RECORD_PENDING;
+}
+
+// Back to the oldest sector with pending records, so lost ones go out again
+static void rewind_locked(void)
+{
+    for (uint32_t k = 1; k <= sectors; k++)
+    {
+        uint32_t s = (cur_sector + k) % sectors;
+        if (sector_pending[s] > 0)
+        {
+            rd_sector = s;
+            rd_offset = sizeof(sector_header_t);
+            return;
+        }
+    }
+}
+
+// Release confirmed records and requeue lost or unanswered ones
+static void settle_locked(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool rewind = false;
+
+    for (int i = 0; i < TELEMETRY_JOURNAL_INFLIGHT; i++)
+    {
+        portENTER_CRITICAL(&inflight_lock);
+        inflight_t entry = inflight[i];
+        bool done = entry.state == INFLIGHT_DELIVERED || entry.state == INFLIGHT_LOST ||
+                    (entry.state == INFLIGHT_SENT && now_us - entry.sent_us >= REPLAY_ACK_TIMEOUT_MS * 1000LL);
+        if (done)
+        {
+            inflight[i].state = INFLIGHT_FREE;
+        }
+        portEXIT_CRITICAL(&inflight_lock);
+        if (!done)
+        {
+            continue;
+        }
+
+        if (entry.state == INFLIGHT_DELIVERED)
+        {
+            if (record_unchanged(entry.sector, entry.offset, entry.seq))
+            {
+                const record_header_t hdr = {.len = entry.len};
+                release_locked(entry.sector, entry.offset, &hdr);
+                stats.replayed++;
+                replay_bytes_total += entry.len;
+            }
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Message %lu %s, replaying it again", entry.seq,
+                     entry.state == INFLIGHT_LOST ? "lost in transit" : "never confirmed");
+            stats.resent++;
+            rewind = true;
+        }
+    }
+
+    if (rewind)
+    {
+        rewind_locked();
+    }
+}
+
+// ============================================================================
+// Mount
+// ============================================================================
+
+// Count the pending records of one sector image; returns the end of its records
+static uint32_t walk_sector(uint32_t sector, const uint8_t *image, uint32_t *max_seq)
+{
+    uint32_t offset = sizeof(sector_header_t);
+    while (offset + sizeof(record_header_t) <= JOURNAL_SECTOR)
+    {
+        record_header_t hdr;
+        memcpy(&hdr, image + offset, sizeof(hdr));
+        if (!header_valid(&hdr, offset))
+        {
+            break;
+        }
+
+        if (hdr.pending == RECORD_PENDING)
+        {
+            if (stats.pending == 0)
+            {
+                rd_sector = sector;
+                rd_offset = offset;
+            }
+            sector_pending[sector]++;
+            sector_pending_bytes[sector] += hdr.len;
+            stats.pending++;
+            stats.pending_bytes += hdr.len;
+        }
+        if (hdr.seq > *max_seq)
+        {
+            *max_seq = hdr.seq;
+        }
+        offset += record_size(hdr.len);
+    }
+    return offset;
+}
+
+static esp_err_t journal_mount(void)
+{
+    // The newest sector is the one written last
+    uint32_t newest = UINT32_MAX;
+    for (uint32_t i = 0; i < sectors; i++)
+    {
+        sector_header_t hdr;
+        if (esp_partition_read(partition, sector_addr(i), &hdr, sizeof(hdr)) == ESP_OK &&
+            hdr.magic == SECTOR_MAGIC && (newest == UINT32_MAX || hdr.seq > cur_sector_seq))
+        {
+            newest = i;
+            cur_sector_seq = hdr.seq;
+        }
+    }
+
+    if (newest == UINT32_MAX)
+    {
+        // Blank journal: start at sector 0
+        cur_sector = sectors - 1;
+        cur_sector_seq = 0;
+        return next_sector_locked();
+    }
+
+    // Oldest-first: the sectors after the newest one, wrapping around
+    uint32_t max_seq = 0;
+    for (uint32_t k = 1; k <= sectors; k++)
+    {
+        uint32_t s = (newest + k) % sectors;
+        uint8_t *image = s == newest ? sector_buf : replay_buf;
+        sector_header_t hdr;
+        bool readable = esp_partition_read(partition, sector_addr(s), image, JOURNAL_SECTOR) == ESP_OK;
+        memcpy(&hdr, image, sizeof(hdr));
+        if (s == newest)
+        {
+            cur_sector = s;
+            cur_fill = cur_written = JOURNAL_SECTOR; // Sealed unless it reads back intact
+        }
+        if (!readable || hdr.magic != SECTOR_MAGIC)
+        {
+            continue;
+        }
+
+        uint32_t end = walk_sector(s, image, &max_seq);
+        if (s == newest)
+        {
+            cur_fill = end;
+            cur_written = end;
+            // Anything programmed past the last good record is a torn write:
+            // appending over it would corrupt the new records, so seal the sector
+            for (uint32_t i = end; i < JOURNAL_SECTOR; i++)
+            {
+                if (sector_buf[i] != 0xFF)
+                {
+                    ESP_LOGW(TAG, "Torn write in sector %lu at %lu, sector sealed", s, end);
+                    cur_fill = cur_written = JOURNAL_SECTOR;
+                    break;
+                }
+            }
+        }
+    }
+    next_seq = max_seq + 1;
+    return ESP_OK;
+}
+
+// ============================================================================
+// Replay Worker
+// ============================================================================
+
+// Send the oldest pending record; it is released once delivery is confirmed
+static esp_err_t replay_one(void)
+{
+    record_header_t hdr;
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    esp_err_t err = find_pending_locked(&hdr);
+    uint32_t sector = rd_sector;
+    uint32_t offset = rd_offset;
+    if (err == ESP_OK)
+    {
+        err = read_bytes(sector, offset + sizeof(hdr), replay_buf, hdr.len);
+    }
+    xSemaphoreGive(journal_mutex);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    // Sent without the lock so appends are not held up by the network
+    bool intact = esp_rom_crc32_le(0, replay_buf, hdr.len) == hdr.crc;
+    int msg_id = 0;
+    if (intact)
+    {
+        err = journal_config.send(hdr.tag, replay_buf, hdr.len, &msg_id, journal_config.ctx);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Message %lu failed CRC, skipped", hdr.seq);
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    // Nothing to do if its sector was overwritten meanwhile
+    if (record_unchanged(sector, offset, hdr.seq))
+    {
+        bool confirmed = !intact || msg_id <= 0;
+        portENTER_CRITICAL(&inflight_lock);
+        for (int i = 0; i < UNMATCHED_MAX && !confirmed; i++)
+        {
+            if (unmatched[i] == msg_id)
+            {
+                unmatched[i] = 0; // Confirmed before we got here
+                confirmed = true;
+            }
+        }
+        for (int i = 0; i < TELEMETRY_JOURNAL_INFLIGHT && !confirmed; i++)
+        {
+            if (inflight[i].state == INFLIGHT_FREE)
+            {
+                inflight[i] = (inflight_t){.msg_id = msg_id, .state = INFLIGHT_SENT, .len = hdr.len,
+                                           .sector = sector, .offset = offset, .seq = hdr.seq,
+                                           .sent_us = esp_timer_get_time()};
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&inflight_lock);
+
+        if (confirmed)
+        {
+            release_locked(sector, offset, &hdr);
+            if (intact)
+            {
+                stats.replayed++;
+                replay_bytes_total += hdr.len;
+            }
+            else
+            {
+                stats.corrupt++;
+            }
+        }
+        else if (rd_sector == sector && rd_offset == offset)
+        {
+            rd_offset += record_size(hdr.len); // Awaiting confirmation: move on
+        }
+    }
+    xSemaphoreGive(journal_mutex);
+    return ESP_OK;
+}
+
+static void replay_task(void *pvParameters)
+{
+    uint16_t per_s = journal_config.replay_per_s ? journal_config.replay_per_s : 1;
+    TickType_t gap = pdMS_TO_TICKS(1000 / per_s);
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(REPLAY_IDLE_MS));
+
+        // Rate-limited, so live telemetry keeps most of the link; at most
+        // TELEMETRY_JOURNAL_INFLIGHT records wait for confirmation
+        while (stats.pending > 0 && journal_config.ready(journal_config.ctx))
+        {
+            xSemaphoreTake(journal_mutex, portMAX_DELAY);
+            settle_locked();
+            xSemaphoreGive(journal_mutex);
+            if (inflight_used() >= TELEMETRY_JOURNAL_INFLIGHT)
+            {
+                break; // A confirmation wakes us
+            }
+
+            int64_t start_us = esp_timer_get_time();
+            esp_err_t err = replay_one();
+            if (err == ESP_ERR_NOT_FOUND)
+            {
+                break;
+            }
+            if (err != ESP_OK)
+            {
+                vTaskDelay(pdMS_TO_TICKS(REPLAY_RETRY_MS));
+                break;
+            }
+            vTaskDelay(gap);
+
+            xSemaphoreTake(journal_mutex, portMAX_DELAY);
+            replay_us_total += esp_timer_get_time() - start_us;
+            if (write_due())
+            {
+                write_locked();
+            }
+            xSemaphoreGive(journal_mutex);
+        }
+
+        xSemaphoreTake(journal_mutex, portMAX_DELAY);
+        settle_locked();
+        if (write_due())
+        {
+            write_locked();
+        }
+        xSemaphoreGive(journal_mutex);
+    }
+}
+
+// Undo a partial telemetry_journal_start()
+static void journal_release(void)
+{
+    heap_caps_free(sector_buf);
+    heap_caps_free(replay_buf);
+    free(sector_pending);
+    free(sector_pending_bytes);
+    sector_buf = NULL;
+    replay_buf = NULL;
+    sector_pending = NULL;
+    sector_pending_bytes = NULL;
+    if (journal_mutex)
+    {
+        vSemaphoreDelete(journal_mutex);
+        journal_mutex = NULL;
+    }
+    partition = NULL;
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t telemetry_journal_start(const telemetry_journal_config_t *config)
+{
+    if (!config || !config->send || !config->ready)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (partition)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                           TELEMETRY_JOURNAL_PARTITION);
+    if (!part)
+    {
+        ESP_LOGE(TAG, "Partition '%s' not found", TELEMETRY_JOURNAL_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (part->size < 2 * JOURNAL_SECTOR)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    journal_config = *config;
+    sectors = part->size / JOURNAL_SECTOR;
+    sector_buf = heap_caps_malloc(JOURNAL_SECTOR, MALLOC_CAP_SPIRAM);
+    replay_buf = heap_caps_malloc(JOURNAL_SECTOR, MALLOC_CAP_SPIRAM);
+    sector_pending = calloc(sectors, sizeof(uint16_t));
+    sector_pending_bytes = calloc(sectors, sizeof(uint16_t));
+    journal_mutex = xSemaphoreCreateMutex();
+    if (!sector_buf || !replay_buf || !sector_pending || !sector_pending_bytes || !journal_mutex)
+    {
+        ESP_LOGE(TAG, "Failed to allocate journal buffers");
+        journal_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    partition = part;
+    stats.capacity_bytes = part->size;
+
+    int64_t scan_start_us = esp_timer_get_time();
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    esp_err_t err = journal_mount();
+    stats.recovered = stats.pending;
+    xSemaphoreGive(journal_mutex);
+    stats.mount_ms = (uint32_t)((esp_timer_get_time() - scan_start_us) / 1000);
+    if (err != ESP_OK)
+    {
+        journal_release();
+        return err;
+    }
+    ESP_LOGI(TAG, "Mounted %lu KB at 0x%lx: %lu messages pending (%lu bytes), scan %lu ms",
+             part->size / 1024, part->address, stats.pending, stats.pending_bytes, stats.mount_ms);
+
+    if (xTaskCreatePinnedToCore(replay_task, "journal_replay", 3072, NULL, 3, &replay_handle,
+                                config->replay_core) != pdPASS)
+    {
+        journal_release();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t telemetry_journal_append(uint8_t tag, const void *data, size_t len)
+{
+    if (!data || len == 0 || len > TELEMETRY_JOURNAL_RECORD_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!partition)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t size = record_size(len);
+    record_header_t hdr = {
+        .magic = RECORD_MAGIC,
+        .len = (uint16_t)len,
+        .crc = esp_rom_crc32_le(0, data, len),
+        .tag = tag,
+        .pending = RECORD_PENDING,
+        .reserved = 0xFF,
+    };
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    if (cur_fill + size > JOURNAL_SECTOR)
+    {
+        err = next_sector_locked();
+    }
+
+    if (err == ESP_OK)
+    {
+        hdr.seq = next_seq++;
+        hdr.check = header_check(&hdr);
+        if (stats.pending == 0)
+        {
+            rd_sector = cur_sector;
+            rd_offset = cur_fill;
+        }
+        memcpy(sector_buf + cur_fill, &hdr, sizeof(hdr));
+        memcpy(sector_buf + cur_fill + sizeof(hdr), data, len);
+        cur_fill += size;
+
+        sector_pending[cur_sector]++;
+        sector_pending_bytes[cur_sector] += len;
+        stats.pending++;
+        stats.pending_bytes += len;
+        stats.appended++;
+        stats.unwritten++;
+        if (!unwritten_since_us)
+        {
+            unwritten_since_us = esp_timer_get_time();
+        }
+
+        if (journal_config.flush_ms == 0 || cur_fill - cur_written >= JOURNAL_WRITE_BATCH)
+        {
+            err = write_locked();
+        }
+    }
+    xSemaphoreGive(journal_mutex);
+    return err;
+}
+
+esp_err_t telemetry_journal_flush(void)
+{
+    if (!partition)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    esp_err_t err = write_locked();
+    xSemaphoreGive(journal_mutex);
+    return err;
+}
+
+void telemetry_journal_delivered(int msg_id, bool delivered)
+{
+    if (msg_id <= 0)
+    {
+        return;
+    }
+
+    bool found = false;
+    portENTER_CRITICAL(&inflight_lock);
+    for (int i = 0; i < TELEMETRY_JOURNAL_INFLIGHT && !found; i++)
+    {
+        if (inflight[i].state == INFLIGHT_SENT && inflight[i].msg_id == msg_id)
+        {
+            inflight[i].state = delivered ? INFLIGHT_DELIVERED : INFLIGHT_LOST;
+            found = true;
+        }
+    }
+    if (!found && delivered)
+    {
+        // Possibly ours, confirmed before replay_one() recorded it
+        unmatched[unmatched_next] = msg_id;
+        unmatched_next = (unmatched_next + 1) % UNMATCHED_MAX;
+    }
+    portEXIT_CRITICAL(&inflight_lock);
+
+    if (found)
+    {
+        telemetry_journal_kick();
+    }
+}
+
+void telemetry_journal_kick(void)
+{
+    if (replay_handle)
+    {
+        xTaskNotifyGive(replay_handle);
+    }
+}
+
+esp_err_t telemetry_journal_get_stats(telemetry_journal_stats_t *out)
+{
+    if (!out)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!partition)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    *out = stats;
+    out->inflight = inflight_used();
+    out->fill_percent = (uint8_t)((uint64_t)stats.pending_bytes * 100 / stats.capacity_bytes);
+    if (stats.flash_writes > 0)
+    {
+        out->bytes_per_write = (uint32_t)(write_bytes_total / stats.flash_writes);
+    }
+    if (replay_us_total > 0)
+    {
+        out->drain_rate = stats.replayed * 1e6f / replay_us_total;
+        out->drain_bps = (uint32_t)(replay_bytes_total * 1000000 / replay_us_total);
+    }
+    xSemaphoreGive(journal_mutex);
+    return ESP_OK;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file timelapse.h
+ * @brief Time-Lapse Capture with Deep-Sleep Duty Cycling
+ */
+
+#ifndef TIMELAPSE_H
+#define TIMELAPSE_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Supply current per phase, used to estimate the average current
+ */
+typedef struct {
+    float active_ma;                 // CPU + camera + flash while awake
+    float wifi_ma;                   // Added while WiFi is up for an upload
+    float sleep_ma;                  // Deep sleep (board total, incl. regulators)
+} timelapse_power_model_t;
+
+/**
+ * @brief Time-lapse configuration
+ */
+typedef struct {
+    uint32_t interval_s;             // Wake-to-wake period
+    const char *upload_url;          // HTTP endpoint for spooled frames
+    uint16_t upload_every;           // Bring up WiFi and drain the spool every Nth wake (0 = never)
+    uint32_t wifi_timeout_ms;        // Give up on the link after this long
+    uint32_t drain_timeout_ms;       // Longest time spent uploading per wake
+    timelapse_power_model_t power;
+} timelapse_config_t;
+
+/**
+ * @brief Time-lapse statistics (kept in RTC memory across deep sleep)
+ */
+typedef struct {
+    uint32_t wakes;                  // Wakes since power-on
+    uint32_t frames;                 // Frames spooled
+    uint32_t capture_failed;         // Wakes without a frame
+    uint32_t spool_failed;           // Frames captured but lost to a failed spool write
+    uint32_t uploads;                // Wakes that brought up WiFi
+    uint32_t last_awake_ms;          // Wake-to-sleep of the previous wake, bootloader included
+    uint32_t avg_awake_ms;           // Average wake-to-sleep
+    uint32_t last_boot_ms;           // Timer expiry to app_main (ROM + bootloader + startup)
+    uint32_t last_camera_ms;         // Camera init to first settled frame
+    uint32_t last_spool_ms;          // Spool mount + frame write
+    uint32_t last_upload_ms;         // WiFi bring-up + drain (0 = no upload that wake)
+    float avg_current_ma;            // Estimated from the power model over all completed cycles
+} timelapse_stats_t;
+
+/**
+ * @brief Run one time-lapse wake and enter deep sleep; never returns
+ *
+ * Warm-starts the camera from the exposure kept in RTC memory, captures a
+ * settled frame, spools it to flash and, every upload_every wakes, brings
+ * up WiFi and drains the spool. Call early in app_main: the spool index and
+ * the statistics survive deep sleep in RTC memory, so nothing is rescanned.
+ *
+ * @param config Time-lapse configuration
+ */
+void timelapse_run(const timelapse_config_t *config);
+
+/**
+ * @brief Get time-lapse statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t timelapse_get_stats(timelapse_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMELAPSE_H
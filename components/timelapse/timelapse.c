@@ -0,0 +1,268 @@
+/**
+ * @file timelapse.c
+ * @brief Time-Lapse Capture with Deep-Sleep Duty Cycling
+ *
+ * Every wake is a fresh boot: capture, spool, optionally upload, sleep.
+ * The camera warm-starts from the exposure kept in RTC memory, the spool
+ * mounts from its RTC state without a partition scan, and the timing and
+ * statistics below live in RTC memory as well.
+ *
+ * There is no current sensor on the board, so the average current is an
+ * estimate: the measured awake, WiFi and sleep times weighted with the
+ * configured per-phase currents.
+ */
+
+#include "timelapse.h"
+#include "cam_config.h"
+#include "image_spool.h"
+#include "app_network.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+static const char *TAG = "TIMELAPSE";
+
+#define TIMELAPSE_MAX_IMAGE (200 * 1024)
+#define RTC_MAGIC 0x314C5054 // "TPL1"
+
+// Spool record metadata
+typedef struct __attribute__((packed)) {
+    uint8_t kind;
+    uint32_t wake;
+    uint32_t clock_s; // RTC clock at capture (seconds since power-on unless set)
+} timelapse_meta_t;
+
+_Static_assert(sizeof(timelapse_meta_t) <= IMAGE_SPOOL_META_SIZE, "timelapse meta too large");
+
+// State carried across deep sleep
+typedef struct {
+    uint32_t magic;
+    timelapse_stats_t stats;
+    int64_t sleep_enter_us;   // RTC clock when the previous wake went to sleep
+    uint64_t planned_sleep_us;
+    uint64_t awake_ms_total;
+    float charge_mas;         // Estimated charge over all completed cycles (mA*s)
+    float cycle_s;            // Time those cycles span
+} timelapse_rtc_t;
+
+static RTC_NOINIT_ATTR timelapse_rtc_t rtc;
+
+static const timelapse_config_t *tl_config = NULL;
+static volatile bool link_up = false;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+// RTC clock: keeps counting through deep sleep, unlike esp_timer
+static int64_t rtc_clock_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static bool spool_ready(void *ctx)
+{
+    return link_up;
+}
+
+static esp_err_t spool_send(const uint8_t *data, size_t len, const image_spool_meta_t *spool, void *ctx)
+{
+    timelapse_meta_t meta;
+    memcpy(&meta, spool->meta, sizeof(meta));
+
+    const char *url = tl_config->upload_url;
+    char tl_url[192];
+    if (meta.kind == IMAGE_SPOOL_KIND_TIMELAPSE)
+    {
+        snprintf(tl_url, sizeof(tl_url), "%s%ctimelapse=%lu&clock=%lu", url,
+                 strchr(url, '?') ? '&' : '?', meta.wake, meta.clock_s);
+        url = tl_url;
+    }
+    return app_network_upload_image_stream(url, data, len, NULL, NULL);
+}
+
+// Book the cycle that ended with this wake; returns the timer expiry, or
+// app start after a reset (the bootloader time is then unknown)
+static int64_t account_previous_cycle(int64_t wake_us, int64_t app_start_us,
+                                      const timelapse_power_model_t *power)
+{
+    if (rtc.magic != RTC_MAGIC)
+    {
+        memset(&rtc, 0, sizeof(rtc));
+        rtc.magic = RTC_MAGIC;
+        return app_start_us;
+    }
+
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER)
+    {
+        return app_start_us;
+    }
+
+    int64_t boot_us = wake_us - rtc.sleep_enter_us - (int64_t)rtc.planned_sleep_us;
+    rtc.stats.last_boot_ms = boot_us > 0 ? (uint32_t)(boot_us / 1000) : 0;
+
+    // The previous cycle: its awake time plus the sleep that followed it
+    float sleep_s = rtc.planned_sleep_us / 1e6f;
+    float awake_s = rtc.stats.last_awake_ms / 1000.0f;
+    float wifi_s = rtc.stats.last_upload_ms / 1000.0f;
+    rtc.charge_mas += awake_s * power->active_ma + wifi_s * power->wifi_ma + sleep_s * power->sleep_ma;
+    rtc.cycle_s += awake_s + sleep_s;
+    rtc.stats.avg_current_ma = rtc.cycle_s > 0 ? rtc.charge_mas / rtc.cycle_s : 0;
+    return rtc.sleep_enter_us + (int64_t)rtc.planned_sleep_us;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void timelapse_run(const timelapse_config_t *config)
+{
+    int64_t wake_us = rtc_clock_us();
+    // esp_timer starts with the app; the bootloader time comes from the RTC clock
+    int64_t app_start_us = wake_us - esp_timer_get_time();
+    tl_config = config;
+
+    int64_t wake_start_us = account_previous_cycle(wake_us, app_start_us, &config->power);
+    timelapse_stats_t *st = &rtc.stats;
+    st->wakes++;
+    st->last_camera_ms = 0;
+    ESP_LOGI(TAG, "Wake %lu (boot %lu ms, last awake %lu ms, avg %.2f mA, %lu capture / %lu spool failures)",
+             st->wakes, st->last_boot_ms, st->last_awake_ms, st->avg_current_ma, st->capture_failed,
+             st->spool_failed);
+
+    int64_t t0 = esp_timer_get_time();
+    image_spool_config_t spool_cfg = {
+        .max_image_size = TIMELAPSE_MAX_IMAGE,
+        .send = spool_send,
+        .ready = spool_ready,
+        .drain_core = 0,
+    };
+    bool spool_ok = image_spool_start(&spool_cfg) == ESP_OK;
+    st->last_spool_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+
+    // Camera: warm start, settle, one frame
+    t0 = esp_timer_get_time();
+    camera_fb_t *fb = NULL;
+    if (cam_config_init() == ESP_OK)
+    {
+        cam_startup_stats_t startup;
+        if (cam_config_measure_startup(&startup) == ESP_OK)
+        {
+            st->last_camera_ms = startup.first_good_ms;
+        }
+        fb = cam_config_capture();
+    }
+    if (!st->last_camera_ms)
+    {
+        st->last_camera_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    }
+
+    if (fb && spool_ok)
+    {
+        t0 = esp_timer_get_time();
+        timelapse_meta_t meta = {
+            .kind = IMAGE_SPOOL_KIND_TIMELAPSE,
+            .wake = st->wakes,
+            .clock_s = (uint32_t)(rtc_clock_us() / 1000000),
+        };
+        uint8_t raw[IMAGE_SPOOL_META_SIZE] = {0};
+        memcpy(raw, &meta, sizeof(meta));
+        if (image_spool_write(fb->buf, fb->len, raw, NULL, 0) == ESP_OK)
+        {
+            st->frames++;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Frame lost: spool write failed");
+            st->spool_failed++;
+        }
+        st->last_spool_ms += (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    }
+    else if (fb)
+    {
+        ESP_LOGW(TAG, "Frame lost: spool not mounted");
+        st->spool_failed++;
+    }
+    else
+    {
+        ESP_LOGW(TAG, "No frame this wake");
+        st->capture_failed++;
+    }
+    if (fb)
+    {
+        cam_config_return_fb(fb);
+        cam_config_warm_snapshot();
+    }
+    cam_config_deinit();
+
+    // Upload every Nth wake
+    st->last_upload_ms = 0;
+    if (spool_ok && config->upload_every > 0 && st->wakes % config->upload_every == 0)
+    {
+        t0 = esp_timer_get_time();
+        st->uploads++;
+        if (app_network_init() == ESP_OK && app_network_wait_connected(config->wifi_timeout_ms))
+        {
+            link_up = true;
+            if (image_spool_flush(config->drain_timeout_ms) != ESP_OK)
+            {
+                ESP_LOGW(TAG, "Spool not drained within %lu ms", config->drain_timeout_ms);
+            }
+            link_up = false;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "No link, frames stay spooled");
+        }
+        st->last_upload_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    }
+
+    image_spool_stats_t spool;
+    if (spool_ok && image_spool_get_stats(&spool) == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Spool: %lu pending (%u%%), mount %lu ms%s", spool.pending, spool.fill_percent,
+                 spool.mount_ms, spool.mount_fast ? " from RTC" : "");
+    }
+
+    // Close the books on this wake and sleep out the rest of the period
+    int64_t sleep_us = rtc_clock_us();
+    st->last_awake_ms = (uint32_t)((sleep_us - wake_start_us) / 1000);
+    rtc.awake_ms_total += st->last_awake_ms;
+    st->avg_awake_ms = (uint32_t)(rtc.awake_ms_total / st->wakes);
+
+    uint64_t period_us = (uint64_t)config->interval_s * 1000000;
+    uint64_t awake_us = (uint64_t)st->last_awake_ms * 1000;
+    rtc.planned_sleep_us = awake_us < period_us ? period_us - awake_us : 1000000;
+    rtc.sleep_enter_us = sleep_us;
+
+    ESP_LOGI(TAG, "Awake %lu ms (camera %lu, spool %lu, upload %lu), sleeping %llu ms",
+             st->last_awake_ms, st->last_camera_ms, st->last_spool_ms, st->last_upload_ms,
+             rtc.planned_sleep_us / 1000);
+
+    esp_sleep_enable_timer_wakeup(rtc.planned_sleep_us);
+    esp_deep_sleep_start();
+}
+
+esp_err_t timelapse_get_stats(timelapse_stats_t *stats)
+{
+    if (!stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (rtc.magic != RTC_MAGIC)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *stats = rtc.stats;
+    return ESP_OK;
+}
@@ -6,13 +6,20 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
 #include "nvs_flash.h"
+#include "nvs.h"
 #include "esp_psram.h"
 #include "driver/uart.h"
 
@@ -24,6 +31,13 @@
 #include "sensor_bme680.h"
 #include "sensor_mpu6050.h"
 #include "gps_neo6m.h"
+#include "cam_pipeline.h"
+#include "live_view.h"
+#include "image_spool.h"
+#include "timelapse.h"
+#include "telemetry.h"
+#include "json_writer.h"
+#include "telemetry_journal.h"
 
 static const char *TAG = "MAIN";
 
@@ -33,7 +47,439 @@ static const char *TAG = "MAIN";
 #define DEVICE_ID "ESP32_Train_01"
 #define MQTT_BROKER_URI "mqtt://192.168.0.103:1883" // Change to your PC IP
 #define MQTT_TOPIC "train/data/" DEVICE_ID
+#define MQTT_TOPIC_CBOR "train/cbor/" DEVICE_ID // Decode with tools/telemetry_decode.py
+#define TELEMETRY_JSON true // Publish samples as JSON on MQTT_TOPIC
+#define TELEMETRY_CBOR false // Publish samples as CBOR on MQTT_TOPIC_CBOR (both topics may run at once)
+#define TELEMETRY_BENCH_ROUNDS 100 // Encode benchmark on the first sample (0 = off)
 #define SENSOR_READ_INTERVAL_MS 5000 // 5 seconds
+#define TELEMETRY_BATCH_SAMPLES 6 // Samples per MQTT message (1 = one message per sample)
+#define TELEMETRY_BATCH_BYTES 4000 // Payload limit per message (<= TELEMETRY_JOURNAL_RECORD_MAX)
+#define TELEMETRY_BATCH_AGE_MS 30000 // Oldest sample waits at most this long
+#define TELEMETRY_AB_PERIOD_MS 0 // > 0: alternate batched / single publishing to compare both
+#define JOURNAL_REPLAY_PER_S 2 // Journaled messages replayed per second after a reconnect
+#define JOURNAL_FLUSH_MS 2000 // Offline telemetry reaches flash within about 2 s (+1 s worker poll)
+#define JOURNAL_OUTAGE_TEST_S 0 // > 0: self-test: fake an outage this long, restart inside it, check the replay
+// MQTT outbox budgets (bytes of a stream's own unacknowledged messages); their
+// sum stays below the 512 KB client outbox, so no stream can fill another's share
+#define MQTT_TELEMETRY_INFLIGHT 4 // Unacknowledged telemetry messages; beyond that batches are journaled
+#define MQTT_TELEMETRY_OUTBOX_KB 64
+#define MQTT_REPLAY_INFLIGHT 2 // Journal replay keeps at most this many messages unacknowledged
+#define MQTT_REPLAY_OUTBOX_KB 32
+#define MQTT_IMAGE_INFLIGHT 4 // 8 KB chunks in flight per image
+#define MQTT_IMAGE_OUTBOX_KB 256
+#define IMAGE_UPLOAD_URL "http://192.168.0.103:8080/upload" // Change to your PC IP
+#define IMAGE_MQTT_TOPIC "train/image/" DEVICE_ID
+#define IMAGE_TRANSPORT CAM_TRANSPORT_HTTP // or CAM_TRANSPORT_MQTT (see tools/mqtt_image_reassemble.py)
+#define IMAGE_BATCH_URL "http://192.168.0.103:8080/upload/batch" // Multipart batches of spooled images
+#define SPOOL_BATCH 4 // Spooled images per batch request
+#define SNAPSHOT_RECORDS true // Send each frame together with the sensor readings at capture time
+#define RESUMABLE_UPLOAD false // true if the server speaks Content-Range (see tools/mock_upload_server.py)
+#define CAPTURE_INTERVAL_MS 1000 // Evaluated every second, kept only on change
+#define KEYFRAME_INTERVAL_MS 60000 // Keep at least one frame per minute
+#define LIVE_VIEW_PORT 80 // MJPEG stream at http://<device-ip>/stream
+#define LIVE_VIEW_INTERVAL_MS 100 // ~10 fps while someone is watching
+#define VIBRATION_SAMPLE_MS 10 // IMU sampling for the capture vibration gate
+#define SHOCK_THRESHOLD_G 0.5f // |accel| deviation that starts a camera burst
+#define SHOCK_HOLDOFF_MS 10000 // At most one shock burst per 10 seconds
+#define BURST_FRAMES 8
+#define ANALYSIS_BENCH_ROUNDS 0 // Decodes per scale in the startup benchmark (0 = off)
+#define TIMELAPSE_MODE false // true: capture, spool and deep-sleep instead of the live pipeline
+#define TIMELAPSE_INTERVAL_S 300 // One frame every 5 minutes
+#define TIMELAPSE_UPLOAD_EVERY 12 // WiFi up and spool drained once an hour
+
+// ============================================================================
+// Sensor Snapshot (latest readings, shared with the camera batch manifest
+// and the per-frame snapshot records)
+// ============================================================================
+typedef struct {
+    bme680_data_t bme;
+    mpu6050_data_t mpu;
+    gps_data_t gps;
+    float vibration;
+    int64_t bme_us; // Sample times (esp_timer), 0 = not read yet
+    int64_t mpu_us;
+    int64_t gps_us;
+} sensor_snapshot_t;
+
+static sensor_snapshot_t sensor_snapshot = {0};
+static portMUX_TYPE snapshot_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// "hh:mm:ss" from the GPS clock
+static void format_utc(char out[9], const gps_data_t *gps)
+{
+    const uint8_t parts[3] = {gps->hour, gps->minute, gps->second};
+    for (int i = 0; i < 3; i++)
+    {
+        out[i * 3] = (char)('0' + parts[i] / 10 % 10);
+        out[i * 3 + 1] = (char)('0' + parts[i] % 10);
+        out[i * 3 + 2] = i < 2 ? ':' : '\0';
+    }
+}
+
+static void write_gps(json_writer_t *w, const gps_data_t *gps)
+{
+    char utc[9];
+    format_utc(utc, gps);
+    json_writer_object_begin(w, "gps");
+    json_writer_bool(w, "fix", gps->valid);
+    json_writer_fixed(w, "lat", gps->latitude, 6);
+    json_writer_fixed(w, "lng", gps->longitude, 6);
+    json_writer_fixed(w, "speed", gps->speed, 2);
+    json_writer_string(w, "utc", utc);
+    json_writer_object_end(w);
+}
+
+// Callbacks report overflow the snprintf way: a length >= size
+static int writer_result(json_writer_t *w, size_t size)
+{
+    size_t len = json_writer_finish(w);
+    return len ? (int)len : (int)size;
+}
+
+static int snapshot_manifest_context(char *buf, size_t size, void *ctx)
+{
+    sensor_snapshot_t snap;
+    portENTER_CRITICAL(&snapshot_lock);
+    snap = sensor_snapshot;
+    portEXIT_CRITICAL(&snapshot_lock);
+
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_string(&w, "deviceId", DEVICE_ID);
+    write_gps(&w, &snap.gps);
+    json_writer_object_begin(&w, "sensors");
+    json_writer_fixed(&w, "temperature", snap.bme.temperature, 2);
+    json_writer_fixed(&w, "humidity", snap.bme.humidity, 2);
+    json_writer_fixed(&w, "pressure", snap.bme.pressure, 2);
+    json_writer_fixed(&w, "vibration", snap.vibration, 3);
+    json_writer_object_end(&w);
+    return writer_result(&w, size);
+}
+
+// Signed sample-to-capture distance in ms; widens *worst_ms to its magnitude
+static int32_t sample_skew_ms(int64_t sample_us, int64_t capture_us, uint32_t *worst_ms)
+{
+    int32_t skew_ms = (int32_t)((sample_us - capture_us) / 1000);
+    uint32_t abs_ms = skew_ms < 0 ? (uint32_t)-skew_ms : (uint32_t)skew_ms;
+    if (abs_ms > *worst_ms)
+    {
+        *worst_ms = abs_ms;
+    }
+    return skew_ms;
+}
+
+// Snapshot record: the readings current at capture time, one consistent copy
+static int snapshot_record(char *buf, size_t size, int64_t capture_us, uint32_t *skew_ms, void *ctx)
+{
+    sensor_snapshot_t snap;
+    portENTER_CRITICAL(&snapshot_lock);
+    snap = sensor_snapshot;
+    portEXIT_CRITICAL(&snapshot_lock);
+
+    if (!snap.bme_us || !snap.mpu_us || !snap.gps_us)
+    {
+        return -1; // Sensors not read yet
+    }
+
+    *skew_ms = 0;
+    int32_t bme_skew = sample_skew_ms(snap.bme_us, capture_us, skew_ms);
+    int32_t mpu_skew = sample_skew_ms(snap.mpu_us, capture_us, skew_ms);
+    int32_t gps_skew = sample_skew_ms(snap.gps_us, capture_us, skew_ms);
+
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_string(&w, "deviceId", DEVICE_ID);
+    json_writer_object_begin(&w, "skewMs");
+    json_writer_int(&w, "bme", bme_skew);
+    json_writer_int(&w, "mpu", mpu_skew);
+    json_writer_int(&w, "gps", gps_skew);
+    json_writer_object_end(&w);
+    json_writer_object_begin(&w, "bme");
+    json_writer_fixed(&w, "temperature", snap.bme.temperature, 2);
+    json_writer_fixed(&w, "humidity", snap.bme.humidity, 2);
+    json_writer_fixed(&w, "pressure", snap.bme.pressure, 2);
+    json_writer_fixed(&w, "gas", snap.bme.gas_resistance, 0);
+    json_writer_object_end(&w);
+    json_writer_object_begin(&w, "mpu");
+    json_writer_array_begin(&w, "accel");
+    json_writer_fixed(&w, NULL, snap.mpu.accel_x, 3);
+    json_writer_fixed(&w, NULL, snap.mpu.accel_y, 3);
+    json_writer_fixed(&w, NULL, snap.mpu.accel_z, 3);
+    json_writer_array_end(&w);
+    json_writer_array_begin(&w, "gyro");
+    json_writer_fixed(&w, NULL, snap.mpu.gyro_x, 2);
+    json_writer_fixed(&w, NULL, snap.mpu.gyro_y, 2);
+    json_writer_fixed(&w, NULL, snap.mpu.gyro_z, 2);
+    json_writer_array_end(&w);
+    json_writer_fixed(&w, "vibration", snap.vibration, 3);
+    json_writer_object_end(&w);
+    write_gps(&w, &snap.gps);
+    return writer_result(&w, size);
+}
+
+// ============================================================================
+// Event Hooks
+// ============================================================================
+static void on_shock(float accel_g, void *ctx)
+{
+    ESP_LOGI(TAG, "Shock detected (%.2f g), requesting camera burst", accel_g);
+    cam_pipeline_burst_request();
+}
+
+// ============================================================================
+// Telemetry Topics (one batcher each, with its own encoding)
+// ============================================================================
+typedef struct {
+    const char *topic;
+    app_network_telemetry_format_t format;
+    bool enabled;
+    bool started;
+    uint8_t id;                      // Batcher id, also the journal tag
+} telemetry_topic_t;
+
+static telemetry_topic_t telemetry_topics[] = {
+    {.topic = MQTT_TOPIC, .format = APP_NETWORK_TELEMETRY_JSON, .enabled = TELEMETRY_JSON},
+    {.topic = MQTT_TOPIC_CBOR, .format = APP_NETWORK_TELEMETRY_CBOR, .enabled = TELEMETRY_CBOR},
+};
+
+#define TELEMETRY_TOPIC_COUNT (sizeof(telemetry_topics) / sizeof(telemetry_topics[0]))
+_Static_assert(TELEMETRY_TOPIC_COUNT <= APP_NETWORK_TELEMETRY_TOPICS, "more telemetry topics than batchers");
+
+// ============================================================================
+// Telemetry Journal (offline messages, replayed after reconnect)
+// ============================================================================
+#define OUTAGE_TEST_MAGIC 0x5447544F // "OTGT"
+#define OUTAGE_TEST_AFTER_SAMPLES 3  // Let the link settle before the fake outage
+
+// Outage self-test, kept across the restart it injects
+typedef struct {
+    uint32_t magic;
+    uint32_t pending_before;         // Journal depth when the outage began
+    uint32_t journaled;              // Messages journaled during the outage
+    uint32_t unwritten;              // Of all those, not on flash yet at the restart
+    bool restarted;
+} outage_test_t;
+
+static RTC_NOINIT_ATTR outage_test_t outage_test;
+static int64_t outage_start_us = 0;  // Non-zero while the fake outage runs
+
+static void journal_delivered(int msg_id, bool delivered, void *ctx)
+{
+    telemetry_journal_delivered(msg_id, delivered);
+}
+
+// The batcher id goes along as the journal tag, so replays find their topic
+static esp_err_t journal_fallback(uint8_t id, const void *payload, size_t len, void *ctx)
+{
+    return telemetry_journal_append(id, payload, len);
+}
+
+static bool journal_ready(void *ctx)
+{
+    return app_network_mqtt_is_connected() && !outage_start_us;
+}
+
+// Replayed records stay in the journal until their PUBACK
+static esp_err_t journal_send(uint8_t tag, const uint8_t *data, size_t len, int *msg_id, void *ctx)
+{
+    esp_err_t err = app_network_telemetry_replay(tag, data, len, msg_id);
+    if (err == ESP_ERR_NOT_FOUND)
+    {
+        ESP_LOGW(TAG, "Journaled message for telemetry batcher %u, which is not running, discarded", tag);
+        return ESP_OK;
+    }
+    return err;
+}
+
+// During the fake outage samples take the offline path directly, one per
+// message; once it has lasted JOURNAL_OUTAGE_TEST_S the device restarts
+// without flushing the journal, like a power loss would.
+static void outage_test_journal(uint8_t id, const void *item, size_t len)
+{
+    if (telemetry_journal_append(id, item, len) == ESP_OK)
+    {
+        outage_test.journaled++;
+    }
+}
+
+// Returns true while the fake outage runs (samples go to outage_test_journal())
+static bool outage_test_active(uint32_t sample_count)
+{
+    if (!outage_start_us)
+    {
+        telemetry_journal_stats_t js;
+        if (sample_count != OUTAGE_TEST_AFTER_SAMPLES || outage_test.magic == OUTAGE_TEST_MAGIC ||
+            telemetry_journal_get_stats(&js) != ESP_OK)
+        {
+            return false;
+        }
+        outage_test = (outage_test_t){.magic = OUTAGE_TEST_MAGIC, .pending_before = js.pending};
+        outage_start_us = esp_timer_get_time();
+        ESP_LOGW(TAG, "Outage test: link treated as down for %d s, then restart", JOURNAL_OUTAGE_TEST_S);
+    }
+
+    if (esp_timer_get_time() - outage_start_us >= JOURNAL_OUTAGE_TEST_S * 1000000LL)
+    {
+        telemetry_journal_stats_t js;
+        telemetry_journal_get_stats(&js);
+        outage_test.unwritten = js.unwritten;
+        outage_test.restarted = true;
+        ESP_LOGW(TAG, "Outage test: %lu messages journaled, %lu still within JOURNAL_FLUSH_MS, restarting",
+                 outage_test.journaled, js.unwritten);
+        esp_restart();
+    }
+    return true;
+}
+
+// After the restart: everything that had reached flash must be recovered and
+// replayed; messages still inside the JOURNAL_FLUSH_MS window may be lost
+static void outage_test_check(const telemetry_journal_stats_t *js)
+{
+    if (outage_test.magic != OUTAGE_TEST_MAGIC || !outage_test.restarted)
+    {
+        return;
+    }
+
+    uint32_t expected = outage_test.pending_before + outage_test.journaled - outage_test.unwritten;
+    if (js->recovered < expected || js->evicted > 0 || js->corrupt > 0)
+    {
+        ESP_LOGE(TAG, "Outage test FAILED: %lu expected, %lu recovered, %lu evicted, %lu corrupt",
+                 expected, js->recovered, js->evicted, js->corrupt);
+        outage_test.magic = 0;
+    }
+    else if (js->replayed >= js->recovered && js->pending == 0)
+    {
+        ESP_LOGI(TAG, "Outage test passed: %lu journaled, %lu recovered after restart, all replayed "
+                      "(%lu inside the flush window lost)",
+                 outage_test.journaled, js->recovered, outage_test.unwritten);
+        outage_test.magic = 0;
+    }
+}
+
+// ============================================================================
+// Telemetry Encoding
+// ============================================================================
+// The printf-based encoding the JSON writer replaced, kept as the benchmark baseline
+static size_t telemetry_json_snprintf(const telemetry_sample_t *s, char *buf, size_t size)
+{
+    int n = snprintf(buf, size,
+                     "{\"ts\":%lld,\"deviceId\":\"%s\",\"temperature\":%.2f,\"humidity\":%.2f,"
+                     "\"pressure\":%.2f,\"gas\":%.0f,\"lat\":%.6f,\"lng\":%.6f,\"speed\":%.2f,"
+                     "\"vibration\":%.3f,\"accel_x\":%.3f,\"accel_y\":%.3f,\"accel_z\":%.3f,"
+                     "\"rainScore\":%d,\"visibility\":%d}",
+                     s->ts_ms, s->device_id, s->temperature, s->humidity, s->pressure, s->gas,
+                     s->lat, s->lng, s->speed, s->vibration, s->accel_x, s->accel_y, s->accel_z,
+                     s->rain_score, s->visibility);
+    return (n > 0 && (size_t)n < size) ? (size_t)n : 0;
+}
+
+// Time the encoders on a real sample, alone and as a batch of TELEMETRY_BATCH_SAMPLES
+static void telemetry_benchmark(const telemetry_sample_t *sample)
+{
+    char json[TELEMETRY_JSON_MAX];
+    uint8_t cbor[TELEMETRY_CBOR_MAX];
+    size_t json_len = 0, printf_len = 0, cbor_len = 0;
+
+    // Cycle counts: the task is pinned, so the counter does not change cores under us
+    uint32_t c0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < TELEMETRY_BENCH_ROUNDS; i++)
+    {
+        printf_len = telemetry_json_snprintf(sample, json, sizeof(json));
+    }
+    uint32_t c1 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < TELEMETRY_BENCH_ROUNDS; i++)
+    {
+        json_len = telemetry_encode_json(sample, json, sizeof(json));
+    }
+    uint32_t c2 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < TELEMETRY_BENCH_ROUNDS; i++)
+    {
+        cbor_len = telemetry_encode_cbor(sample, cbor, sizeof(cbor));
+    }
+    uint32_t c3 = esp_cpu_get_cycle_count();
+
+    uint32_t printf_cycles = (c1 - c0) / TELEMETRY_BENCH_ROUNDS;
+    uint32_t json_cycles = (c2 - c1) / TELEMETRY_BENCH_ROUNDS;
+    uint32_t cbor_cycles = (c3 - c2) / TELEMETRY_BENCH_ROUNDS;
+    // Batch framing: JSON '[' + ','s + ']', CBOR only the array start and break bytes
+    int n = TELEMETRY_BATCH_SAMPLES;
+    ESP_LOGI(TAG, "Telemetry encode: snprintf %u B in %lu cycles, JSON writer %u B in %lu cycles (%.1fx)",
+             printf_len, printf_cycles, json_len, json_cycles,
+             json_cycles ? (float)printf_cycles / json_cycles : 0);
+    ESP_LOGI(TAG, "Telemetry encode: CBOR %u B in %lu cycles (%.0f%% of JSON size)",
+             cbor_len, cbor_cycles, json_len ? 100.0f * cbor_len / json_len : 0);
+    ESP_LOGI(TAG, "Telemetry batch of %d: JSON %u B in %lu cycles, CBOR %u B in %lu cycles",
+             n, n * (json_len + 1) + 1, n * json_cycles, n * cbor_len + 2, n * cbor_cycles);
+}
+
+// ============================================================================
+// Time Base (boot counter and UTC from GPS)
+// ============================================================================
+#define CLOCK_VALID_AFTER_S 1577836800 // 2020-01-01: an earlier system time was never set
+#define CLOCK_MAX_DRIFT_S 2            // Re-set the clock from GPS beyond this offset
+
+static uint32_t boot_id = 0;
+
+// Count boots in NVS: (boot, ts) orders samples across reboots, clock or not
+static void boot_id_load(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open("rainguard", NVS_READWRITE, &nvs) != ESP_OK)
+    {
+        return;
+    }
+    nvs_get_u32(nvs, "boot_id", &boot_id);
+    boot_id++;
+    nvs_set_u32(nvs, "boot_id", boot_id);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+    ESP_LOGI(TAG, "Boot %lu", boot_id);
+}
+
+// Days since 1970-01-01 of a Gregorian date
+static int64_t days_from_civil(int y, int m, int d)
+{
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t)era * 146097 + doe - 719468;
+}
+
+// Set the system clock from a GPS fix with date and time
+static void clock_sync_gps(const gps_data_t *gps)
+{
+    if (!gps->valid || gps->year == 0 || gps->month < 1 || gps->month > 12)
+    {
+        return;
+    }
+
+    int64_t utc_s = days_from_civil(gps->year, gps->month, gps->day) * 86400 +
+                    gps->hour * 3600 + gps->minute * 60 + gps->second;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (llabs(now.tv_sec - utc_s) > CLOCK_MAX_DRIFT_S)
+    {
+        struct timeval tv = {.tv_sec = (time_t)utc_s};
+        settimeofday(&tv, NULL);
+        ESP_LOGI(TAG, "Clock set from GPS: %04u-%02u-%02u %02u:%02u:%02u UTC", gps->year, gps->month,
+                 gps->day, gps->hour, gps->minute, gps->second);
+    }
+}
+
+// UTC time in ms of an esp_timer timestamp, 0 while the clock is not set
+static int64_t utc_ms_at(int64_t uptime_us)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (now.tv_sec < CLOCK_VALID_AFTER_S)
+    {
+        return 0;
+    }
+    int64_t now_ms = (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+    return now_ms - (esp_timer_get_time() - uptime_us) / 1000;
+}
 
 // ============================================================================
 // Sensor Data Collection Task
@@ -41,21 +487,30 @@ static const char *TAG = "MAIN";
 static void sensor_mqtt_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Sensor MQTT task started");
-    char json_buffer[512];
+    char json_buffer[TELEMETRY_JSON_MAX];
+    uint8_t cbor_buffer[TELEMETRY_CBOR_MAX];
+    bool benchmarked = TELEMETRY_BENCH_ROUNDS == 0;
+    uint32_t sample_count = 0;
+    int64_t ab_switch_us = esp_timer_get_time();
+    bool ab_batched = TELEMETRY_BATCH_SAMPLES > 1;
 
     while (1)
     {
         // Read BME680 (Temperature, Humidity, Gas)
         bme680_data_t bme_data = {0};
         sensor_bme680_read(&bme_data);
+        int64_t bme_us = esp_timer_get_time();
 
         // Read MPU6050 (Accelerometer, Gyroscope)
         mpu6050_data_t mpu_data = {0};
         sensor_mpu6050_read(&mpu_data);
+        int64_t mpu_us = esp_timer_get_time();
 
         // Read GPS (Location, Speed)
         gps_data_t gps_data = {0};
         gps_neo6m_read(&gps_data, 1000); // 1 second timeout
+        int64_t gps_us = esp_timer_get_time();
+        clock_sync_gps(&gps_data);
 
         // Calculate vibration magnitude from accelerometer
         float vibration = sqrtf(mpu_data.accel_x * mpu_data.accel_x +
@@ -65,50 +520,97 @@ static void sensor_mqtt_task(void *pvParameters)
         if (vibration < 0)
             vibration = 0;
 
-        // Format JSON payload
-        snprintf(json_buffer, sizeof(json_buffer),
-                 "{"
-                 "\"deviceId\":\"%s\","
-                 "\"temperature\":%.2f,"
-                 "\"humidity\":%.2f,"
-                 "\"pressure\":%.2f,"
-                 "\"gas\":%.0f,"
-                 "\"lat\":%.6f,"
-                 "\"lng\":%.6f,"
-                 "\"speed\":%.2f,"
-                 "\"vibration\":%.3f,"
-                 "\"accel_x\":%.3f,"
-                 "\"accel_y\":%.3f,"
-                 "\"accel_z\":%.3f"
-                 "}",
-                 DEVICE_ID,
-                 bme_data.temperature,
-                 bme_data.humidity,
-                 bme_data.pressure,
-                 bme_data.gas_resistance,
-                 gps_data.latitude,
-                 gps_data.longitude,
-                 gps_data.speed,
-                 vibration,
-                 mpu_data.accel_x,
-                 mpu_data.accel_y,
-                 mpu_data.accel_z);
+        portENTER_CRITICAL(&snapshot_lock);
+        sensor_snapshot.bme = bme_data;
+        sensor_snapshot.mpu = mpu_data;
+        sensor_snapshot.gps = gps_data;
+        sensor_snapshot.vibration = vibration;
+        sensor_snapshot.bme_us = bme_us;
+        sensor_snapshot.mpu_us = mpu_us;
+        sensor_snapshot.gps_us = gps_us;
+        portEXIT_CRITICAL(&snapshot_lock);
+
+        // Camera rain estimate (-1 if the camera pipeline is not running)
+        int rain_score = -1;
+        rain_result_t rain = {0};
+        if (cam_pipeline_get_rain(&rain) == ESP_OK)
+        {
+            rain_score = rain.score;
+        }
+        int visibility = -1;
+        visibility_result_t vis = {0};
+        if (cam_pipeline_get_visibility(&vis) == ESP_OK)
+        {
+            visibility = vis.index;
+        }
+
+        telemetry_sample_t sample = {
+            .ts_ms = bme_us / 1000,
+            .boot = boot_id,
+            .utc_ms = utc_ms_at(bme_us),
+            .device_id = DEVICE_ID,
+            .temperature = bme_data.temperature,
+            .humidity = bme_data.humidity,
+            .pressure = bme_data.pressure,
+            .gas = bme_data.gas_resistance,
+            .lat = gps_data.latitude,
+            .lng = gps_data.longitude,
+            .speed = gps_data.speed,
+            .vibration = vibration,
+            .accel_x = mpu_data.accel_x,
+            .accel_y = mpu_data.accel_y,
+            .accel_z = mpu_data.accel_z,
+            .rain_score = rain_score,
+            .visibility = visibility,
+        };
+        size_t json_len = telemetry_encode_json(&sample, json_buffer, sizeof(json_buffer));
 
         // Log to console
-        ESP_LOGI(TAG, "Sensor Data: %s", json_buffer);
+        ESP_LOGI(TAG, "Sensor Data: %s", json_len ? json_buffer : "(encode failed)");
 
-        // Publish to MQTT
-        if (app_network_mqtt_is_connected())
+        if (!benchmarked)
         {
-            esp_err_t err = app_network_mqtt_publish(MQTT_TOPIC, json_buffer, 0);
-            if (err == ESP_OK)
-            {
-                ESP_LOGI(TAG, "Published to MQTT topic: %s", MQTT_TOPIC);
-            }
+            telemetry_benchmark(&sample);
+            benchmarked = true;
         }
-        else
+
+        size_t cbor_len = TELEMETRY_CBOR ? telemetry_encode_cbor(&sample, cbor_buffer, sizeof(cbor_buffer)) : 0;
+
+        sample_count++;
+        bool outage = JOURNAL_OUTAGE_TEST_S > 0 && outage_test_active(sample_count);
+        bool ab_switch = TELEMETRY_AB_PERIOD_MS > 0 &&
+                         esp_timer_get_time() - ab_switch_us >= TELEMETRY_AB_PERIOD_MS * 1000LL;
+        if (ab_switch)
         {
-            ESP_LOGW(TAG, "MQTT not connected, message not sent");
+            ab_batched = !ab_batched;
+            ab_switch_us = esp_timer_get_time();
+        }
+
+        // Publish to MQTT (several samples per message when batching); while
+        // offline the batcher hands its messages to the journal instead
+        for (int i = 0; i < TELEMETRY_TOPIC_COUNT; i++)
+        {
+            const telemetry_topic_t *t = &telemetry_topics[i];
+            if (!t->started)
+            {
+                continue;
+            }
+
+            bool cbor = t->format == APP_NETWORK_TELEMETRY_CBOR;
+            const void *item = cbor ? (const void *)cbor_buffer : json_buffer;
+            size_t item_len = cbor ? cbor_len : json_len;
+            if (outage)
+            {
+                outage_test_journal(t->id, item, item_len);
+            }
+            else if (app_network_telemetry_add(t->id, item, item_len) != ESP_OK)
+            {
+                ESP_LOGW(TAG, "Telemetry publish to %s failed", t->topic);
+            }
+            if (ab_switch)
+            {
+                app_network_telemetry_set_batch(t->id, ab_batched ? TELEMETRY_BATCH_SAMPLES : 1);
+            }
         }
 
         // Wait for next interval
@@ -160,6 +662,20 @@ void app_main(void)
     // Step 1: Initialize NVS
     ESP_ERROR_CHECK(init_nvs());
 
+    if (TIMELAPSE_MODE)
+    {
+        static const timelapse_config_t timelapse_cfg = {
+            .interval_s = TIMELAPSE_INTERVAL_S,
+            .upload_url = IMAGE_UPLOAD_URL,
+            .upload_every = TIMELAPSE_UPLOAD_EVERY,
+            .wifi_timeout_ms = 15000,
+            .drain_timeout_ms = 60000,
+            .power = {.active_ma = 120.0f, .wifi_ma = 100.0f, .sleep_ma = 0.15f},
+        };
+        timelapse_run(&timelapse_cfg); // Does not return
+    }
+    boot_id_load();
+
     // Step 2: Initialize WiFi and wait for connection
     ESP_LOGI(TAG, "Initializing WiFi...");
     ESP_ERROR_CHECK(app_network_init());
@@ -176,6 +692,25 @@ void app_main(void)
     ESP_LOGI(TAG, "WiFi Connected, IP: %s", ip_str);
 
     // Step 3: Initialize MQTT
+    const app_network_mqtt_policy_t telemetry_policy = {
+        .qos = 1,
+        .max_inflight = MQTT_TELEMETRY_INFLIGHT,
+        .outbox_limit = MQTT_TELEMETRY_OUTBOX_KB * 1024,
+    };
+    const app_network_mqtt_policy_t replay_policy = {
+        .qos = 1,
+        .max_inflight = MQTT_REPLAY_INFLIGHT,
+        .outbox_limit = MQTT_REPLAY_OUTBOX_KB * 1024,
+    };
+    const app_network_mqtt_policy_t image_policy = {
+        .qos = 1,
+        .max_inflight = MQTT_IMAGE_INFLIGHT,
+        .outbox_limit = MQTT_IMAGE_OUTBOX_KB * 1024,
+    };
+    app_network_mqtt_set_policy(APP_NETWORK_MQTT_STREAM_TELEMETRY, &telemetry_policy);
+    app_network_mqtt_set_policy(APP_NETWORK_MQTT_STREAM_REPLAY, &replay_policy);
+    app_network_mqtt_set_policy(APP_NETWORK_MQTT_STREAM_IMAGE, &image_policy);
+
     ESP_LOGI(TAG, "Initializing MQTT client...");
     ESP_LOGI(TAG, "Broker URI: %s", MQTT_BROKER_URI);
     ESP_ERROR_CHECK(app_network_mqtt_init(MQTT_BROKER_URI));
@@ -250,6 +785,7 @@ void app_main(void)
     if (err == ESP_OK)
     {
         ESP_LOGI(TAG, "MPU6050 initialized");
+        sensor_mpu6050_vibration_start(VIBRATION_SAMPLE_MS);
     }
     else
     {
@@ -267,7 +803,42 @@ void app_main(void)
         ESP_LOGW(TAG, "GPS init failed, will use placeholder data");
     }
 
-    // Step 6: Start Sensor MQTT Task
+    // Step 6: Start the telemetry journal, the batcher and the Sensor MQTT Task
+    const telemetry_journal_config_t journal_cfg = {
+        .send = journal_send,
+        .ready = journal_ready,
+        .replay_per_s = JOURNAL_REPLAY_PER_S,
+        .flush_ms = JOURNAL_FLUSH_MS,
+        .replay_core = 0,
+    };
+    bool journal_ok = telemetry_journal_start(&journal_cfg) == ESP_OK;
+    if (!journal_ok)
+    {
+        ESP_LOGW(TAG, "Telemetry journal unavailable, offline samples will be dropped");
+    }
+    else
+    {
+        app_network_telemetry_set_delivery_cb(journal_delivered, NULL);
+    }
+
+    for (int i = 0; i < TELEMETRY_TOPIC_COUNT; i++)
+    {
+        telemetry_topic_t *t = &telemetry_topics[i];
+        if (!t->enabled)
+        {
+            continue;
+        }
+        const app_network_telemetry_config_t telemetry_cfg = {
+            .topic = t->topic,
+            .format = t->format,
+            .max_samples = TELEMETRY_BATCH_SAMPLES,
+            .max_bytes = TELEMETRY_BATCH_BYTES,
+            .max_age_ms = TELEMETRY_BATCH_AGE_MS,
+            .fallback = journal_ok ? journal_fallback : NULL,
+        };
+        ESP_ERROR_CHECK(app_network_telemetry_start(&telemetry_cfg, &t->id));
+        t->started = true;
+    }
     ESP_LOGI(TAG, "Starting sensor MQTT task (interval: %d ms)...", SENSOR_READ_INTERVAL_MS);
     xTaskCreatePinnedToCore(
         sensor_mqtt_task, // Task function
@@ -279,9 +850,113 @@ void app_main(void)
         1                 // Core ID (1 = APP_CPU)
     );
 
+    // Step 7: Initialize Camera and start capture pipeline
+    ESP_LOGI(TAG, "Initializing camera...");
+    cam_config_set_burst_mode(BURST_FRAMES > 0);
+    err = cam_config_init();
+    if (err == ESP_OK)
+    {
+        cam_startup_stats_t startup;
+        if (cam_config_measure_startup(&startup) == ESP_OK)
+        {
+            ESP_LOGI(TAG, "Camera %s start: first good frame %lu ms after init began (last cold %lu ms, last warm %lu ms)",
+                     startup.warm ? "warm" : "cold", startup.first_good_ms,
+                     startup.last_cold_ms, startup.last_warm_ms);
+        }
+
+        // Optional one-off decode benchmark for the analysis scales
+        camera_fb_t *bench_fb = ANALYSIS_BENCH_ROUNDS > 0 ? cam_config_capture() : NULL;
+        if (bench_fb && cam_config_analysis_benchmark(bench_fb, ANALYSIS_BENCH_ROUNDS) == ESP_OK)
+        {
+            for (int scale = 0; scale < CAM_ANALYSIS_SCALE_COUNT; scale++)
+            {
+                cam_analysis_stats_t an;
+                cam_config_get_analysis_stats((cam_analysis_scale_t)scale, &an);
+                ESP_LOGI(TAG, "Analysis decode 1/%d: %ux%u, avg %lu us (max %lu), buffer %lu B, decoder %lu B",
+                         2 << scale, an.width, an.height, an.avg_us, an.max_us, an.buffer_bytes, an.decoder_bytes);
+            }
+        }
+        cam_config_return_fb(bench_fb);
+
+        cam_pipeline_config_t pipeline_cfg = {
+            .transport = IMAGE_TRANSPORT,
+            .upload_url = IMAGE_UPLOAD_URL,
+            .resumable_upload = RESUMABLE_UPLOAD,
+            .mqtt_topic = IMAGE_MQTT_TOPIC,
+            .capture_interval_ms = CAPTURE_INTERVAL_MS,
+            .capture_core = 1, // APP_CPU, away from the WiFi stack
+            .upload_core = 0,  // PRO_CPU, next to the WiFi stack
+            .change_trigger = true,
+            .trigger = {
+                .block_threshold = 12,
+                .trigger_percent = 5,
+            },
+            .keyframe_interval_ms = KEYFRAME_INTERVAL_MS,
+            .rain_analysis = true,
+            .visibility_analysis = true,
+            .adaptive_quality = true,
+            .adaptive = {
+                .target_latency_ms = 2000,
+                .hold_images = 3,
+            },
+            .live_view_interval_ms = LIVE_VIEW_INTERVAL_MS,
+            .vibration_gate = true,
+            .vibration = {
+                .gyro_threshold_dps = 4.0f, // ~1 px of blur at SVGA over a 30 ms exposure
+                .accel_threshold_g = 0.15f,
+                .exposure_window_ms = 60,
+                .max_retries = 3,
+                .retry_delay_ms = 50,
+            },
+            .dedup = true,
+            .dedup_distance = 5, // Of 64 bits; sensor noise and JPEG artefacts stay below this
+            .roi_enabled = true,
+            .roi = {
+                // Upper 40% of the sensor (windshield / sky), scaled to 800x240
+                .x = 0,
+                .y = 0,
+                .width = 1600,
+                .height = 480,
+                .out_width = 800,
+                .out_height = 240,
+                .jpeg_quality = 12,
+            },
+            .burst_frames = BURST_FRAMES,
+            .burst_on_rain = true,
+            .spool = true,
+            .spool_batch = SPOOL_BATCH,
+            .batch_upload_url = IMAGE_BATCH_URL,
+            .manifest_context = snapshot_manifest_context,
+            .snapshot = SNAPSHOT_RECORDS ? snapshot_record : NULL,
+        };
+        err = cam_pipeline_start(&pipeline_cfg);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Camera pipeline start failed: %s", esp_err_to_name(err));
+        }
+        else
+        {
+            sensor_mpu6050_set_shock_callback(SHOCK_THRESHOLD_G, SHOCK_HOLDOFF_MS, on_shock, NULL);
+            if (live_view_start(LIVE_VIEW_PORT) != ESP_OK)
+            {
+                ESP_LOGW(TAG, "Live view disabled");
+            }
+        }
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Camera init failed, image capture disabled");
+    }
+
     ESP_LOGI(TAG, "System initialization complete");
     ESP_LOGI(TAG, "========================================");
-    ESP_LOGI(TAG, "Publishing sensor data to topic: %s", MQTT_TOPIC);
+    for (int i = 0; i < TELEMETRY_TOPIC_COUNT; i++)
+    {
+        if (telemetry_topics[i].started)
+        {
+            ESP_LOGI(TAG, "Publishing sensor data to topic: %s", telemetry_topics[i].topic);
+        }
+    }
     ESP_LOGI(TAG, "========================================");
 
     // Main loop - monitor system health
@@ -294,8 +969,202 @@ void app_main(void)
         ESP_LOGI(TAG, "System Status [Uptime: %lu min]", loop_count);
         ESP_LOGI(TAG, "  Free heap: %lu bytes", esp_get_free_heap_size());
         ESP_LOGI(TAG, "  Min free heap: %lu bytes", esp_get_minimum_free_heap_size());
+        ESP_LOGI(TAG, "  Internal heap: %u bytes free (min %u)", heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                 heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
         ESP_LOGI(TAG, "  WiFi: %s, MQTT: %s",
                  app_network_get_status() == NETWORK_CONNECTED ? "Connected" : "Disconnected",
                  app_network_mqtt_is_connected() ? "Connected" : "Disconnected");
+
+        cam_pipeline_stats_t cam_stats;
+        if (cam_pipeline_get_stats(&cam_stats) == ESP_OK)
+        {
+            ESP_LOGI(TAG, "  Camera: captured=%lu (%lu event frames), uploaded=%lu, queue=%u (peak %u), dropped=%lu, failed=%lu",
+                     cam_stats.captured, cam_stats.event_frames, cam_stats.uploaded, cam_stats.queue_depth,
+                     cam_stats.queue_peak, cam_stats.dropped, cam_stats.upload_failed);
+            ESP_LOGI(TAG, "  Camera latency: last=%lu ms, avg=%lu ms, max=%lu ms, max interval=%lu ms",
+                     cam_stats.latency_last_ms, cam_stats.latency_avg_ms, cam_stats.latency_max_ms,
+                     cam_stats.interval_max_ms);
+            if (cam_stats.snapshots > 0)
+            {
+                ESP_LOGI(TAG, "  Snapshots: %lu records, capture-to-sensor skew last=%lu ms avg=%lu ms max=%lu ms",
+                         cam_stats.snapshots, cam_stats.snapshot_skew_last_ms, cam_stats.snapshot_skew_avg_ms,
+                         cam_stats.snapshot_skew_max_ms);
+            }
+            ESP_LOGI(TAG, "  Rain analysis: last=%lu us, avg=%lu us per frame",
+                     cam_stats.rain_last_us, cam_stats.rain_avg_us);
+            ESP_LOGI(TAG, "  Visibility: last=%lu us, avg=%lu us, max=%lu us per frame",
+                     cam_stats.visibility_last_us, cam_stats.visibility_avg_us, cam_stats.visibility_max_us);
+            cam_analysis_stats_t an_stats;
+            if (cam_config_get_analysis_stats(CAM_ANALYSIS_SCALE_1_8, &an_stats) == ESP_OK && an_stats.decodes > 0)
+            {
+                ESP_LOGI(TAG, "  Analysis frames: %lu decodes (%lu shared by later stages), last=%lu us avg=%lu us",
+                         an_stats.decodes, an_stats.shared, an_stats.last_us, an_stats.avg_us);
+            }
+            if (cam_stats.vib_checked > 0)
+            {
+                ESP_LOGI(TAG, "  Vibration gate: %.1f%% rejected (%lu/%lu), %lu periods deferred, "
+                              "sharpness kept=%lu rejected=%lu, jpeg kept=%lu rejected=%lu bytes",
+                         cam_stats.vib_rejected * 100.0f / cam_stats.vib_checked, cam_stats.vib_rejected,
+                         cam_stats.vib_checked, cam_stats.vib_deferred, cam_stats.sharpness_kept,
+                         cam_stats.sharpness_rejected, cam_stats.jpeg_kept_avg, cam_stats.jpeg_rejected_avg);
+            }
+            if (cam_stats.bursts > 0)
+            {
+                ESP_LOGI(TAG, "  Bursts: %lu (%lu frames), last %.1f fps, trigger to first frame last=%lu ms max=%lu ms",
+                         cam_stats.bursts, cam_stats.burst_frames, cam_stats.burst_fps,
+                         cam_stats.burst_first_ms, cam_stats.burst_first_max_ms);
+            }
+            if (cam_stats.dedup_skipped > 0)
+            {
+                ESP_LOGI(TAG, "  Dedup: %lu frames skipped, %llu KB saved, hash %lu us/frame, last distance %u",
+                         cam_stats.dedup_skipped, cam_stats.dedup_bytes_saved / 1024,
+                         cam_stats.hash_avg_us, cam_stats.dedup_last_distance);
+            }
+        }
+
+        image_spool_stats_t spool_stats;
+        if (image_spool_get_stats(&spool_stats) == ESP_OK)
+        {
+            ESP_LOGI(TAG, "  Spool: %lu images (%lu KB, %u%% full), written=%lu evicted=%lu drained=%lu corrupt=%lu, "
+                          "oversize=%lu, write %lu KB/s, drain %lu KB/s",
+                     spool_stats.pending, spool_stats.pending_bytes / 1024, spool_stats.fill_percent,
+                     spool_stats.written, spool_stats.evicted, spool_stats.drained, spool_stats.corrupt,
+                     spool_stats.dropped,
+                     spool_stats.write_bps / 1024, spool_stats.drain_bps / 1024);
+        }
+
+        for (int p = 0; p < CAM_PRODUCT_COUNT; p++)
+        {
+            cam_product_stats_t prod_stats;
+            if (cam_config_get_product_stats((cam_product_t)p, &prod_stats) == ESP_OK && prod_stats.captures > 0)
+            {
+                ESP_LOGI(TAG, "  %s images: %lu captured, avg %lu bytes, capture latency avg %lu ms (last %lu), %lu switches",
+                         p == CAM_PRODUCT_ROI ? "ROI" : "Full", prod_stats.captures, prod_stats.avg_bytes,
+                         prod_stats.avg_latency_ms, prod_stats.last_latency_ms, prod_stats.switches);
+            }
+        }
+
+        cam_trigger_stats_t trig_stats;
+        if (cam_config_get_trigger_stats(&trig_stats) == ESP_OK && trig_stats.evaluated > 0)
+        {
+            ESP_LOGI(TAG, "  Trigger: %lu/%lu frames kept, %lu us/frame, upload volume %.1f%% of full",
+                     trig_stats.triggered, trig_stats.evaluated, trig_stats.avg_eval_us,
+                     trig_stats.bytes_triggered * 100.0f / trig_stats.bytes_evaluated);
+        }
+
+        cam_adaptive_stats_t adapt_stats;
+        if (cam_config_get_adaptive_stats(&adapt_stats) == ESP_OK)
+        {
+            ESP_LOGI(TAG, "  Adaptive: level %u (framesize %d, quality %u), %lu bytes/image, %lu B/s, %lu changes",
+                     adapt_stats.level, adapt_stats.frame_size, adapt_stats.jpeg_quality,
+                     adapt_stats.avg_bytes, adapt_stats.throughput_bps, adapt_stats.changes);
+        }
+
+        live_view_stats_t lv_stats;
+        if (live_view_get_stats(&lv_stats) == ESP_OK && lv_stats.clients > 0)
+        {
+            ESP_LOGI(TAG, "  Live view: %u clients, %lu frames published (%lu dropped), %u buffers / %lu KB",
+                     lv_stats.clients, lv_stats.frames_published, lv_stats.frames_dropped, lv_stats.pool_buffers,
+                     lv_stats.pool_bytes / 1024);
+            for (int i = 0; i < LIVE_VIEW_MAX_CLIENTS; i++)
+            {
+                if (lv_stats.client[i].active)
+                {
+                    ESP_LOGI(TAG, "    client %d: %.1f fps, %lu B/s, %lu sent, %lu skipped", i,
+                             lv_stats.client[i].fps, lv_stats.client[i].throughput_bps,
+                             lv_stats.client[i].frames_sent, lv_stats.client[i].frames_skipped);
+                }
+            }
+        }
+
+        app_network_upload_stats_t up_stats;
+        app_network_http_pool_stats_t pool_stats;
+        app_network_get_upload_stats(&up_stats);
+        app_network_get_http_pool_stats(&pool_stats);
+        ESP_LOGI(TAG, "  HTTP upload: %.1f img/min, %lu B/s, ttfb avg=%lu ms, connections=%lu/%lu requests, handshake=%.1f ms/request",
+                 up_stats.images_per_minute, up_stats.throughput_bps, up_stats.avg_ttfb_ms,
+                 pool_stats.connections_opened, pool_stats.requests, pool_stats.handshake_ms_amortised);
+
+        app_network_batch_stats_t batch_stats;
+        app_network_get_batch_stats(&batch_stats);
+        if (batch_stats.images > 0)
+        {
+            ESP_LOGI(TAG, "  HTTP batch: %lu images in %lu requests (%.2f requests/image vs 1.00 single), "
+                          "%lu ms/image vs %lu ms/image single, %lu failed",
+                     batch_stats.images, batch_stats.batches, batch_stats.requests_per_image,
+                     batch_stats.avg_image_ms, up_stats.avg_image_ms, batch_stats.batches_failed);
+        }
+
+        app_network_resume_stats_t resume_stats;
+        app_network_get_resume_stats(&resume_stats);
+        if (resume_stats.uploads > 0)
+        {
+            ESP_LOGI(TAG, "  Resumable upload: %lu/%lu complete, %lu failed, %lu interrupted, %lu resumed, "
+                          "sent=%llu KB wasted=%llu KB saved=%llu KB",
+                     resume_stats.completed, resume_stats.uploads, resume_stats.failed,
+                     resume_stats.interrupted, resume_stats.resumed, resume_stats.bytes_sent / 1024,
+                     resume_stats.bytes_wasted / 1024, resume_stats.bytes_saved / 1024);
+        }
+
+        for (int i = 0; i < TELEMETRY_TOPIC_COUNT * 2; i++)
+        {
+            const telemetry_topic_t *t = &telemetry_topics[i / 2];
+            bool batched = i % 2;
+            app_network_telemetry_stats_t tl_stats;
+            if (t->started && app_network_get_telemetry_stats(t->id, batched, &tl_stats) == ESP_OK &&
+                (tl_stats.messages > 0 || tl_stats.dropped > 0 || tl_stats.deferred > 0))
+            {
+                ESP_LOGI(TAG, "  Telemetry %s %s: %lu samples in %lu messages (%.3f msg/s), %lu B/sample, "
+                              "PUBACK avg=%lu ms max=%lu ms, flushes count/bytes/age=%lu/%lu/%lu, "
+                              "journaled=%lu (+%lu evicted) dropped=%lu",
+                         t->format == APP_NETWORK_TELEMETRY_CBOR ? "CBOR" : "JSON",
+                         batched ? "batched" : "single", tl_stats.samples, tl_stats.messages,
+                         tl_stats.messages_per_s, tl_stats.bytes_per_sample, tl_stats.ack_avg_ms,
+                         tl_stats.ack_max_ms, tl_stats.flush_count, tl_stats.flush_bytes, tl_stats.flush_age,
+                         tl_stats.deferred, tl_stats.requeued, tl_stats.dropped);
+            }
+        }
+
+        telemetry_journal_stats_t journal_stats;
+        if (telemetry_journal_get_stats(&journal_stats) == ESP_OK)
+        {
+            ESP_LOGI(TAG, "  Journal: %lu messages (%lu B, %u%% full), recovered=%lu appended=%lu replayed=%lu "
+                          "(%lu awaiting PUBACK, %lu resent) evicted=%lu corrupt=%lu, %lu B/write, "
+                          "drain %.2f msg/s (%lu B/s)",
+                     journal_stats.pending, journal_stats.pending_bytes, journal_stats.fill_percent,
+                     journal_stats.recovered, journal_stats.appended, journal_stats.replayed,
+                     journal_stats.inflight, journal_stats.resent,
+                     journal_stats.evicted, journal_stats.corrupt, journal_stats.bytes_per_write,
+                     journal_stats.drain_rate, journal_stats.drain_bps);
+            outage_test_check(&journal_stats);
+        }
+
+        app_network_mqtt_outbox_stats_t outbox_stats;
+        app_network_get_mqtt_outbox_stats(&outbox_stats);
+        ESP_LOGI(TAG, "  MQTT outbox: %lu KB (peak %lu KB, limit %lu KB)", outbox_stats.outbox_bytes / 1024,
+                 outbox_stats.outbox_peak_bytes / 1024, outbox_stats.outbox_limit / 1024);
+        static const char *const stream_names[APP_NETWORK_MQTT_STREAM_COUNT] = {"generic", "telemetry", "replay",
+                                                                                "image"};
+        for (int i = 0; i < APP_NETWORK_MQTT_STREAM_COUNT; i++)
+        {
+            const app_network_mqtt_stream_stats_t *st = &outbox_stats.streams[i];
+            if (st->published > 0 || st->rejected > 0)
+            {
+                ESP_LOGI(TAG, "    %s: %lu published, %lu acked, %u inflight (peak %u), %lu KB (peak %lu KB), "
+                              "window full=%lu rejected=%lu evicted=%lu",
+                         stream_names[i], st->published, st->acked, st->inflight, st->inflight_peak,
+                         st->outbox_bytes / 1024, st->outbox_peak_bytes / 1024, st->window_full, st->rejected,
+                         st->evicted);
+            }
+        }
+
+        app_network_mqtt_image_stats_t mqtt_img_stats;
+        app_network_get_mqtt_image_stats(&mqtt_img_stats);
+        if (mqtt_img_stats.images_sent > 0)
+        {
+            ESP_LOGI(TAG, "  MQTT images: %lu/%lu confirmed, %lu B/s, %lu chunks (%lu resent), last %lu ms",
+                     mqtt_img_stats.images_acked, mqtt_img_stats.images_sent, mqtt_img_stats.throughput_bps,
+                     mqtt_img_stats.chunks_sent, mqtt_img_stats.chunks_resent, mqtt_img_stats.last_image_ms);
+        }
     }
 }
@@ -0,0 +1,356 @@
+#!/usr/bin/env python3
+"""
+Mock image server for RainGuard HTTP uploads (resumable and batched).
+
+Resumable protocol (see app_network_upload_image_resumable):
+  POST, Upload-Id: <id>, Content-Range: bytes */<total>, empty body
+      -> 308 + "Range: bytes=0-<last>" (omitted if nothing received yet)
+      -> 201 if the image is already complete
+  POST, Upload-Id: <id>, Content-Range: bytes <first>-<last>/<total>, body
+      -> 201 once all <total> bytes are in, else 308 + Range
+      -> 416 + Range if <first> is not where the server stands
+Plain POSTs without Content-Range are stored as complete images.
+
+Batches (see app_network_upload_batch): POST multipart/form-data with a
+"manifest" JSON part and image0..imageN-1 JPEG parts -> 201.
+
+--drop-rate cuts that fraction of body requests after a random number of
+bytes, without a response, to mimic a WiFi dropout. --simulate uploads
+random images to an in-process server, once resuming and once restarting
+from zero, and prints the bytes wasted by each strategy; then once one
+image per request and once in batches, and prints requests and time per
+image. --latency-ms delays every response to model the train's WiFi RTT.
+
+Usage:
+  python tools/mock_upload_server.py --port 8080 --out images/ --drop-rate 0.3
+  python tools/mock_upload_server.py --simulate 50 --drop-rate 0.3 --latency-ms 80 --batch 4
+"""
+
+import argparse
+import email.parser
+import email.policy
+import http.client
+import json
+import os
+import random
+import re
+import socket
+import threading
+import time
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+CHUNK = 4096           # Same write size as UPLOAD_STREAM_CHUNK_SIZE on the device
+MAX_ATTEMPTS = 6       # APP_NETWORK_RESUME_MAX_ATTEMPTS
+RANGE_RE = re.compile(r"bytes (?:\*|(\d+)-(\d+))/(\d+)")
+
+
+class UploadServer(ThreadingHTTPServer):
+    daemon_threads = True
+
+    def __init__(self, address, out_dir, drop_rate, latency_ms=0, quiet=False):
+        super().__init__(address, UploadHandler)
+        self.out_dir = out_dir
+        self.drop_rate = drop_rate
+        self.latency_s = latency_ms / 1000
+        self.quiet = quiet
+        self.lock = threading.Lock()
+        self.partial = {}      # Upload-Id -> bytearray
+        self.complete = set()  # Upload-Ids stored in full
+        self.bytes_received = 0
+        self.drops = 0
+        self.requests = 0
+
+    def log(self, text):
+        if not self.quiet:
+            print(text)
+
+
+class UploadHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # Keep-alive, like the device's connection pool
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def reply(self, status, received=None):
+        time.sleep(self.server.latency_s)
+        self.send_response(status)
+        if received:
+            self.send_header("Range", f"bytes=0-{received - 1}")
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def discard_body(self, length):
+        while length > 0:
+            data = self.rfile.read(min(CHUNK, length))
+            if not data:
+                break
+            length -= len(data)
+
+    def save(self, name, data):
+        if self.server.out_dir:
+            path = os.path.join(self.server.out_dir, f"{name}.jpg")
+            with open(path, "wb") as f:
+                f.write(data)
+            self.server.log(f"{name}: {len(data)} bytes -> {path}")
+
+    def do_POST(self):
+        server = self.server
+        length = int(self.headers.get("Content-Length", 0))
+        upload_id = self.headers.get("Upload-Id")
+        match = RANGE_RE.fullmatch(self.headers.get("Content-Range", ""))
+        with server.lock:
+            server.requests += 1
+
+        if self.headers.get_content_type() == "multipart/form-data":
+            self.receive_batch(length)
+            return
+
+        if not upload_id or not match:
+            data = self.rfile.read(length)
+            self.save(f"{int(time.time() * 1000)}", data)
+            self.reply(201)
+            return
+
+        first, total = match.group(1), int(match.group(3))
+        with server.lock:
+            if upload_id in server.complete:
+                self.discard_body(length)
+                self.reply(201)
+                return
+            upload = server.partial.setdefault(upload_id, bytearray())
+
+        if first is None:
+            self.discard_body(length)
+            self.reply(308, len(upload))
+            return
+
+        if int(first) != len(upload):
+            self.discard_body(length)
+            self.reply(416, len(upload))
+            return
+
+        drop_at = random.randint(0, length - 1) if random.random() < server.drop_rate else None
+        received = 0
+        while received < length:
+            want = min(CHUNK, length - received)
+            if drop_at is not None:
+                want = min(want, drop_at - received)
+            if want > 0:
+                data = self.rfile.read(want)
+                if not data:
+                    return  # Client went away
+                upload += data
+                received += len(data)
+                with server.lock:
+                    server.bytes_received += len(data)
+            if drop_at is not None and received >= drop_at:
+                with server.lock:
+                    server.drops += 1
+                server.log(f"{upload_id}: dropping connection at {len(upload)}/{total}")
+                self.close_connection = True
+                self.connection.shutdown(socket.SHUT_RDWR)
+                return
+
+        if len(upload) < total:
+            self.reply(308, len(upload))
+            return
+
+        crc = int(upload_id.split("-")[0], 16)
+        with server.lock:
+            del server.partial[upload_id]
+            if zlib.crc32(upload) != crc:
+                server.log(f"{upload_id}: CRC mismatch, discarded")
+                self.reply(422)
+                return
+            server.complete.add(upload_id)
+        self.save(upload_id, bytes(upload))
+        self.reply(201)
+
+    def receive_batch(self, length):
+        body = self.rfile.read(length)
+        head = f"Content-Type: {self.headers['Content-Type']}\r\n\r\n".encode()
+        message = email.parser.BytesParser(policy=email.policy.HTTP).parsebytes(head + body)
+        parts = {part.get_param("name", header="content-disposition"): part.get_payload(decode=True)
+                 for part in message.iter_parts()}
+        manifest = json.loads(parts.get("manifest") or b"{}")
+        images = manifest.get("images", [])
+        if len(images) != len(parts) - 1:
+            self.server.log(f"Batch: manifest lists {len(images)} images, got {len(parts) - 1} parts")
+            self.reply(400)
+            return
+        for entry in images:
+            data = parts[entry["part"]]
+            if len(data) != entry["len"]:
+                self.reply(400)
+                return
+            self.save(f"spool{entry['seq']}", data)
+        self.server.log(f"Batch of {len(images)} images, manifest: "
+                        f"{json.dumps({k: v for k, v in manifest.items() if k != 'images'})}")
+        self.reply(201)
+
+
+# ============================================================================
+# Simulation (mirrors the device client)
+# ============================================================================
+
+class Client:
+    def __init__(self, port):
+        self.port = port
+        self.conn = None
+        self.bytes_sent = 0
+        self.requests = 0
+
+    def request(self, upload_id, data, first, total, query):
+        """One POST; returns (status, last byte held or -1), status 0 if cut off."""
+        body = b"" if query else data[first:]
+        content_range = f"bytes */{total}" if query else f"bytes {first}-{total - 1}/{total}"
+        try:
+            if self.conn is None:
+                self.conn = http.client.HTTPConnection("127.0.0.1", self.port, timeout=5)
+            self.conn.putrequest("POST", "/upload")
+            self.conn.putheader("Content-Type", "image/jpeg")
+            self.conn.putheader("Content-Range", content_range)
+            self.conn.putheader("Upload-Id", upload_id)
+            self.conn.putheader("Content-Length", str(len(body)))
+            self.conn.endheaders()
+            for pos in range(0, len(body), CHUNK):
+                self.conn.send(body[pos:pos + CHUNK])
+                self.bytes_sent += len(body[pos:pos + CHUNK])
+            resp = self.conn.getresponse()
+            resp.read()
+        except (OSError, http.client.HTTPException):
+            self.conn.close()
+            self.conn = None
+            return 0, -1
+        held = resp.getheader("Range")
+        return resp.status, int(held.split("-")[1]) if held else -1
+
+    def upload_resumable(self, data):
+        upload_id = f"{zlib.crc32(data):08x}-{len(data):x}"
+        offset, known = 0, False
+        for _ in range(MAX_ATTEMPTS):
+            if not known:
+                status, last = self.request(upload_id, data, 0, len(data), True)
+                if status == 0:
+                    continue
+                if 200 <= status < 300:
+                    return True
+                offset, known = last + 1, True
+            status, last = self.request(upload_id, data, offset, len(data), False)
+            if 200 <= status < 300:
+                return True
+            if status == 308 and last >= 0:
+                offset = last + 1
+            else:
+                known = False
+        return False
+
+    def post(self, path, headers, body):
+        if self.conn is None:
+            self.conn = http.client.HTTPConnection("127.0.0.1", self.port, timeout=5)
+        self.conn.request("POST", path, body, headers)
+        resp = self.conn.getresponse()
+        resp.read()
+        self.requests += 1
+        return 200 <= resp.status < 300
+
+    def upload_single(self, data):
+        return self.post("/upload", {"Content-Type": "image/jpeg"}, data)
+
+    def upload_batch(self, images):
+        boundary = "rainguardbatch"
+        manifest = {"count": len(images), "images": [
+            {"part": f"image{i}", "seq": i, "len": len(data)} for i, data in enumerate(images)]}
+        body = (f"--{boundary}\r\nContent-Disposition: form-data; name=\"manifest\"\r\n"
+                f"Content-Type: application/json\r\n\r\n{json.dumps(manifest)}").encode()
+        for i, data in enumerate(images):
+            body += (f"\r\n--{boundary}\r\nContent-Disposition: form-data; name=\"image{i}\"; "
+                     f"filename=\"image{i}.jpg\"\r\nContent-Type: image/jpeg\r\n\r\n").encode() + data
+        body += f"\r\n--{boundary}--\r\n".encode()
+        return self.post("/upload/batch", {"Content-Type": f"multipart/form-data; boundary={boundary}"}, body)
+
+    def upload_restart(self, data):
+        for attempt in range(MAX_ATTEMPTS):
+            # A fresh id each time: the server's partial copy is never reused
+            upload_id = f"{zlib.crc32(data):08x}-{len(data):x}-{attempt}"
+            status, _ = self.request(upload_id, data, 0, len(data), False)
+            if 200 <= status < 300:
+                return True
+        return False
+
+
+def simulate(count, size, drop_rate, latency_ms, batch):
+    random.seed(1)
+    images = [os.urandom(random.randint(size // 2, size)) for _ in range(count)]
+    total = sum(len(image) for image in images)
+
+    print(f"{count} images, {total / 1024:.0f} KiB, drop rate {drop_rate:.0%}")
+    for mode in ("resume", "restart"):
+        server = UploadServer(("127.0.0.1", 0), None, drop_rate, latency_ms, quiet=True)
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        client = Client(server.server_address[1])
+        upload = client.upload_resumable if mode == "resume" else client.upload_restart
+
+        start = time.monotonic()
+        delivered = [image for image in images if upload(image)]
+        elapsed = time.monotonic() - start
+        # Everything sent beyond one copy of each delivered image was wasted
+        wasted = client.bytes_sent - sum(len(image) for image in delivered)
+        server.shutdown()
+
+        print(f"  {mode:8s} {len(delivered)}/{count} complete, {server.drops} drops, "
+              f"sent {client.bytes_sent / 1024:.0f} KiB, wasted {wasted / 1024:.0f} KiB "
+              f"({wasted * 100 / total:.1f}% of payload), {elapsed:.1f} s")
+
+    print(f"Single vs batch of {batch}, no drops, {latency_ms} ms latency")
+    for mode in ("single", "batch"):
+        server = UploadServer(("127.0.0.1", 0), None, 0.0, latency_ms, quiet=True)
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        client = Client(server.server_address[1])
+
+        start = time.monotonic()
+        if mode == "single":
+            ok = sum(client.upload_single(image) for image in images)
+        else:
+            ok = sum(len(images[i:i + batch]) for i in range(0, count, batch)
+                     if client.upload_batch(images[i:i + batch]))
+        elapsed = time.monotonic() - start
+        server.shutdown()
+
+        print(f"  {mode:8s} {ok}/{count} delivered, {client.requests} requests "
+              f"({client.requests / count:.2f} per image), {elapsed:.2f} s "
+              f"({elapsed * 1000 / count:.1f} ms per image)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--out", default="images", help="output directory")
+    parser.add_argument("--drop-rate", type=float, default=0.0,
+                        help="fraction of body requests cut off mid-transfer")
+    parser.add_argument("--simulate", type=int, metavar="N",
+                        help="upload N random images locally and compare resume vs restart")
+    parser.add_argument("--size", type=int, default=64 * 1024, help="largest simulated image")
+    parser.add_argument("--latency-ms", type=int, default=0, help="delay before every response")
+    parser.add_argument("--batch", type=int, default=4, help="images per simulated batch")
+    args = parser.parse_args()
+
+    if args.simulate:
+        simulate(args.simulate, args.size, args.drop_rate, args.latency_ms, args.batch)
+        return
+
+    os.makedirs(args.out, exist_ok=True)
+    server = UploadServer(("", args.port), args.out, args.drop_rate, args.latency_ms)
+    print(f"Listening on :{args.port}/upload (drop rate {args.drop_rate:.0%})")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print(f"{len(server.complete)} resumable images complete, {server.requests} requests, "
+              f"{server.bytes_received} bytes received, {server.drops} connections dropped")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Reassemble chunked RainGuard images published over MQTT.
+
+Subscribes to <prefix>/#, verifies each chunk's CRC32 (carried in the topic),
+writes complete images to the output directory and answers on <prefix>/ack:
+  "<id> OK"               image complete and CRC verified
+  "<id> R <seq> <seq> ..." chunks missing or corrupt, please resend
+
+Usage:
+  pip install paho-mqtt
+  python tools/mqtt_image_reassemble.py --broker 192.168.0.103 \
+      --prefix train/image/ESP32_Train_01 --out images/
+"""
+
+import argparse
+import json
+import os
+import threading
+import time
+import zlib
+
+import paho.mqtt.client as mqtt
+
+MAX_RESEND = 32      # Must not exceed MQTT_IMAGE_MAX_RESEND on the device
+GAP_TIMEOUT_S = 1.0  # Quiet time before missing chunks are requested
+
+
+class Image:
+    def __init__(self, meta):
+        self.length = meta["len"]
+        self.chunks = meta["chunks"]
+        self.crc = int(meta["crc"], 16)
+        self.event = meta.get("event")  # Burst frames: event id and frame index
+        self.frame = meta.get("frame")
+        self.parts = {}
+        self.first_seen = time.monotonic()
+        self.last_seen = self.first_seen
+
+    def missing(self):
+        return [seq for seq in range(self.chunks) if seq not in self.parts]
+
+
+class Reassembler:
+    def __init__(self, client, prefix, out_dir):
+        self.client = client
+        self.prefix = prefix.rstrip("/")
+        self.out_dir = out_dir
+        self.images = {}
+        self.lock = threading.Lock()
+        self.total_bytes = 0
+        self.total_time = 0.0
+
+    def ack(self, image_id, text):
+        self.client.publish(f"{self.prefix}/ack", f"{image_id} {text}", qos=1)
+
+    def on_message(self, _client, _userdata, msg):
+        parts = msg.topic[len(self.prefix) + 1:].split("/")
+        with self.lock:
+            if len(parts) == 2 and parts[1] == "meta":
+                self.images[parts[0]] = Image(json.loads(msg.payload))
+            elif len(parts) == 4:
+                self.on_chunk(parts[0], int(parts[1]), int(parts[3], 16), msg.payload)
+
+    def on_chunk(self, image_id, seq, crc, payload):
+        image = self.images.get(image_id)
+        if image is None:
+            return
+        image.last_seen = time.monotonic()
+        if zlib.crc32(payload) != crc:
+            print(f"{image_id}: chunk {seq} CRC mismatch")
+            return
+        image.parts[seq] = payload
+        if len(image.parts) == image.chunks:
+            self.complete(image_id, image)
+
+    def complete(self, image_id, image):
+        data = b"".join(image.parts[seq] for seq in range(image.chunks))
+        if len(data) != image.length or zlib.crc32(data) != image.crc:
+            print(f"{image_id}: image CRC mismatch, requesting all chunks again")
+            image.parts.clear()
+            return
+        name = image_id
+        if image.event is not None:
+            name = f"event{image.event}_{image.frame:02d}_{image_id}"
+        path = os.path.join(self.out_dir, f"{name}.jpg")
+        with open(path, "wb") as f:
+            f.write(data)
+        elapsed = max(time.monotonic() - image.first_seen, 1e-6)
+        self.total_bytes += len(data)
+        self.total_time += elapsed
+        print(f"{image_id}: {len(data)} bytes in {image.chunks} chunks, "
+              f"{elapsed * 1000:.0f} ms, {len(data) / elapsed / 1024:.1f} KiB/s "
+              f"(average {self.total_bytes / self.total_time / 1024:.1f} KiB/s) -> {path}")
+        self.ack(image_id, "OK")
+        del self.images[image_id]
+
+    def request_missing(self):
+        now = time.monotonic()
+        with self.lock:
+            for image_id, image in self.images.items():
+                if now - image.last_seen < GAP_TIMEOUT_S:
+                    continue
+                missing = image.missing()[:MAX_RESEND]
+                if missing:
+                    print(f"{image_id}: requesting {len(missing)} chunks")
+                    self.ack(image_id, "R " + " ".join(str(seq) for seq in missing))
+                    image.last_seen = now
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--broker", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--prefix", required=True, help="image topic prefix")
+    parser.add_argument("--out", default="images", help="output directory")
+    args = parser.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+
+    try:
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)
+    except AttributeError:  # paho-mqtt < 2.0
+        client = mqtt.Client()
+
+    reassembler = Reassembler(client, args.prefix, args.out)
+    client.on_message = reassembler.on_message
+    client.on_connect = lambda c, *_: c.subscribe(f"{reassembler.prefix}/+/#", qos=1)
+    client.connect(args.broker, args.port)
+    client.loop_start()
+
+    print(f"Listening on {args.broker}:{args.port} for {reassembler.prefix}/...")
+    try:
+        while True:
+            time.sleep(0.25)
+            reassembler.request_missing()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        client.loop_stop()
+
+
+if __name__ == "__main__":
+    main()
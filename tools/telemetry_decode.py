@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""
+Decode RainGuard CBOR telemetry into the JSON field names.
+
+A message is one CBOR map with integer keys (TELEMETRY_KEY_* in
+components/telemetry/include/telemetry.h) or, when batched, an
+indefinite-length array of them. Coordinates arrive in 1e-7 degrees.
+
+Usage:
+  python tools/telemetry_decode.py --file sample.cbor
+  pip install paho-mqtt
+  python tools/telemetry_decode.py --broker 192.168.0.103 --topic train/cbor/ESP32_Train_01
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+KEYS = {
+    0: "ts",
+    1: "deviceId",
+    2: "temperature",
+    3: "humidity",
+    4: "pressure",
+    5: "gas",
+    6: "lat",
+    7: "lng",
+    8: "speed",
+    9: "vibration",
+    10: "accel",
+    11: "rainScore",
+    12: "visibility",
+    13: "boot",
+    14: "utc",
+}
+COORD_SCALE = 1e7
+BREAK = object()
+
+
+class Decoder:
+    """Minimal RFC 8949 decoder: the item types the firmware emits and a few more."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise ValueError("truncated CBOR")
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def argument(self, info):
+        if info < 24:
+            return info
+        if info == 31:
+            return None  # Indefinite length
+        sizes = {24: 1, 25: 2, 26: 4, 27: 8}
+        if info not in sizes:
+            raise ValueError(f"bad additional info {info}")
+        return int.from_bytes(self.take(sizes[info]), "big")
+
+    def item(self):
+        initial = self.take(1)[0]
+        major, info = initial >> 5, initial & 0x1F
+        if major == 7:
+            if info == 25:
+                return struct.unpack(">e", self.take(2))[0]
+            if info == 26:
+                return struct.unpack(">f", self.take(4))[0]
+            if info == 27:
+                return struct.unpack(">d", self.take(8))[0]
+            if info == 31:
+                return BREAK
+            return {20: False, 21: True, 22: None}.get(info)
+        value = self.argument(info)
+        if major == 0:
+            return value
+        if major == 1:
+            return -1 - value
+        if major in (2, 3):
+            raw = self.take(value)
+            return raw.decode() if major == 3 else raw
+        if major == 4:
+            return self.sequence(value, lambda: self.item())
+        if major == 5:
+            pairs = self.sequence(value, lambda: (self.item(), self.item()))
+            return dict(pairs)
+        raise ValueError(f"unsupported major type {major}")
+
+    def sequence(self, count, read):
+        out = []
+        while count is None or len(out) < count:
+            if count is None and self.data[self.pos] == 0xFF:
+                self.pos += 1
+                break
+            out.append(read())
+        return out
+
+
+def sample_to_json(raw):
+    sample = {KEYS.get(k, str(k)): v for k, v in raw.items()}
+    for key in ("lat", "lng"):
+        if key in sample:
+            sample[key] /= COORD_SCALE
+    accel = sample.pop("accel", None)
+    if accel:
+        sample["accel_x"], sample["accel_y"], sample["accel_z"] = accel
+    return {k: round(v, 6) if isinstance(v, float) else v for k, v in sample.items()}
+
+
+def decode_message(payload):
+    decoder = Decoder(payload)
+    item = decoder.item()
+    if decoder.pos != len(payload):
+        raise ValueError(f"{len(payload) - decoder.pos} trailing bytes")
+    samples = item if isinstance(item, list) else [item]
+    return [sample_to_json(s) for s in samples]
+
+
+def print_message(payload):
+    samples = decode_message(payload)
+    as_json = json.dumps(samples if len(samples) > 1 else samples[0], separators=(",", ":"))
+    print(f"{len(payload)} bytes CBOR, {len(samples)} samples, {len(as_json)} bytes as compact JSON")
+    for sample in samples:
+        print("  " + json.dumps(sample))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--file", help="decode one message from a file ('-' = stdin)")
+    parser.add_argument("--broker", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--topic", help="subscribe and decode every message")
+    args = parser.parse_args()
+
+    if args.file:
+        data = sys.stdin.buffer.read() if args.file == "-" else open(args.file, "rb").read()
+        print_message(data)
+        return
+
+    if not args.topic:
+        parser.error("--file or --topic is required")
+
+    import paho.mqtt.client as mqtt
+
+    try:
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)
+    except AttributeError:  # paho-mqtt < 2.0
+        client = mqtt.Client()
+
+    def on_message(_client, _userdata, msg):
+        try:
+            print_message(msg.payload)
+        except ValueError as err:
+            print(f"{msg.topic}: {err}")
+
+    client.on_message = on_message
+    client.on_connect = lambda c, *_: c.subscribe(args.topic, qos=1)
+    client.connect(args.broker, args.port)
+    print(f"Listening on {args.broker}:{args.port} for {args.topic}")
+    try:
+        client.loop_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()